@@ -0,0 +1,244 @@
+#include "audioOutput.hpp"
+#include <algorithm>
+
+audioRing::audioRing(uint32_t capacity)
+{
+	uint32_t size = 1;
+	while (size < capacity)
+	{
+		size <<= 1;
+	}
+	frames.resize(size);
+	mask = size - 1;
+	head = 0;
+	tail = 0;
+}
+
+uint32_t audioRing::push(const stereoSample* in, uint32_t count)
+{
+	uint32_t h = head.load(std::memory_order_relaxed);
+	count = std::min(count, getCapacity() - (h - tail.load(std::memory_order_acquire)));
+	for (uint32_t i = 0; i < count; i++)
+	{
+		frames[(h + i) & mask] = in[i];
+	}
+	head.store(h + count, std::memory_order_release);
+	return count;
+}
+
+uint32_t audioRing::pop(stereoSample* out, uint32_t count)
+{
+	uint32_t t = tail.load(std::memory_order_relaxed);
+	count = std::min(count, head.load(std::memory_order_acquire) - t);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		out[i] = frames[(t + i) & mask];
+	}
+	tail.store(t + count, std::memory_order_release);
+	return count;
+}
+
+audioOutput::audioOutput(audioSinkType t, std::string wavPath, uint32_t latencyMs)
+{
+	type = t;
+	device = 0;
+	deviceRate = CD_AUDIO_RATE;
+	ring = nullptr;
+	targetFill = 0;
+	started = false;
+	resamplePhase = 0;
+	lastInput = { 0, 0 };
+	driftCorrection = 0;
+	paced = false;
+	wavFrames = 0;
+	underruns = 0;
+	overruns = 0;
+	minRatio = 1.0;
+	maxRatio = 1.0;
+	fillTotal = 0;
+	fillSamples = 0;
+
+	if (type == audioSinkType::SDL)
+	{
+		openDevice(latencyMs);
+	}
+	else if (type == audioSinkType::WAV)
+	{
+		wavFile.open(wavPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!wavFile.is_open())
+		{
+			logging::fatal("unable to open WAV file: " + wavPath, logging::logSource::SPU);
+		}
+		writeWavHeader(); // sizes are filled in when the file is closed
+		logging::info("Writing audio to " + wavPath, logging::logSource::SPU);
+	}
+}
+
+audioOutput::~audioOutput()
+{
+	if (device != 0)
+	{
+		SDL_CloseAudioDevice(device); // waits for the callback to finish, so the ring can go after this
+		logging::important("Audio: " + std::to_string(underruns.load()) + " underruns, " + std::to_string(overruns) + " frames dropped", logging::logSource::SPU);
+		if (fillSamples > 0)
+		{
+			logging::important("Audio buffer: target " + std::to_string(targetFill) + " frames, avg " + std::to_string(fillTotal / fillSamples) +
+				", resampling ratio " + std::to_string(minRatio) + " - " + std::to_string(maxRatio), logging::logSource::SPU);
+		}
+	}
+	delete(ring);
+	if (wavFile.is_open())
+	{
+		writeWavHeader();
+		wavFile.close();
+		logging::important("Audio: " + std::to_string(wavFrames) + " frames written", logging::logSource::SPU);
+	}
+}
+
+void audioOutput::openDevice(uint32_t latencyMs)
+{
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
+	{
+		logging::error("Audio is off, SDL could not initialise audio: " + std::string(SDL_GetError()), logging::logSource::SPU);
+		type = audioSinkType::None;
+		return;
+	}
+	SDL_AudioSpec want = {};
+	want.freq = CD_AUDIO_RATE;
+	want.format = AUDIO_S16SYS;
+	want.channels = 2;
+	want.samples = AUDIO_DEVICE_BUFFER_FRAMES;
+	want.callback = callback;
+	want.userdata = this;
+	SDL_AudioSpec have;
+	// Anything but 16 bit stereo is converted by SDL, a different rate is handled by the resampler
+	device = SDL_OpenAudioDevice(nullptr, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+	if (device == 0)
+	{
+		logging::error("Audio is off, no audio device: " + std::string(SDL_GetError()), logging::logSource::SPU);
+		type = audioSinkType::None;
+		return;
+	}
+	deviceRate = have.freq;
+	targetFill = std::max<uint32_t>((deviceRate * latencyMs) / 1000, have.samples * 2);
+	// Room for a few frames of emulation on top of the target, anything past that is dropped
+	ring = new audioRing(targetFill * 4);
+	resampled.reserve(4096);
+	logging::info("Audio device at " + std::to_string(deviceRate) + "Hz, " + std::to_string(targetFill) + " frames of latency", logging::logSource::SPU);
+}
+
+void audioOutput::pushSamples(const stereoSample* samples, uint32_t count)
+{
+	switch (type)
+	{
+		case audioSinkType::WAV:
+		{
+			wavFile.write((const char*)samples, count * sizeof(stereoSample));
+			wavFrames += count;
+			break;
+		}
+		case audioSinkType::SDL:
+		{
+			// Below the target the ratio drops and each input frame makes a little more output, above it a little less
+			uint32_t fill = ring->getFill();
+			double error = ((double)fill - targetFill) / targetFill;
+			double ratio = 1.0;
+			if (started)
+			{
+				if (!paced)
+				{
+					driftCorrection = std::max(-AUDIO_MAX_RATE_DEVIATION, std::min(AUDIO_MAX_RATE_DEVIATION, driftCorrection + (error * AUDIO_RATE_INTEGRAL_GAIN)));
+				}
+				paced = false;
+				ratio += std::max(-AUDIO_MAX_RATE_DEVIATION, std::min(AUDIO_MAX_RATE_DEVIATION, (error * AUDIO_MAX_RATE_DEVIATION) + driftCorrection));
+				minRatio = std::min(minRatio, ratio);
+				maxRatio = std::max(maxRatio, ratio);
+				fillTotal += fill;
+				fillSamples++;
+			}
+			resample(samples, count, ratio);
+			uint32_t pushed = ring->push(resampled.data(), (uint32_t)resampled.size());
+			overruns += resampled.size() - pushed;
+			if (!started && ring->getFill() >= targetFill)
+			{
+				started = true;
+				SDL_PauseAudioDevice(device, 0);
+			}
+			break;
+		}
+		case audioSinkType::None: break;
+	}
+}
+
+bool audioOutput::shouldWait()
+{
+	if (type != audioSinkType::SDL || !started || ring->getFill() <= targetFill)
+	{
+		return false;
+	}
+	paced = true;
+	return true;
+}
+
+void audioOutput::resample(const stereoSample* samples, uint32_t count, double ratio)
+{
+	const uint32_t step = (uint32_t)((((uint64_t)CD_AUDIO_RATE << 16) / (double)deviceRate) * ratio);
+	uint32_t phase = resamplePhase;
+	int32_t previousLeft = lastInput.left;
+	int32_t previousRight = lastInput.right;
+	resampled.clear();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		int32_t currentLeft = samples[i].left;
+		int32_t currentRight = samples[i].right;
+		while (phase < 0x10000)
+		{
+			int64_t fraction = phase;
+			resampled.push_back({ (int16_t)(previousLeft + (((currentLeft - previousLeft) * fraction) >> 16)),
+				(int16_t)(previousRight + (((currentRight - previousRight) * fraction) >> 16)) });
+			phase += step;
+		}
+		phase -= 0x10000;
+		previousLeft = currentLeft;
+		previousRight = currentRight;
+	}
+	resamplePhase = phase;
+	lastInput = { (int16_t)previousLeft, (int16_t)previousRight };
+}
+
+void audioOutput::writeWavHeader()
+{
+	uint32_t dataBytes = (uint32_t)(wavFrames * sizeof(stereoSample));
+	uint8_t header[44];
+	auto put16 = [&](uint32_t offset, uint16_t value) { header[offset] = value & 0xFF; header[offset + 1] = value >> 8; };
+	auto put32 = [&](uint32_t offset, uint32_t value) { put16(offset, value & 0xFFFF); put16(offset + 2, value >> 16); };
+	memcpy(&header[0], "RIFF", 4);
+	put32(4, 36 + dataBytes);
+	memcpy(&header[8], "WAVEfmt ", 8);
+	put32(16, 16); // fmt chunk size
+	put16(20, 1); // PCM
+	put16(22, 2); // channels
+	put32(24, CD_AUDIO_RATE);
+	put32(28, CD_AUDIO_RATE * sizeof(stereoSample)); // bytes per second
+	put16(32, sizeof(stereoSample)); // bytes per frame
+	put16(34, 16); // bits per sample
+	memcpy(&header[36], "data", 4);
+	put32(40, dataBytes);
+	wavFile.seekp(0);
+	wavFile.write((const char*)header, sizeof(header));
+	wavFile.seekp(0, std::ios::end);
+}
+
+// Runs on SDL's audio thread
+void SDLCALL audioOutput::callback(void* userdata, Uint8* stream, int length)
+{
+	audioOutput* output = (audioOutput*)userdata;
+	uint32_t wanted = length / sizeof(stereoSample);
+	uint32_t got = output->ring->pop((stereoSample*)stream, wanted);
+	if (got < wanted)
+	{
+		// Emulation fell behind, play silence rather than stale samples
+		memset(stream + (got * sizeof(stereoSample)), 0, (wanted - got) * sizeof(stereoSample));
+		output->underruns++;
+	}
+}
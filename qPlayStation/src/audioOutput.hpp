@@ -0,0 +1,79 @@
+#pragma once
+#include "helpers.hpp"
+#include "cdAudio.hpp"
+#include <atomic>
+
+#define AUDIO_DEVICE_BUFFER_FRAMES 512 // what SDL asks for each callback, about 12ms
+#define AUDIO_MAX_RATE_DEVIATION 0.005 // the most the resampling ratio is nudged by, too small to hear as a pitch change
+#define AUDIO_RATE_INTEGRAL_GAIN 0.00002 // per push, slowly learns the steady drift so the fill settles on the target rather than off to one side
+#define AUDIO_DEFAULT_LATENCY_MS 60
+
+enum class audioSinkType
+{
+	SDL,	// play through the default audio device, this also paces emulation
+	WAV,	// write everything to a file at 44.1kHz, for servers without an audio device
+	None
+};
+
+// A fixed size single producer / single consumer ring of stereo frames.
+// The emulator thread pushes and the SDL audio callback pops; neither ever takes a lock or waits on the other.
+class audioRing
+{
+	public:
+		audioRing(uint32_t capacity); // rounded up to a power of 2
+		uint32_t push(const stereoSample* in, uint32_t count); // returns how many fit
+		uint32_t pop(stereoSample* out, uint32_t count); // returns how many there were
+		uint32_t getFill() { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+		uint32_t getCapacity() { return mask + 1; }
+	private:
+		std::vector<stereoSample> frames;
+		uint32_t mask;
+		// On separate cache lines so the two threads don't keep taking the line from each other
+		alignas(64) std::atomic<uint32_t> head; // frames pushed, only written by the emulator thread
+		alignas(64) std::atomic<uint32_t> tail; // frames popped, only written by the audio callback
+};
+
+// Takes the SPU's 44.1kHz output and sends it to a sink.
+// For the audio device the samples are resampled to the device's rate, with the ratio adjusted a tiny bit every push
+// to keep the ring near its target fill. That soaks up the drift between the emulated and real clocks without
+// the buffer slowly emptying (crackles) or filling (growing latency).
+class audioOutput
+{
+	public:
+		audioOutput(audioSinkType type, std::string wavPath, uint32_t latencyMs);
+		~audioOutput();
+		void pushSamples(const stereoSample* samples, uint32_t count);
+		// True while the device has more than the target queued. The main loop sleeps on this, which ties emulation speed to the audio clock.
+		bool shouldWait();
+	private:
+		audioSinkType type;
+
+		// SDL
+		SDL_AudioDeviceID device;
+		uint32_t deviceRate;
+		audioRing* ring;
+		uint32_t targetFill;
+		bool started; // the device is paused until the ring first reaches its target
+		uint32_t resamplePhase; // 16.16 position between the previous input frame and the next
+		stereoSample lastInput;
+		double driftCorrection; // the integral part of the ratio adjustment
+		bool paced; // the main loop waited for the device since the last push, so emulation already runs off the audio clock and there's no drift to learn
+		std::vector<stereoSample> resampled;
+
+		// WAV
+		std::ofstream wavFile;
+		uint64_t wavFrames;
+
+		// Stats - underruns are counted by the audio callback, the rest by the emulator thread
+		std::atomic<uint64_t> underruns;
+		uint64_t overruns;
+		double minRatio;
+		double maxRatio;
+		uint64_t fillTotal;
+		uint64_t fillSamples;
+
+		void openDevice(uint32_t latencyMs);
+		void resample(const stereoSample* samples, uint32_t count, double ratio);
+		void writeWavHeader();
+		static void SDLCALL callback(void* userdata, Uint8* stream, int length);
+};
@@ -0,0 +1,171 @@
+#include "cdAudio.hpp"
+#include <algorithm>
+
+// XA only uses the first 4 of the SPU ADPCM filters
+static const int32_t xaFilterPositive[4] = { 0, 60, 115, 98 };
+static const int32_t xaFilterNegative[4] = { 0, 0, -52, -55 };
+
+cdAudio::cdAudio()
+{
+	buffer.resize(CD_AUDIO_BUFFER_FRAMES);
+	droppedFrames = 0;
+	muted = false;
+	xaMuted = false;
+	setVolume(0x80, 0x00, 0x80, 0x00);
+	reset();
+}
+
+void cdAudio::reset()
+{
+	memset(history, 0, sizeof(history));
+	memset(lastInput, 0, sizeof(lastInput));
+	resamplePhase = 0;
+	head = 0;
+	tail = 0;
+}
+
+void cdAudio::setVolume(uint8_t leftToLeft, uint8_t leftToRight, uint8_t rightToRight, uint8_t rightToLeft)
+{
+	volume[0] = leftToLeft;
+	volume[1] = leftToRight;
+	volume[2] = rightToRight;
+	volume[3] = rightToLeft;
+}
+
+void cdAudio::push(int16_t left, int16_t right)
+{
+	if (head - tail >= CD_AUDIO_BUFFER_FRAMES)
+	{
+		droppedFrames++; // nothing is taking samples, or not fast enough
+		return;
+	}
+	buffer[head % CD_AUDIO_BUFFER_FRAMES] = { left, right };
+	head++;
+}
+
+stereoSample cdAudio::popSample()
+{
+	if (head == tail)
+	{
+		return { 0, 0 };
+	}
+	stereoSample sample = buffer[tail % CD_AUDIO_BUFFER_FRAMES];
+	tail++;
+	if (muted)
+	{
+		return { 0, 0 };
+	}
+	int32_t left = ((sample.left * volume[0]) >> 7) + ((sample.right * volume[3]) >> 7);
+	int32_t right = ((sample.right * volume[2]) >> 7) + ((sample.left * volume[1]) >> 7);
+	return { (int16_t)std::max(-32768, std::min(32767, left)), (int16_t)std::max(-32768, std::min(32767, right)) };
+}
+
+void cdAudio::queueCDDA(const uint8_t* sector)
+{
+	for (uint32_t i = 0; i < CDDA_FRAMES_PER_SECTOR; i++)
+	{
+		const uint8_t* frame = sector + (i * 4);
+		push((int16_t)(frame[0] | (frame[1] << 8)), (int16_t)(frame[2] | (frame[3] << 8)));
+	}
+}
+
+// Each block is 28 samples sharing one shift and filter. Unpacking is a plain loop over independent samples so the
+// compiler can vectorise it, leaving only the filter recurrence itself to run one sample at a time.
+void cdAudio::decodeBlock(const uint8_t* group, uint32_t block, bool eightBit, uint32_t channel, int16_t* out)
+{
+	uint8_t header = group[4 + block];
+	uint32_t range = header & 0xF;
+	if (range > 12) { range = 9; } // ranges 13-15 act like 9
+	uint32_t filter = (header >> 4) & 0x3;
+
+	// Samples go in the top bits of a 16 bit value and are shifted down by the range
+	int32_t samples[XA_SAMPLES_PER_BLOCK];
+	const uint8_t* data = group + 16;
+	if (eightBit)
+	{
+		for (uint32_t i = 0; i < XA_SAMPLES_PER_BLOCK; i++)
+		{
+			samples[i] = ((int16_t)(data[(i * 4) + block] << 8)) >> range;
+		}
+	}
+	else
+	{
+		uint32_t nibbleShift = (block & 1) * 4;
+		for (uint32_t i = 0; i < XA_SAMPLES_PER_BLOCK; i++)
+		{
+			samples[i] = ((int16_t)(((data[(i * 4) + (block >> 1)] >> nibbleShift) & 0xF) << 12)) >> range;
+		}
+	}
+
+	int32_t positive = xaFilterPositive[filter];
+	int32_t negative = xaFilterNegative[filter];
+	int32_t old = history[channel][0];
+	int32_t older = history[channel][1];
+	for (uint32_t i = 0; i < XA_SAMPLES_PER_BLOCK; i++)
+	{
+		int32_t sample = std::max(-32768, std::min(32767, samples[i] + (((old * positive) + (older * negative) + 32) >> 6)));
+		out[i] = (int16_t)sample;
+		older = old;
+		old = sample;
+	}
+	history[channel][0] = old;
+	history[channel][1] = older;
+}
+
+void cdAudio::decodeXA(const uint8_t* sector)
+{
+	uint8_t codingInfo = sector[19];
+	bool stereo = (codingInfo & 0x3) == 1;
+	uint32_t rate = ((codingInfo >> 2) & 0x3) ? 18900 : 37800;
+	bool eightBit = ((codingInfo >> 4) & 0x3) == 1;
+	uint32_t blocksPerGroup = eightBit ? 4 : 8;
+
+	// Blocks alternate left and right in stereo, mono just has them one after another
+	uint32_t samplesPerChannel = XA_SOUND_GROUPS * blocksPerGroup * XA_SAMPLES_PER_BLOCK / (stereo ? 2 : 1);
+	decoded[0].resize(samplesPerChannel);
+	decoded[1].resize(samplesPerChannel);
+	uint32_t position[2] = { 0, 0 };
+	for (uint32_t group = 0; group < XA_SOUND_GROUPS; group++)
+	{
+		const uint8_t* groupData = sector + 24 + (group * 128);
+		for (uint32_t block = 0; block < blocksPerGroup; block++)
+		{
+			uint32_t channel = stereo ? (block & 1) : 0;
+			decodeBlock(groupData, block, eightBit, channel, &decoded[channel][position[channel]]);
+			position[channel] += XA_SAMPLES_PER_BLOCK;
+		}
+	}
+	if (xaMuted)
+	{
+		return; // still decoded so the filter history stays right
+	}
+	resample(decoded[0], stereo ? decoded[1] : decoded[0], rate);
+}
+
+// 37.8kHz and 18.9kHz up to 44.1kHz by interpolating between neighbouring input samples.
+// The phase carries over between sectors so there are no clicks at sector boundaries.
+void cdAudio::resample(const std::vector<int16_t>& left, const std::vector<int16_t>& right, uint32_t inputRate)
+{
+	const uint32_t step = (uint32_t)(((uint64_t)inputRate << 16) / CD_AUDIO_RATE);
+	uint32_t phase = resamplePhase;
+	int32_t previousLeft = lastInput[0];
+	int32_t previousRight = lastInput[1];
+	for (size_t i = 0; i < left.size(); i++)
+	{
+		int32_t currentLeft = left[i];
+		int32_t currentRight = right[i];
+		while (phase < 0x10000)
+		{
+			int64_t fraction = phase;
+			push((int16_t)(previousLeft + (((currentLeft - previousLeft) * fraction) >> 16)),
+				(int16_t)(previousRight + (((currentRight - previousRight) * fraction) >> 16)));
+			phase += step;
+		}
+		phase -= 0x10000;
+		previousLeft = currentLeft;
+		previousRight = currentRight;
+	}
+	resamplePhase = phase;
+	lastInput[0] = (int16_t)previousLeft;
+	lastInput[1] = (int16_t)previousRight;
+}
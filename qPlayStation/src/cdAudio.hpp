@@ -0,0 +1,50 @@
+#pragma once
+#include "helpers.hpp"
+#include "disc.hpp"
+
+#define CD_AUDIO_RATE 44100 // what the SPU mixes at, CD-DA is already at this rate
+#define CD_AUDIO_BUFFER_FRAMES 16384 // about a third of a second
+#define CDDA_FRAMES_PER_SECTOR (SECTOR_SIZE / 4)
+#define XA_SOUND_GROUPS 18 // 128 byte groups of ADPCM in each Form 2 sector
+#define XA_SAMPLES_PER_BLOCK 28
+
+struct stereoSample
+{
+	int16_t left;
+	int16_t right;
+};
+
+// Turns XA-ADPCM and CD-DA sectors into 44.1kHz stereo for the SPU's CD input, one sector at a time as the drive reads them.
+class cdAudio
+{
+	public:
+		cdAudio();
+		void reset();
+		void decodeXA(const uint8_t* sector); // raw 2352 byte Form 2 sector with the audio submode bit set
+		void queueCDDA(const uint8_t* sector);
+		// CD volume registers, 0x80 is 100%. Left/right to left/right SPU input.
+		void setVolume(uint8_t leftToLeft, uint8_t leftToRight, uint8_t rightToRight, uint8_t rightToLeft);
+		void setMuted(bool m) { muted = m; } // Mute/Demute commands
+		void setXAMuted(bool m) { xaMuted = m; } // bit 0 of the apply volume register
+		stereoSample popSample(); // silence if nothing is queued
+		uint32_t getQueuedFrames() { return head - tail; }
+		uint64_t getDroppedFrames() { return droppedFrames; }
+	private:
+		// ADPCM history for each channel, the previous two output samples
+		int32_t history[2][2];
+		// Linear resampler state, the phase is 16.16 fixed point between the last input sample and the next
+		int16_t lastInput[2];
+		uint32_t resamplePhase;
+		std::vector<stereoSample> buffer; // ring of CD_AUDIO_BUFFER_FRAMES
+		uint32_t head;
+		uint32_t tail;
+		uint64_t droppedFrames;
+		uint8_t volume[4]; // LL, LR, RR, RL
+		bool muted;
+		bool xaMuted;
+		std::vector<int16_t> decoded[2]; // scratch for one sector
+
+		void decodeBlock(const uint8_t* group, uint32_t block, bool eightBit, uint32_t channel, int16_t* out);
+		void resample(const std::vector<int16_t>& left, const std::vector<int16_t>& right, uint32_t inputRate);
+		void push(int16_t left, int16_t right);
+};
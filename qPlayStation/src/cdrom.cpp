@@ -1,4 +1,5 @@
 #include "cdrom.hpp"
+#include "cpu.hpp" // solve circular dependency
 
 CDROMFIFO::CDROMFIFO()
 {
@@ -46,10 +47,166 @@ uint8_t CDROMFIFO::numElements()
 cdrom::cdrom(interruptController* i)
 {
 	InterruptController = i;
+	CPU = nullptr;
 	portIndex = 0;
 	interruptEnable = 0;
 	responseReceived = 0;
 	commandStartInterrupt = false;
+	commandBusy = false;
+	commandParameterCount = 0;
+	nextEventCycle = UINT64_MAX;
+	Disc = nullptr;
+	Reader = nullptr;
+	mode = 0;
+	speedUp = 1;
+	seekTarget = 0;
+	setlocPending = false;
+	readLBA = 0;
+	motorOn = false;
+	reading = false;
+	seeking = false;
+	playing = false;
+	filterFile = 0;
+	filterChannel = 0;
+	Audio = new cdAudio();
+	memset(pendingVolume, 0, sizeof(pendingVolume));
+	memset(sectorBuffer, 0, sizeof(sectorBuffer));
+	dataFifoSize = 0;
+	dataFifoIndex = 0;
+}
+
+cdrom::~cdrom()
+{
+	delete(Reader);
+	if (Audio->getDroppedFrames() > 0)
+	{
+		logging::info("CD audio dropped " + std::to_string(Audio->getDroppedFrames()) + " samples", logging::logSource::CDROM);
+	}
+	delete(Audio);
+}
+
+void cdrom::giveCpuRef(cpu* c)
+{
+	CPU = c;
+}
+
+void cdrom::insertDisc(discImage* d)
+{
+	stopReading();
+	delete(Reader);
+	Disc = d;
+	Reader = nullptr;
+	motorOn = false;
+	seeking = false;
+	region = "SCEA";
+	if (d == nullptr) { return; }
+
+	// The licence text in sector 4 says which region the disc is for. This has to happen before the reader thread takes over the disc.
+	std::string licence((const char*)d->getUserData(DISC_PREGAP_SECTORS + 4), 80);
+	if (licence.find("Europe") != std::string::npos) { region = "SCEE"; }
+	else if (licence.find("Inc") != std::string::npos) { region = "SCEI"; }
+	Reader = new discReader(d);
+	motorOn = true;
+}
+
+void cdrom::setSpeedUp(uint32_t factor)
+{
+	speedUp = std::min<uint32_t>(factor, CD_MAX_SPEED_UP);
+}
+
+uint64_t cdrom::now()
+{
+	return (CPU != nullptr) ? CPU->getCycles() : 0;
+}
+
+void cdrom::runEvents(uint64_t cycles)
+{
+	while (!events.empty() && events.front().cycle <= cycles)
+	{
+		cdromEvent event = events.front();
+		events.pop_front();
+		switch (event.type)
+		{
+			case cdromEventType::FirstResponse:
+			{
+				commandBusy = false;
+				executeCommand(event.command);
+				break;
+			}
+			case cdromEventType::SecondResponse: finishCommand(event.command); break;
+			case cdromEventType::Sector: deliverSector(); break;
+			case cdromEventType::PendingResponse:
+			{
+				if (responseReceived == 0 && !pendingResponses.empty())
+				{
+					cdromResponse response = pendingResponses.front();
+					pendingResponses.pop_front();
+					deliverResponse(response);
+				}
+				break;
+			}
+		}
+	}
+	nextEventCycle = events.empty() ? UINT64_MAX : events.front().cycle;
+}
+
+void cdrom::schedule(uint64_t delay, cdromEventType type, uint8_t command)
+{
+	cdromEvent event = { now() + delay, type, command };
+	auto position = events.begin();
+	while (position != events.end() && position->cycle <= event.cycle)
+	{
+		position++;
+	}
+	events.insert(position, event);
+	nextEventCycle = events.front().cycle;
+}
+
+void cdrom::cancelEvents(cdromEventType type)
+{
+	events.remove_if([type](const cdromEvent& event) { return event.type == type; });
+	nextEventCycle = events.empty() ? UINT64_MAX : events.front().cycle;
+}
+
+// Responses wait until the CPU has acknowledged the previous interrupt, so none get lost
+void cdrom::deliverResponse(const cdromResponse& response)
+{
+	if (responseReceived != 0)
+	{
+		pendingResponses.push_back(response);
+		return;
+	}
+	responseFifo.reset();
+	for (uint8_t i = 0; i < response.length; i++)
+	{
+		responseFifo.push(response.bytes[i]);
+	}
+	responseReceived = response.interrupt;
+	if (interruptEnable & responseReceived)
+	{
+		InterruptController->requestInterrupt(interruptType::CDROM);
+	}
+}
+
+void cdrom::respond(uint8_t interrupt, std::initializer_list<uint8_t> bytes)
+{
+	cdromResponse response = { interrupt, 0, {} };
+	for (uint8_t byte : bytes)
+	{
+		response.bytes[response.length++] = byte;
+	}
+	deliverResponse(response);
+}
+
+void cdrom::respondStatus(uint8_t interrupt)
+{
+	respond(interrupt, { getStatus() });
+}
+
+// INT5 with the error bit set in the status, which is how the drive rejects a command rather than hanging
+void cdrom::respondError(uint8_t error)
+{
+	respond(5, { (uint8_t)(getStatus() | 0x01), error });
 }
 
 void cdrom::set32(uint32_t addr, uint32_t value) { logging::fatal("unimplemented 32 bit CDROM write" + helpers::intToHex(addr), logging::logSource::CDROM); }
@@ -59,7 +216,6 @@ uint16_t cdrom::get16(uint32_t addr) { logging::fatal("unimplemented 32 bit CDRO
 
 void cdrom::set8(uint32_t addr, uint8_t value)
 {
-	logging::info("CDROM Write: " + helpers::intToHex(addr) + " " + helpers::intToHex(value), logging::logSource::CDROM);
 	switch (addr)
 	{
 		case 0: // Status Register
@@ -74,7 +230,7 @@ void cdrom::set8(uint32_t addr, uint8_t value)
 				case 0: writeCommandRegister(value); break;
 				case 1: break; // Sound Map Data Out
 				case 2: break; // Sound Map Coding Info
-				case 3: break; // Audio Volume - Right CD out to Right SPU input
+				case 3: pendingVolume[2] = value; break; // Audio Volume - Right CD out to Right SPU input
 			}
 			break;
 		}
@@ -84,8 +240,8 @@ void cdrom::set8(uint32_t addr, uint8_t value)
 			{
 				case 0: parameterFifo.push(value); break;
 				case 1: interruptEnable = value & 0x1F; break;
-				case 2: break; // Audio Volume - Left CD out to Left SPU input
-				case 3: break; // Audio Volume - Right CD out to Left SPU input
+				case 2: pendingVolume[0] = value; break; // Audio Volume - Left CD out to Left SPU input
+				case 3: pendingVolume[3] = value; break; // Audio Volume - Right CD out to Left SPU input
 			}
 			break;
 		}
@@ -93,7 +249,19 @@ void cdrom::set8(uint32_t addr, uint8_t value)
 		{
 			switch (portIndex)
 			{
-				case 0: break; // Request Register
+				case 0: // Request Register
+				{
+					if (value & 0x80) // Want data
+					{
+						loadDataFifo();
+					}
+					else
+					{
+						dataFifoSize = 0;
+						dataFifoIndex = 0;
+					}
+					break;
+				}
 				case 1: // Interrupt Flag Register
 				{
 					responseReceived &= ~(value & 0x7); // Acknowledge interrupts
@@ -102,10 +270,22 @@ void cdrom::set8(uint32_t addr, uint8_t value)
 					{
 						parameterFifo.reset();
 					}
+					if (responseReceived == 0 && !pendingResponses.empty())
+					{
+						schedule(CD_PENDING_RESPONSE_CYCLES, cdromEventType::PendingResponse, 0);
+					}
+					break;
+				}
+				case 2: pendingVolume[1] = value; break; // Audio Volume - Left CD out to Right SPU input
+				case 3: // Audio Volume - Apply Changes
+				{
+					Audio->setXAMuted(value & 0x1);
+					if (value & 0x20)
+					{
+						Audio->setVolume(pendingVolume[0], pendingVolume[1], pendingVolume[2], pendingVolume[3]);
+					}
 					break;
 				}
-				case 2: break; // Audio Volume - Left CD out to Right SPU input
-				case 3: break; // Audio Volume - Apply Changes
 			}
 			break;
 		}
@@ -114,7 +294,6 @@ void cdrom::set8(uint32_t addr, uint8_t value)
 
 uint8_t cdrom::get8(uint32_t addr)
 {
-	logging::info("CDROM Read: " + helpers::intToHex(addr), logging::logSource::CDROM);
 	switch (addr)
 	{
 		case 0: // Status Register
@@ -123,17 +302,17 @@ uint8_t cdrom::get8(uint32_t addr)
 				0 << 2 | // XA_ADCPM FIFO empty (0 = Empty)
 				((uint8_t)parameterFifo.isEmpty()) << 3 |
 				((uint8_t)(!parameterFifo.isFull())) << 4 |
-				((uint8_t)responseFifo.isEmpty()) << 5 |
-				0 << 6 | // Data FIFO empty (0 = Empty)
-				0 << 7; // Command / Parameter transmission busy (1 = Busy)
+				((uint8_t)(!responseFifo.isEmpty())) << 5 |
+				((uint8_t)(dataFifoIndex < dataFifoSize)) << 6 | // Data FIFO empty (0 = Empty)
+				((uint8_t)commandBusy) << 7; // Command / Parameter transmission busy (1 = Busy)
 		}
 		case 1: return responseFifo.pop();
-		case 2: return 0; // Data Fifo
+		case 2: return (dataFifoIndex < dataFifoSize) ? dataFifo[dataFifoIndex++] : 0; // Data Fifo
 		case 3:
 		{
 			switch (portIndex)
 			{
-				case 0: case 2: return interruptEnable;
+				case 0: case 2: return interruptEnable | 0xE0;
 				case 1: case 3: // Interrupt Flag Register
 				{
 					return responseReceived | (((uint8_t)commandStartInterrupt) << 4) | 0xE0;
@@ -141,48 +320,457 @@ uint8_t cdrom::get8(uint32_t addr)
 			}
 		}
 	}
+	return 0;
+}
+
+// Mode bit 5 picks between the whole sector after the sync, or just the 2048 bytes of data
+void cdrom::loadDataFifo()
+{
+	bool wholeSector = mode & 0x20;
+	uint32_t offset = wholeSector ? 12 : 24;
+	dataFifoSize = wholeSector ? (SECTOR_SIZE - 12) : SECTOR_USER_DATA_SIZE;
+	dataFifoIndex = 0;
+	memcpy(dataFifo, sectorBuffer + offset, dataFifoSize);
+}
+
+uint32_t cdrom::readData(uint8_t* out, uint32_t length)
+{
+	uint32_t available = std::min(length, dataFifoSize - dataFifoIndex);
+	memcpy(out, dataFifo + dataFifoIndex, available);
+	memset(out + available, 0, length - available);
+	dataFifoIndex += available;
+	return available;
 }
 
 void cdrom::writeCommandRegister(uint8_t value)
 {
-	executeCommand(value);
+	if (commandBusy)
+	{
+		logging::warning("CDROM command " + helpers::intToHex(value) + " sent while the last one is still busy", logging::logSource::CDROM);
+	}
+	// Parameters are taken now, the command itself runs when the first response is due
+	commandParameterCount = parameterFifo.numElements();
+	for (uint8_t i = 0; i < commandParameterCount; i++)
+	{
+		commandParameters[i] = parameterFifo.pop();
+	}
+	parameterFifo.reset();
+	commandBusy = true;
+	schedule((value == 0x0A) ? CD_INIT_FIRST_RESPONSE_CYCLES : CD_FIRST_RESPONSE_CYCLES, cdromEventType::FirstResponse, value);
+}
+
+bool cdrom::checkParameterCount(uint8_t command, uint8_t count)
+{
+	if (commandParameterCount != count)
+	{
+		logging::warning("Incorrect number of parameters for CDROM command " + helpers::intToHex(command) + ": " + helpers::intToHex(commandParameterCount), logging::logSource::CDROM);
+		respondError(CD_ERROR_PARAMETER_COUNT);
+		return false;
+	}
+	return true;
+}
+
+bool cdrom::requireDisc(uint8_t command)
+{
+	if (Disc == nullptr)
+	{
+		logging::warning("CDROM command " + helpers::intToHex(command) + " needs a disc", logging::logSource::CDROM);
+		respondError(CD_ERROR_NO_DISC);
+		return false;
+	}
+	return true;
+}
+
+uint8_t cdrom::getStatus()
+{
+	if (Disc == nullptr)
+	{
+		return 0b00010000; // lid open
+	}
+	return (((uint8_t)motorOn) << 1) |
+		(((uint8_t)(reading && !playing && !seeking)) << 5) |
+		(((uint8_t)seeking) << 6) |
+		(((uint8_t)(playing && !seeking)) << 7);
+}
+
+// Speeding up only changes how long the drive takes, commands still respond in the same order.
+// CD-DA and XA audio always go at the real speed, as the SPU plays them at 44.1kHz however fast they arrive.
+uint64_t cdrom::sectorCycles()
+{
+	// Bit 7 of the mode is double speed
+	uint64_t cycles = (mode & 0x80) ? (CD_SECTOR_CYCLES / 2) : CD_SECTOR_CYCLES;
+	if (playing || (mode & 0x40))
+	{
+		return cycles;
+	}
+	if (speedUp == 0)
+	{
+		return CD_INSTANT_SECTOR_CYCLES;
+	}
+	return std::max<uint64_t>(cycles / speedUp, CD_INSTANT_SECTOR_CYCLES);
 }
 
+// Rough seek model: a fixed settle time plus a bit for every sector moved, so a full disc seek is about a third of a second
+uint64_t cdrom::seekCycles(uint32_t from, uint32_t to)
+{
+	if (speedUp == 0)
+	{
+		return CD_INSTANT_SECTOR_CYCLES;
+	}
+	uint32_t distance = (from > to) ? from - to : to - from;
+	return (20000 + ((uint64_t)distance * 34)) / speedUp;
+}
+
+void cdrom::startReading(bool play)
+{
+	playing = play;
+	uint64_t delay = sectorCycles();
+	// Without a new Setloc, reading carries on from wherever the head is (e.g. after a Pause)
+	if (setlocPending)
+	{
+		if (readLBA != seekTarget)
+		{
+			seeking = true;
+			delay += seekCycles(readLBA, seekTarget);
+		}
+		readLBA = seekTarget;
+		setlocPending = false;
+	}
+	reading = true;
+	uint32_t speed = (mode & 0x80) ? 2 : 1;
+	Reader->start(readLBA, speed * ((speedUp == 0) ? CD_MAX_SPEED_UP : speedUp));
+	cancelEvents(cdromEventType::Sector);
+	schedule(delay, cdromEventType::Sector, 0);
+}
+
+void cdrom::stopReading()
+{
+	reading = false;
+	playing = false;
+	seeking = false;
+	cancelEvents(cdromEventType::Sector);
+	if (Reader != nullptr)
+	{
+		Reader->stop();
+	}
+}
+
+bool cdrom::sectorInterruptPending()
+{
+	if (responseReceived == 1)
+	{
+		return true;
+	}
+	for (const cdromResponse& response : pendingResponses)
+	{
+		if (response.interrupt == 1) { return true; }
+	}
+	return false;
+}
+
+void cdrom::deliverSector()
+{
+	seeking = false;
+	if (speedUp != 1 && sectorInterruptPending())
+	{
+		// When sped up the drive waits for the CPU instead of overwriting sectors it hasn't taken yet, games only expect that to happen at real speed
+		schedule(CD_PENDING_RESPONSE_CYCLES, cdromEventType::Sector, 0);
+		return;
+	}
+	if (!Reader->pop(readLBA, sectorBuffer))
+	{
+		// The read ahead thread hasn't got this sector yet, so try again a little later instead of waiting for it
+		schedule(sectorCycles() / 8, cdromEventType::Sector, 0);
+		return;
+	}
+	readLBA++;
+	schedule(sectorCycles(), cdromEventType::Sector, 0);
+	if (handleAudioSector())
+	{
+		return;
+	}
+
+	// If the CPU hasn't dealt with the last sector yet it gets overwritten, like on the real drive
+	for (const cdromResponse& response : pendingResponses)
+	{
+		if (response.interrupt == 1) { return; }
+	}
+	respondStatus(1); // INT1 - data ready
+}
+
+// Audio sectors go to the decoder rather than the CPU. Returns true if the CPU shouldn't see the sector.
+bool cdrom::handleAudioSector()
+{
+	if (playing)
+	{
+		Audio->queueCDDA(sectorBuffer);
+		return true;
+	}
+	// Mode bit 6 sends XA-ADPCM to the SPU, those are Form 2 sectors with the audio submode bit
+	uint8_t submode = sectorBuffer[18];
+	if (!(mode & 0x40) || sectorBuffer[15] != 2 || (submode & 0x24) != 0x24)
+	{
+		return false;
+	}
+	// Mode bit 3 only lets through the file and channel picked by Setfilter, so games can interleave several streams
+	if (!(mode & 0x08) || (sectorBuffer[16] == filterFile && sectorBuffer[17] == filterChannel))
+	{
+		Audio->decodeXA(sectorBuffer);
+	}
+	return true;
+}
+
+// Runs when the first response is due
 void cdrom::executeCommand(uint8_t command)
 {
 	switch (command)
 	{
 		case 0x01: // Getstat
 		{
-			responseFifo.push(0b00010000); // temporary - says "everything is ok but the lid is open"
-			responseReceived = 3;
+			respondStatus(3);
 			break;
 		}
-		case 0x19: // Test
+		case 0x02: // Setloc
+		{
+			if (!checkParameterCount(command, 3)) { break; }
+			msf position = { discImage::fromBCD(commandParameters[0]), discImage::fromBCD(commandParameters[1]), discImage::fromBCD(commandParameters[2]) };
+			seekTarget = discImage::msfToLBA(position);
+			setlocPending = true;
+			respondStatus(3);
+			break;
+		}
+		case 0x06: // ReadN
+		case 0x1B: // ReadS - same as ReadN but without retrying on errors, which we never get
+		{
+			if (!requireDisc(command)) { break; }
+			respondStatus(3);
+			startReading(false);
+			break;
+		}
+		case 0x03: // Play - CD-DA from the Setloc position, or the start of a track if one is given
 		{
-			if (parameterFifo.numElements() != 1)
+			if (!requireDisc(command)) { break; }
+			if (commandParameterCount > 0 && commandParameters[0] != 0)
 			{
-				logging::fatal("Incorrect number of parameters for CDROM Test command: " + helpers::intToHex(parameterFifo.numElements()), logging::logSource::CDROM);
+				uint8_t trackNumber = discImage::fromBCD(commandParameters[0]);
+				for (const discTrack& track : Disc->getTracks())
+				{
+					if (track.number == trackNumber)
+					{
+						seekTarget = track.indexOneLBA;
+						setlocPending = true;
+					}
+				}
 			}
-			uint8_t subfunction = parameterFifo.pop();
+			respondStatus(3);
+			startReading(true);
+			break;
+		}
+		case 0x07: // MotorOn
+		{
+			respondStatus(3);
+			schedule(CPU_CLOCK / 10, cdromEventType::SecondResponse, command);
+			break;
+		}
+		case 0x08: // Stop
+		{
+			stopReading();
+			respondStatus(3);
+			schedule(motorOn ? (CPU_CLOCK / 10) : CD_FIRST_RESPONSE_CYCLES, cdromEventType::SecondResponse, command);
+			break;
+		}
+		case 0x09: // Pause
+		{
+			respondStatus(3);
+			// Takes about a sector to stop if it was reading
+			uint64_t delay = reading ? sectorCycles() : 7000;
+			stopReading();
+			schedule(delay, cdromEventType::SecondResponse, command);
+			break;
+		}
+		case 0x0A: // Init
+		{
+			respondStatus(3);
+			stopReading();
+			mode = 0;
+			schedule(120000, cdromEventType::SecondResponse, command);
+			break;
+		}
+		case 0x0B: // Mute
+		case 0x0C: // Demute
+		{
+			Audio->setMuted(command == 0x0B);
+			respondStatus(3);
+			break;
+		}
+		case 0x0D: // Setfilter
+		{
+			if (!checkParameterCount(command, 2)) { break; }
+			filterFile = commandParameters[0];
+			filterChannel = commandParameters[1];
+			respondStatus(3);
+			break;
+		}
+		case 0x0E: // Setmode
+		{
+			if (!checkParameterCount(command, 1)) { break; }
+			mode = commandParameters[0];
+			respondStatus(3);
+			break;
+		}
+		case 0x0F: // Getparam
+		{
+			respond(3, { getStatus(), mode, 0, filterFile, filterChannel });
+			break;
+		}
+		case 0x10: // GetlocL - header and subheader of the last sector read
+		{
+			respond(3, { sectorBuffer[12], sectorBuffer[13], sectorBuffer[14], sectorBuffer[15], sectorBuffer[16], sectorBuffer[17], sectorBuffer[18], sectorBuffer[19] });
+			break;
+		}
+		case 0x11: // GetlocP - position from the subchannel
+		{
+			if (!requireDisc(command)) { break; }
+			const discTrack* track = Disc->findTrack(readLBA);
+			uint8_t trackNumber = (track != nullptr) ? track->number : 0xAA; // 0xAA is the lead out
+			uint32_t indexOne = (track != nullptr) ? track->indexOneLBA : Disc->getLeadOutLBA();
+			uint8_t index = (readLBA >= indexOne) ? 1 : 0;
+			msf relative = discImage::lbaToMSF((readLBA >= indexOne) ? readLBA - indexOne : indexOne - readLBA);
+			msf absolute = discImage::lbaToMSF(readLBA);
+			respond(3, { discImage::toBCD(trackNumber), index,
+				discImage::toBCD(relative.minute), discImage::toBCD(relative.second), discImage::toBCD(relative.frame),
+				discImage::toBCD(absolute.minute), discImage::toBCD(absolute.second), discImage::toBCD(absolute.frame) });
+			break;
+		}
+		case 0x13: // GetTN - first and last track numbers
+		{
+			if (!requireDisc(command)) { break; }
+			const std::vector<discTrack>& tracks = Disc->getTracks();
+			respond(3, { getStatus(), discImage::toBCD(tracks.front().number), discImage::toBCD(tracks.back().number) });
+			break;
+		}
+		case 0x14: // GetTD - start of a track, track 0 is the lead out
+		{
+			if (!checkParameterCount(command, 1)) { break; }
+			if (!requireDisc(command)) { break; }
+			uint8_t trackNumber = discImage::fromBCD(commandParameters[0]);
+			uint32_t lba = Disc->getLeadOutLBA();
+			if (trackNumber != 0)
+			{
+				bool found = false;
+				for (const discTrack& track : Disc->getTracks())
+				{
+					if (track.number == trackNumber)
+					{
+						lba = track.indexOneLBA;
+						found = true;
+					}
+				}
+				if (!found)
+				{
+					logging::warning("CDROM GetTD for missing track: " + std::to_string(trackNumber), logging::logSource::CDROM);
+					respondError(CD_ERROR_INVALID_PARAMETER);
+					break;
+				}
+			}
+			msf position = discImage::lbaToMSF(lba);
+			respond(3, { getStatus(), discImage::toBCD(position.minute), discImage::toBCD(position.second) });
+			break;
+		}
+		case 0x15: // SeekL
+		case 0x16: // SeekP
+		{
+			if (!requireDisc(command)) { break; }
+			stopReading();
+			seeking = true;
+			setlocPending = false;
+			respondStatus(3);
+			schedule(seekCycles(readLBA, seekTarget), cdromEventType::SecondResponse, command);
+			break;
+		}
+		case 0x19: // Test
+		{
+			if (!checkParameterCount(command, 1)) { break; }
+			uint8_t subfunction = commandParameters[0];
 			switch (subfunction)
 			{
 				case 0x20: // Get CDROM BIOS date / version
 				{
 					// Taken from rustation. Apparently came from a PAL SCPH-7502 console.
-					responseFifo.push(0x98); // Year
-					responseFifo.push(0x06); // Month
-					responseFifo.push(0x10); // Day
-					responseFifo.push(0xc3); // Version
-					responseReceived = 3;
+					respond(3, { 0x98, 0x06, 0x10, 0xc3 }); // Year, Month, Day, Version
+					break;
+				}
+				default:
+				{
+					logging::warning("Unimplemented CDROM Test Sub-Function: " + helpers::intToHex(subfunction), logging::logSource::CDROM);
+					respondError(CD_ERROR_INVALID_PARAMETER);
 					break;
 				}
-				default: logging::fatal("Unimplemented CDROM Test Sub-Function: " + helpers::intToHex(subfunction), logging::logSource::CDROM); break;
 			}
 			break;
 		}
-		default: logging::fatal("Unimplemented CDROM command: " + helpers::intToHex(command), logging::logSource::CDROM); break;
+		case 0x1A: // GetID
+		{
+			if (Disc == nullptr)
+			{
+				respond(5, { 0x08, 0x40, 0, 0, 0, 0, 0, 0 }); // no disc
+				break;
+			}
+			respondStatus(3);
+			schedule(CPU_CLOCK / 1000, cdromEventType::SecondResponse, command);
+			break;
+		}
+		case 0x1E: // ReadTOC
+		{
+			if (!requireDisc(command)) { break; }
+			respondStatus(3);
+			schedule(CPU_CLOCK / 2, cdromEventType::SecondResponse, command);
+			break;
+		}
+		default:
+		{
+			logging::warning("Unimplemented CDROM command: " + helpers::intToHex(command), logging::logSource::CDROM);
+			respondError(CD_ERROR_INVALID_COMMAND);
+			break;
+		}
 	}
+}
 
-	InterruptController->requestInterrupt(interruptType::CDROM);
-}
\ No newline at end of file
+// Runs when the second response is due, for commands that take a while to finish
+void cdrom::finishCommand(uint8_t command)
+{
+	switch (command)
+	{
+		case 0x08: // Stop
+		{
+			motorOn = false;
+			respondStatus(2);
+			break;
+		}
+		case 0x07: // MotorOn
+		{
+			motorOn = true;
+			respondStatus(2);
+			break;
+		}
+		case 0x15: // SeekL
+		case 0x16: // SeekP
+		{
+			readLBA = seekTarget;
+			seeking = false;
+			respondStatus(2);
+			break;
+		}
+		case 0x1A: // GetID
+		{
+			if (Disc->getTracks().front().type == trackType::Audio)
+			{
+				respond(5, { (uint8_t)(getStatus() | 0x08), 0x90, 0, 0, 0, 0, 0, 0 }); // audio CD
+				break;
+			}
+			respond(2, { getStatus(), 0x00, 0x20, 0x00, (uint8_t)region[0], (uint8_t)region[1], (uint8_t)region[2], (uint8_t)region[3] });
+			break;
+		}
+		default: respondStatus(2); break; // Pause, Init, ReadTOC
+	}
+}
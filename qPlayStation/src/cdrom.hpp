@@ -2,6 +2,24 @@
 #include "helpers.hpp"
 #include "peripheral.hpp"
 #include "interrupt.hpp"
+#include "disc.hpp"
+#include "discReader.hpp"
+#include "cdAudio.hpp"
+class cpu; // forward declare instead of include to solve circular dependency
+
+#define CPU_CLOCK 33868800
+#define CD_SECTOR_CYCLES (CPU_CLOCK / SECTORS_PER_SECOND) // at single speed
+#define CD_FIRST_RESPONSE_CYCLES 25000
+#define CD_INIT_FIRST_RESPONSE_CYCLES 80000
+#define CD_PENDING_RESPONSE_CYCLES 2000 // gap between acknowledging an interrupt and the next queued one arriving
+#define CD_INSTANT_SECTOR_CYCLES 5000 // sector and seek time with instant speed up, still leaves the CPU time to take each sector
+#define CD_MAX_SPEED_UP 16
+
+// Second byte of an INT5 error response
+#define CD_ERROR_INVALID_PARAMETER 0x10 // e.g. a track that isn't on the disc, or an unknown Test sub-function
+#define CD_ERROR_PARAMETER_COUNT 0x20
+#define CD_ERROR_INVALID_COMMAND 0x40
+#define CD_ERROR_NO_DISC 0x80 // can't respond yet, the lid is open or there's no disc
 
 class CDROMFIFO // Used for command arguments and responses
 {
@@ -19,25 +37,107 @@ class CDROMFIFO // Used for command arguments and responses
 		uint8_t readIndex;
 };
 
+struct cdromResponse
+{
+	uint8_t interrupt; // INT1 - INT5
+	uint8_t length;
+	uint8_t bytes[16];
+};
+
+enum class cdromEventType : uint8_t
+{
+	FirstResponse,	// the command has been processed
+	SecondResponse,	// the command has finished (Init, Pause, SeekL, etc.)
+	Sector,			// the next sector has been read while reading
+	PendingResponse	// an earlier response was waiting for its interrupt to be acknowledged
+};
+
+struct cdromEvent
+{
+	uint64_t cycle;
+	cdromEventType type;
+	uint8_t command;
+};
+
 class cdrom : public peripheral
 {
 	public:
 		cdrom(interruptController* i);
+		~cdrom();
+		void giveCpuRef(cpu* c);
+		void insertDisc(discImage* d);
+		void setSpeedUp(uint32_t factor); // 1 = real speed, up to CD_MAX_SPEED_UP, 0 = instant
+		uint64_t getNextEventCycle() { return nextEventCycle; }
+		void runEvents(uint64_t cycles);
 		void set32(uint32_t addr, uint32_t value);
 		uint32_t get32(uint32_t addr);
 		void set16(uint32_t addr, uint16_t value);
 		uint16_t get16(uint32_t addr);
 		void set8(uint32_t addr, uint8_t value);
 		uint8_t get8(uint32_t addr);
+		// Bulk read of the data FIFO for DMA, zero filled past the end. Returns how many bytes actually came from the FIFO.
+		uint32_t readData(uint8_t* out, uint32_t length);
+		// Next 44.1kHz sample of CD audio (XA or CD-DA) for the SPU
+		stereoSample popAudioSample() { return Audio->popSample(); }
 	private:
 		interruptController* InterruptController;
+		cpu* CPU;
 		uint8_t portIndex;
 		uint8_t interruptEnable;
 		uint8_t responseReceived;
 		bool commandStartInterrupt;
 		CDROMFIFO parameterFifo;
 		CDROMFIFO responseFifo;
-		void executeCommand(uint8_t command);
+
+		// Commands take their parameters when they're written, then respond later through the event list
+		bool commandBusy;
+		uint8_t commandParameters[16];
+		uint8_t commandParameterCount;
+		std::list<cdromEvent> events; // sorted by cycle
+		std::list<cdromResponse> pendingResponses; // waiting for the CPU to acknowledge the current interrupt
+		uint64_t nextEventCycle; // cycle of the first event, UINT64_MAX if there are none
+
+		discImage* Disc;
+		discReader* Reader;
+		std::string region; // for GetID, e.g. "SCEA"
+		uint8_t mode;
+		uint32_t speedUp;
+		uint32_t seekTarget; // LBA set by Setloc
+		bool setlocPending; // seekTarget hasn't been used by a read or seek yet
+		uint32_t readLBA; // where the head is
+		bool motorOn;
+		bool reading;
+		bool seeking;
+		bool playing; // CD-DA, sectors go to Audio instead of the CPU
+		uint8_t filterFile; // only XA sectors from this file and channel are played, if mode bit 3 is set
+		uint8_t filterChannel;
+		cdAudio* Audio;
+		uint8_t pendingVolume[4]; // written to the volume registers, only used once they're applied
+		uint8_t sectorBuffer[SECTOR_SIZE];
+		uint8_t dataFifo[SECTOR_SIZE]; // what the CPU reads through register 2, loaded from sectorBuffer on request
+		uint32_t dataFifoSize;
+		uint32_t dataFifoIndex;
 
 		void writeCommandRegister(uint8_t value);
-};
\ No newline at end of file
+		void executeCommand(uint8_t command);
+		void finishCommand(uint8_t command);
+		void respondError(uint8_t error);
+		// These send an error response and return false if the command can't go ahead
+		bool checkParameterCount(uint8_t command, uint8_t count);
+		bool requireDisc(uint8_t command);
+		uint8_t getStatus();
+		void respond(uint8_t interrupt, std::initializer_list<uint8_t> bytes);
+		void respondStatus(uint8_t interrupt);
+		void deliverResponse(const cdromResponse& response);
+		void schedule(uint64_t delay, cdromEventType type, uint8_t command);
+		void cancelEvents(cdromEventType type);
+		uint64_t sectorCycles();
+		uint64_t seekCycles(uint32_t from, uint32_t to);
+		void startReading(bool play);
+		void stopReading();
+		void deliverSector();
+		bool sectorInterruptPending();
+		bool handleAudioSector();
+		void loadDataFifo();
+		uint64_t now();
+};
@@ -0,0 +1,740 @@
+#include "chd.hpp"
+#include "decompress.hpp"
+#include "ecc.hpp"
+#include <algorithm>
+
+#define CHD_V5_HEADER_SIZE 124
+#define CHD_MAP_ENTRY_RAW_SIZE 12
+#define CHD_TRACK_PADDING 4 // every track is padded to a multiple of 4 frames
+
+#define CHD_CODEC_ZLIB 0x7A6C6962 // "zlib"
+#define CHD_CODEC_LZMA 0x6C7A6D61 // "lzma"
+#define CHD_CODEC_CD_ZLIB 0x63647A6C // "cdzl"
+#define CHD_CODEC_CD_LZMA 0x63646C7A // "cdlz"
+
+#define CHD_META_TRACK 0x43485452 // "CHTR"
+#define CHD_META_TRACK2 0x43485432 // "CHT2"
+
+// Map compression types, before they're simplified into chdHunkType
+enum class chdMapCode : uint8_t
+{
+	Codec0 = 0, Codec1 = 1, Codec2 = 2, Codec3 = 3,
+	None = 4,
+	Self = 5,
+	Parent = 6,
+	RLESmall = 7,
+	RLELarge = 8,
+	Self0 = 9,
+	Self1 = 10,
+	ParentSelf = 11,
+	Parent0 = 12,
+	Parent1 = 13
+};
+
+static uint64_t readBigEndian(const uint8_t* data, uint32_t bytes)
+{
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < bytes; i++)
+	{
+		value = (value << 8) | data[i];
+	}
+	return value;
+}
+
+static std::string codecName(uint32_t codec)
+{
+	std::string name;
+	for (int shift = 24; shift >= 0; shift -= 8)
+	{
+		name += (char)((codec >> shift) & 0xFF);
+	}
+	return name;
+}
+
+// CRC-16/CCITT, used to check the decompressed map
+static uint16_t crc16(const uint8_t* data, size_t length)
+{
+	uint16_t crc = 0xFFFF;
+	for (size_t i = 0; i < length; i++)
+	{
+		crc ^= data[i] << 8;
+		for (int bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+// MSB first bit reader for the compressed map. Reading past the end gives zeroes.
+class chdBitReader
+{
+	public:
+		chdBitReader(const uint8_t* d, size_t length) { data = d; dataLength = length; pos = 0; buffer = 0; bits = 0; }
+		uint32_t peek(uint32_t count)
+		{
+			while (bits < count)
+			{
+				buffer |= ((uint64_t)((pos < dataLength) ? data[pos] : 0)) << (56 - bits);
+				pos++;
+				bits += 8;
+			}
+			return (uint32_t)(buffer >> (64 - count));
+		}
+		void remove(uint32_t count) { buffer <<= count; bits -= count; }
+		uint32_t read(uint32_t count)
+		{
+			if (count == 0) { return 0; }
+			uint32_t value = peek(count);
+			remove(count);
+			return value;
+		}
+		bool overrun() { return pos > dataLength + 8; }
+	private:
+		const uint8_t* data;
+		size_t dataLength;
+		size_t pos;
+		uint64_t buffer;
+		uint32_t bits;
+};
+
+// The map's compression types are Huffman coded with a 16 symbol, 8 bit max code stored as run length encoded code lengths
+class chdMapHuffman
+{
+	public:
+		bool importTree(chdBitReader& reader)
+		{
+			uint8_t lengths[16];
+			uint32_t node = 0;
+			while (node < 16)
+			{
+				uint32_t length = reader.read(4);
+				if (length != 1)
+				{
+					lengths[node++] = length;
+					continue;
+				}
+				length = reader.read(4);
+				if (length == 1)
+				{
+					lengths[node++] = length;
+					continue;
+				}
+				uint32_t repeat = reader.read(4) + 3;
+				if (node + repeat > 16) { return false; }
+				while (repeat--)
+				{
+					lengths[node++] = length;
+				}
+			}
+
+			// Canonical codes are handed out starting from the longest
+			uint32_t histogram[33] = {};
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				if (lengths[i] > 8) { return false; }
+				histogram[lengths[i]]++;
+			}
+			uint32_t start = 0;
+			for (uint32_t length = 32; length > 0; length--)
+			{
+				uint32_t next = (start + histogram[length]) >> 1;
+				if (length != 1 && next * 2 != start + histogram[length]) { return false; }
+				histogram[length] = start;
+				start = next;
+			}
+
+			memset(lookup, 0, sizeof(lookup));
+			for (uint32_t symbol = 0; symbol < 16; symbol++)
+			{
+				if (lengths[symbol] == 0) { continue; }
+				uint32_t code = histogram[lengths[symbol]]++;
+				uint32_t shift = 8 - lengths[symbol];
+				for (uint32_t i = code << shift; i < ((code + 1) << shift); i++)
+				{
+					lookup[i] = (uint16_t)((symbol << 4) | lengths[symbol]);
+				}
+			}
+			return true;
+		}
+
+		uint32_t decode(chdBitReader& reader)
+		{
+			uint16_t entry = lookup[reader.peek(8)];
+			reader.remove(entry & 0xF);
+			return entry >> 4;
+		}
+	private:
+		uint16_t lookup[256]; // symbol << 4 | code length
+};
+
+chdDisc::chdDisc(std::string path, uint32_t cacheMiB)
+{
+	file = new mappedFile(path);
+	stopping = false;
+	pinnedHunk = UINT32_MAX;
+	stats = { 0, 0, 0 };
+	readHeader(path);
+	checkCodecs();
+
+	maxHunks = std::max<uint32_t>(4, (uint32_t)(((uint64_t)cacheMiB * 1024 * 1024) / hunkBytes));
+	prefetchHunks = std::min<uint32_t>(16, maxHunks / 2);
+	uint32_t threadCount = std::min(std::max(std::thread::hardware_concurrency(), 2u) - 1, 4u);
+	for (uint32_t i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread(&chdDisc::workerThread, this));
+	}
+	logging::info("Loaded CHD with " + std::to_string(tracks.size()) + " tracks, " + std::to_string(maxHunks) + " hunk cache, " + std::to_string(threadCount) + " decompression threads", logging::logSource::CDROM);
+}
+
+chdDisc::~chdDisc()
+{
+	{
+		std::lock_guard<std::mutex> guard(cacheLock);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	logging::info("CHD: " + std::to_string(stats.hunkReads) + " hunk reads, " + std::to_string(stats.misses) + " misses, " + std::to_string(stats.prefetched) + " prefetched", logging::logSource::CDROM);
+	for (auto& entry : hunks)
+	{
+		delete(entry.second);
+	}
+	delete(file);
+}
+
+chdStats chdDisc::getStats()
+{
+	std::lock_guard<std::mutex> guard(cacheLock);
+	return stats;
+}
+
+void chdDisc::readHeader(std::string path)
+{
+	const uint8_t* header = file->getData();
+	if (file->getSize() < CHD_V5_HEADER_SIZE || memcmp(header, "MComprHD", 8) != 0)
+	{
+		logging::fatal("not a CHD file: " + path, logging::logSource::CDROM);
+	}
+	uint32_t version = (uint32_t)readBigEndian(header + 12, 4);
+	if (version != 5)
+	{
+		logging::fatal("only version 5 CHD files are supported (this is version " + std::to_string(version) + "): " + path, logging::logSource::CDROM);
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		codecs[i] = (uint32_t)readBigEndian(header + 16 + (i * 4), 4);
+	}
+	uint64_t logicalBytes = readBigEndian(header + 32, 8);
+	uint64_t mapOffset = readBigEndian(header + 40, 8);
+	uint64_t metaOffset = readBigEndian(header + 48, 8);
+	hunkBytes = (uint32_t)readBigEndian(header + 56, 4);
+	uint32_t unitBytes = (uint32_t)readBigEndian(header + 60, 4);
+	for (int i = 0; i < 20; i++)
+	{
+		if (header[104 + i] != 0)
+		{
+			logging::fatal("CHD files that depend on a parent aren't supported: " + path, logging::logSource::CDROM);
+		}
+	}
+	if (unitBytes != CHD_FRAME_SIZE || hunkBytes == 0 || (hunkBytes % CHD_FRAME_SIZE) != 0)
+	{
+		logging::fatal("CHD isn't a CD image: " + path, logging::logSource::CDROM);
+	}
+	framesPerHunk = hunkBytes / CHD_FRAME_SIZE;
+	hunkCount = (uint32_t)((logicalBytes + hunkBytes - 1) / hunkBytes);
+
+	readMap(mapOffset);
+	readTracks(metaOffset);
+}
+
+void chdDisc::readMap(uint64_t mapOffset)
+{
+	map.resize(hunkCount);
+	const uint8_t* data = file->getData();
+	uint64_t size = file->getSize();
+
+	if (codecs[0] == 0)
+	{
+		// Uncompressed CHDs just have a table of hunk positions
+		if (mapOffset + ((uint64_t)hunkCount * 4) > size)
+		{
+			logging::fatal("CHD map is truncated", logging::logSource::CDROM);
+		}
+		for (uint32_t i = 0; i < hunkCount; i++)
+		{
+			uint64_t offset = readBigEndian(data + mapOffset + (i * 4), 4) * hunkBytes;
+			map[i] = { (offset == 0) ? chdHunkType::Zero : chdHunkType::Uncompressed, hunkBytes, offset };
+		}
+		return;
+	}
+
+	if (mapOffset + 16 > size)
+	{
+		logging::fatal("CHD map is truncated", logging::logSource::CDROM);
+	}
+	const uint8_t* mapHeader = data + mapOffset;
+	uint32_t mapBytes = (uint32_t)readBigEndian(mapHeader, 4);
+	uint64_t firstOffset = readBigEndian(mapHeader + 4, 6);
+	uint16_t mapCRC = (uint16_t)readBigEndian(mapHeader + 10, 2);
+	uint8_t lengthBits = mapHeader[12];
+	uint8_t selfBits = mapHeader[13];
+	uint8_t parentBits = mapHeader[14];
+	if (mapOffset + 16 + mapBytes > size)
+	{
+		logging::fatal("CHD map is truncated", logging::logSource::CDROM);
+	}
+
+	chdBitReader reader(mapHeader + 16, mapBytes);
+	chdMapHuffman huffman;
+	if (!huffman.importTree(reader))
+	{
+		logging::fatal("CHD map has an invalid Huffman tree", logging::logSource::CDROM);
+	}
+
+	// First pass: compression type of every hunk, with runs of the same type run length encoded
+	std::vector<uint8_t> types(hunkCount);
+	uint8_t lastType = 0;
+	uint32_t repeat = 0;
+	for (uint32_t i = 0; i < hunkCount; i++)
+	{
+		if (repeat > 0)
+		{
+			types[i] = lastType;
+			repeat--;
+			continue;
+		}
+		uint32_t value = huffman.decode(reader);
+		if (value == (uint32_t)chdMapCode::RLESmall)
+		{
+			types[i] = lastType;
+			repeat = 2 + huffman.decode(reader);
+		}
+		else if (value == (uint32_t)chdMapCode::RLELarge)
+		{
+			types[i] = lastType;
+			repeat = 2 + 16 + (huffman.decode(reader) << 4);
+			repeat += huffman.decode(reader);
+		}
+		else
+		{
+			types[i] = lastType = (uint8_t)value;
+		}
+	}
+
+	// Second pass: lengths and offsets. The raw form is rebuilt as well because that's what the CRC covers.
+	std::vector<uint8_t> raw((size_t)hunkCount * CHD_MAP_ENTRY_RAW_SIZE);
+	uint64_t currentOffset = firstOffset;
+	uint64_t lastSelf = 0;
+	uint64_t lastParent = 0;
+	for (uint32_t i = 0; i < hunkCount; i++)
+	{
+		uint64_t offset = currentOffset;
+		uint32_t length = 0;
+		uint16_t crc = 0;
+		chdHunkType type = chdHunkType::Uncompressed;
+		switch ((chdMapCode)types[i])
+		{
+			case chdMapCode::Codec0: case chdMapCode::Codec1: case chdMapCode::Codec2: case chdMapCode::Codec3:
+			{
+				type = (chdHunkType)types[i];
+				length = reader.read(lengthBits);
+				currentOffset += length;
+				crc = (uint16_t)reader.read(16);
+				break;
+			}
+			case chdMapCode::None:
+			{
+				type = chdHunkType::Uncompressed;
+				length = hunkBytes;
+				currentOffset += length;
+				crc = (uint16_t)reader.read(16);
+				break;
+			}
+			case chdMapCode::Self:
+			{
+				type = chdHunkType::Self;
+				offset = lastSelf = reader.read(selfBits);
+				break;
+			}
+			case chdMapCode::Parent:
+			{
+				type = chdHunkType::Parent;
+				offset = lastParent = reader.read(parentBits);
+				break;
+			}
+			case chdMapCode::Self1:
+				lastSelf++;
+				// fall through
+			case chdMapCode::Self0:
+			{
+				type = chdHunkType::Self;
+				offset = lastSelf;
+				break;
+			}
+			case chdMapCode::ParentSelf:
+			{
+				type = chdHunkType::Parent;
+				offset = lastParent = ((uint64_t)i * hunkBytes) / CHD_FRAME_SIZE;
+				break;
+			}
+			case chdMapCode::Parent1:
+				lastParent += hunkBytes / CHD_FRAME_SIZE;
+				// fall through
+			case chdMapCode::Parent0:
+			{
+				type = chdHunkType::Parent;
+				offset = lastParent;
+				break;
+			}
+			default: logging::fatal("CHD map has an invalid compression type: " + std::to_string(types[i]), logging::logSource::CDROM); break;
+		}
+		map[i] = { type, length, offset };
+
+		uint8_t* entry = &raw[(size_t)i * CHD_MAP_ENTRY_RAW_SIZE];
+		entry[0] = (uint8_t)type;
+		for (int b = 0; b < 3; b++) { entry[1 + b] = (uint8_t)(length >> (16 - (b * 8))); }
+		for (int b = 0; b < 6; b++) { entry[4 + b] = (uint8_t)(offset >> (40 - (b * 8))); }
+		entry[10] = (uint8_t)(crc >> 8);
+		entry[11] = (uint8_t)crc;
+	}
+	if (reader.overrun() || crc16(raw.data(), raw.size()) != mapCRC)
+	{
+		logging::fatal("CHD map is corrupt", logging::logSource::CDROM);
+	}
+}
+
+void chdDisc::readTracks(uint64_t metaOffset)
+{
+	const uint8_t* data = file->getData();
+	uint64_t size = file->getSize();
+	uint32_t discPosition = 0;
+	uint64_t chdFrame = 0;
+
+	while (metaOffset != 0)
+	{
+		if (metaOffset + 16 > size)
+		{
+			logging::fatal("CHD metadata is truncated", logging::logSource::CDROM);
+		}
+		const uint8_t* entry = data + metaOffset;
+		uint32_t tag = (uint32_t)readBigEndian(entry, 4);
+		uint32_t length = (uint32_t)readBigEndian(entry + 5, 3);
+		uint64_t next = readBigEndian(entry + 8, 8);
+		if (metaOffset + 16 + length > size)
+		{
+			logging::fatal("CHD metadata is truncated", logging::logSource::CDROM);
+		}
+
+		if (tag == CHD_META_TRACK || tag == CHD_META_TRACK2)
+		{
+			// e.g. "TRACK:1 TYPE:MODE2_RAW SUBTYPE:NONE FRAMES:1234 PREGAP:150 PGTYPE:MODE2_RAW PGSUB:RW POSTGAP:0"
+			std::string text((const char*)entry + 16, length);
+			text = text.c_str(); // drop the terminating zero
+			std::map<std::string, std::string> fields;
+			std::stringstream stream(text);
+			std::string item;
+			while (stream >> item)
+			{
+				size_t colon = item.find(':');
+				if (colon != std::string::npos)
+				{
+					fields[item.substr(0, colon)] = item.substr(colon + 1);
+				}
+			}
+
+			discTrack track = {};
+			track.number = (uint8_t)std::stoul(fields["TRACK"]);
+			std::string type = fields["TYPE"];
+			if (type == "AUDIO") { track.type = trackType::Audio; track.sectorSize = SECTOR_SIZE; }
+			else if (type == "MODE1_RAW") { track.type = trackType::Mode1; track.sectorSize = SECTOR_SIZE; }
+			else if (type == "MODE2_RAW") { track.type = trackType::Mode2; track.sectorSize = SECTOR_SIZE; }
+			else if (type == "MODE1") { track.type = trackType::Mode1; track.sectorSize = SECTOR_USER_DATA_SIZE; }
+			else if (type == "MODE2_FORM1") { track.type = trackType::Mode2; track.sectorSize = SECTOR_USER_DATA_SIZE; }
+			else
+			{
+				logging::fatal("unsupported CHD track type: " + type, logging::logSource::CDROM);
+			}
+			uint32_t frames = (uint32_t)std::stoul(fields["FRAMES"]);
+			uint32_t pregap = fields.count("PREGAP") ? (uint32_t)std::stoul(fields["PREGAP"]) : 0;
+			bool pregapStored = fields.count("PGTYPE") && !fields["PGTYPE"].empty() && fields["PGTYPE"][0] == 'V';
+
+			// The pregap is either stored at the start of the track's frames, or is silence that isn't in the file at all
+			uint32_t gap = pregapStored ? 0 : pregap;
+			if (tracks.empty() && gap == 0 && !pregapStored)
+			{
+				gap = DISC_PREGAP_SECTORS;
+			}
+			track.fileIndex = 0;
+			track.fileOffset = chdFrame * CHD_FRAME_SIZE;
+			track.firstLBA = discPosition + gap;
+			track.indexOneLBA = track.firstLBA + (pregapStored ? pregap : 0);
+			track.sectorCount = frames;
+			tracks.push_back(track);
+
+			discPosition = track.firstLBA + frames;
+			chdFrame += ((frames + CHD_TRACK_PADDING - 1) / CHD_TRACK_PADDING) * CHD_TRACK_PADDING;
+		}
+		metaOffset = next;
+	}
+
+	if (tracks.empty())
+	{
+		logging::fatal("CHD has no CD track metadata", logging::logSource::CDROM);
+	}
+	std::sort(tracks.begin(), tracks.end(), [](const discTrack& a, const discTrack& b) { return a.number < b.number; });
+	leadOutLBA = discPosition;
+}
+
+// Refuse images that use codecs we can't decode up front, rather than when a game reads that hunk
+void chdDisc::checkCodecs()
+{
+	for (const chdMapEntry& entry : map)
+	{
+		if (entry.type == chdHunkType::Parent)
+		{
+			logging::fatal("CHD files that depend on a parent aren't supported", logging::logSource::CDROM);
+		}
+		if (entry.type <= chdHunkType::Codec3)
+		{
+			uint32_t codec = codecs[(uint32_t)entry.type];
+			if (codec != CHD_CODEC_ZLIB && codec != CHD_CODEC_LZMA && codec != CHD_CODEC_CD_ZLIB && codec != CHD_CODEC_CD_LZMA)
+			{
+				logging::fatal("unsupported CHD codec \"" + codecName(codec) + "\", recompress with: chdman createcd -c cdlz,cdzl", logging::logSource::CDROM);
+			}
+		}
+	}
+}
+
+void chdDisc::workerThread()
+{
+	std::unique_lock<std::mutex> guard(cacheLock);
+	while (true)
+	{
+		workAvailable.wait(guard, [this] { return stopping || !queue.empty(); });
+		if (stopping) { return; }
+		uint32_t hunk = queue.front();
+		queue.pop_front();
+		chdHunk* entry = hunks[hunk]; // pending hunks are never evicted
+
+		// logging::fatal can't be used here as it would end the thread, getHunk reports the error instead
+		std::string error;
+		guard.unlock();
+		decodeHunk(hunk, entry->data.data(), 0, error);
+		guard.lock();
+
+		entry->error = error;
+		entry->ready = true;
+		hunkReady.notify_all();
+	}
+}
+
+// Makes a pending cache entry for a hunk, evicting the least recently used finished hunks to stay in budget.
+// Called with cacheLock held.
+chdHunk* chdDisc::reserveHunk(uint32_t hunk)
+{
+	auto candidate = lru.end();
+	while (hunks.size() >= maxHunks && candidate != lru.begin())
+	{
+		candidate--;
+		chdHunk* old = hunks[*candidate];
+		if (!old->ready || *candidate == pinnedHunk) { continue; }
+		hunks.erase(*candidate);
+		delete(old);
+		candidate = lru.erase(candidate);
+	}
+
+	chdHunk* entry = new chdHunk();
+	entry->data.resize(hunkBytes);
+	entry->ready = false;
+	lru.push_front(hunk);
+	entry->lruPosition = lru.begin();
+	hunks[hunk] = entry;
+	return entry;
+}
+
+const uint8_t* chdDisc::getHunk(uint32_t hunk)
+{
+	std::unique_lock<std::mutex> guard(cacheLock);
+	chdHunk* entry;
+	auto found = hunks.find(hunk);
+	if (found != hunks.end() && found->second->ready)
+	{
+		entry = found->second;
+	}
+	else
+	{
+		stats.misses++;
+		if (found == hunks.end())
+		{
+			// Nobody is working on it, so decompressing it here is quicker than queueing it behind the prefetches
+			entry = reserveHunk(hunk);
+			std::string error;
+			guard.unlock();
+			decodeHunk(hunk, entry->data.data(), 0, error);
+			guard.lock();
+			entry->error = error;
+			entry->ready = true;
+			hunkReady.notify_all();
+		}
+		else
+		{
+			entry = found->second;
+			hunkReady.wait(guard, [entry] { return entry->ready; });
+		}
+	}
+	if (!entry->error.empty())
+	{
+		logging::fatal(entry->error, logging::logSource::CDROM);
+	}
+
+	if (hunk != pinnedHunk)
+	{
+		stats.hunkReads++;
+		pinnedHunk = hunk;
+		lru.splice(lru.begin(), lru, entry->lruPosition);
+
+		// Reads are nearly always sequential, so start on the next few hunks
+		bool queued = false;
+		for (uint32_t next = hunk + 1; next <= hunk + prefetchHunks && next < hunkCount; next++)
+		{
+			if (hunks.count(next) == 0)
+			{
+				reserveHunk(next);
+				queue.push_back(next);
+				stats.prefetched++;
+				queued = true;
+			}
+		}
+		if (queued)
+		{
+			workAvailable.notify_all();
+		}
+	}
+	return entry->data.data();
+}
+
+// Runs on the worker threads, so errors are returned rather than raised
+bool chdDisc::decodeHunk(uint32_t hunk, uint8_t* out, uint32_t depth, std::string& error)
+{
+	const chdMapEntry& entry = map[hunk];
+	const uint8_t* data = file->getData();
+	if (entry.type != chdHunkType::Self && entry.type != chdHunkType::Zero && entry.offset + entry.length > file->getSize())
+	{
+		error = "CHD hunk " + std::to_string(hunk) + " is past the end of the file";
+		return false;
+	}
+
+	bool ok = true;
+	switch (entry.type)
+	{
+		case chdHunkType::Codec0: case chdHunkType::Codec1: case chdHunkType::Codec2: case chdHunkType::Codec3:
+		{
+			uint32_t codec = codecs[(uint32_t)entry.type];
+			const uint8_t* src = data + entry.offset;
+			switch (codec)
+			{
+				case CHD_CODEC_ZLIB: ok = decompress::inflate(src, entry.length, out, hunkBytes); break;
+				case CHD_CODEC_LZMA: ok = decompress::lzma(src, entry.length, out, hunkBytes); break;
+				default: ok = decodeCD(codec, src, entry.length, out); break;
+			}
+			break;
+		}
+		case chdHunkType::Uncompressed: memcpy(out, data + entry.offset, hunkBytes); break;
+		case chdHunkType::Zero: memset(out, 0, hunkBytes); break;
+		case chdHunkType::Self:
+		{
+			if (entry.offset >= hunkCount || depth > 8)
+			{
+				ok = false;
+				break;
+			}
+			return decodeHunk((uint32_t)entry.offset, out, depth + 1, error);
+		}
+		default: ok = false; break;
+	}
+	if (!ok)
+	{
+		error = "CHD hunk " + std::to_string(hunk) + " is corrupt";
+	}
+	return ok;
+}
+
+// CD codecs compress the sector data and the subchannel data separately, then interleave them back into frames
+bool chdDisc::decodeCD(uint32_t codec, const uint8_t* src, uint32_t length, uint8_t* out)
+{
+	static const uint8_t sync[12] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+	uint32_t frames = framesPerHunk;
+	uint32_t lengthBytes = (hunkBytes < 65536) ? 2 : 3;
+	uint32_t eccBytes = (frames + 7) / 8; // one bit per frame saying the sync and ECC were stripped
+	uint32_t headerBytes = eccBytes + lengthBytes;
+	if (length < headerBytes) { return false; }
+	uint32_t baseLength = (uint32_t)readBigEndian(src + eccBytes, lengthBytes);
+	if (headerBytes + baseLength > length) { return false; }
+
+	std::vector<uint8_t> buffer((size_t)frames * CHD_FRAME_SIZE);
+	uint8_t* sectors = buffer.data();
+	uint8_t* subchannel = buffer.data() + ((size_t)frames * SECTOR_SIZE);
+	const uint8_t* base = src + headerBytes;
+	bool ok = (codec == CHD_CODEC_CD_LZMA) ?
+		decompress::lzma(base, baseLength, sectors, (size_t)frames * SECTOR_SIZE) :
+		decompress::inflate(base, baseLength, sectors, (size_t)frames * SECTOR_SIZE);
+	if (!ok) { return false; }
+	if (!decompress::inflate(base + baseLength, length - headerBytes - baseLength, subchannel, (size_t)frames * 96))
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		uint8_t* frame = out + ((size_t)i * CHD_FRAME_SIZE);
+		memcpy(frame, sectors + ((size_t)i * SECTOR_SIZE), SECTOR_SIZE);
+		memcpy(frame + SECTOR_SIZE, subchannel + ((size_t)i * 96), 96);
+		if (src[i / 8] & (1 << (i % 8)))
+		{
+			// The sync pattern and ECC were stripped because they can be recreated
+			memcpy(frame, sync, sizeof(sync));
+			sectorEcc::generateECC(frame);
+		}
+	}
+	return true;
+}
+
+const uint8_t* chdDisc::getFrame(const discTrack* track, uint32_t lba)
+{
+	uint64_t frame = (track->fileOffset / CHD_FRAME_SIZE) + (lba - track->firstLBA);
+	uint32_t hunk = (uint32_t)(frame / framesPerHunk);
+	if (hunk >= hunkCount) { return nullptr; }
+	return getHunk(hunk) + ((frame % framesPerHunk) * CHD_FRAME_SIZE);
+}
+
+const uint8_t* chdDisc::rawSector(const discTrack* track, uint32_t lba)
+{
+	// Audio is stored big endian, so that has to be built
+	if (track->sectorSize != SECTOR_SIZE || track->type == trackType::Audio) { return nullptr; }
+	return getFrame(track, lba);
+}
+
+void chdDisc::buildSector(const discTrack* track, uint32_t lba, uint8_t* out)
+{
+	const uint8_t* frame = (track != nullptr) ? getFrame(track, lba) : nullptr;
+	if (frame == nullptr)
+	{
+		memset(out, 0, SECTOR_SIZE);
+		return;
+	}
+	if (track->type == trackType::Audio)
+	{
+		for (uint32_t i = 0; i < SECTOR_SIZE; i += 2)
+		{
+			out[i] = frame[i + 1];
+			out[i + 1] = frame[i];
+		}
+		return;
+	}
+	buildCookedSector(track, lba, frame, out);
+}
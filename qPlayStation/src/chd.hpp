@@ -0,0 +1,87 @@
+#pragma once
+#include "helpers.hpp"
+#include "disc.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#define CHD_FRAME_SIZE 2448 // 2352 bytes of sector plus 96 of subchannel
+
+enum class chdHunkType : uint8_t
+{
+	Codec0 = 0, // compressed with one of the four codecs in the header
+	Codec1 = 1,
+	Codec2 = 2,
+	Codec3 = 3,
+	Uncompressed = 4,
+	Self = 5,	// same data as an earlier hunk
+	Parent = 6,	// data comes from a parent CHD, which we don't support
+	Zero = 7	// all zeroes (only used by uncompressed maps)
+};
+
+struct chdMapEntry
+{
+	chdHunkType type;
+	uint32_t length;
+	uint64_t offset; // file offset, or the hunk number for Self
+};
+
+struct chdHunk
+{
+	std::vector<uint8_t> data;
+	bool ready;	// false while a worker is still decompressing it
+	std::string error;	// why it couldn't be decompressed, reported by whichever thread reads it
+	std::list<uint32_t>::iterator lruPosition;
+};
+
+struct chdStats
+{
+	uint64_t hunkReads;
+	uint64_t misses;	// reads that had to wait for decompression
+	uint64_t prefetched;
+};
+
+// MAME compressed hunks of data (v5), as made by "chdman createcd".
+// Hunks are decompressed ahead of the read position on a pool of worker threads into an LRU cache,
+// so reads only block when they jump somewhere new.
+class chdDisc : public discImage
+{
+	public:
+		chdDisc(std::string path, uint32_t cacheMiB);
+		~chdDisc();
+		chdStats getStats();
+	private:
+		mappedFile* file;
+		uint32_t hunkBytes;
+		uint32_t framesPerHunk;
+		uint32_t hunkCount;
+		uint32_t codecs[4];
+		std::vector<chdMapEntry> map;
+
+		std::mutex cacheLock;
+		std::condition_variable workAvailable;
+		std::condition_variable hunkReady;
+		std::unordered_map<uint32_t, chdHunk*> hunks;
+		std::list<uint32_t> lru; // most recently used at the front
+		std::deque<uint32_t> queue;
+		std::vector<std::thread> workers;
+		uint32_t maxHunks;
+		uint32_t prefetchHunks;
+		uint32_t pinnedHunk; // the hunk the last returned sector points into, which can't be evicted
+		bool stopping;
+		chdStats stats;
+
+		void readHeader(std::string path);
+		void readMap(uint64_t mapOffset);
+		void readTracks(uint64_t metaOffset);
+		void checkCodecs();
+		void workerThread();
+		chdHunk* reserveHunk(uint32_t hunk);
+		const uint8_t* getHunk(uint32_t hunk);
+		bool decodeHunk(uint32_t hunk, uint8_t* out, uint32_t depth, std::string& error);
+		bool decodeCD(uint32_t codec, const uint8_t* src, uint32_t length, uint8_t* out);
+		const uint8_t* getFrame(const discTrack* track, uint32_t lba);
+		const uint8_t* rawSector(const discTrack* track, uint32_t lba);
+		void buildSector(const discTrack* track, uint32_t lba, uint8_t* out);
+};
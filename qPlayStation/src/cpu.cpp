@@ -30,6 +30,8 @@ void cpu::reset()
 	currentLoad = { 0, 0 };
 	is_branch = false;
 	delay_slot = false;
+	cycles = 0;
+	gteBusyUntil = 0;
 
 	GTE->reset();
 }
@@ -52,6 +54,20 @@ void cpu::updateInterruptRequest(bool interruptRequest)
 	cop0_cause |= ((uint32_t)interruptRequest) << 10;
 }
 
+uint64_t cpu::getCycles()
+{
+	return cycles;
+}
+
+// Reading a GTE register or starting another command while a command is still running stalls the CPU until it's done
+void cpu::waitForGTE()
+{
+	if (cycles < gteBusyUntil)
+	{
+		cycles = gteBusyUntil;
+	}
+}
+
 bool cpu::cacheIsolated()
 {
 	return (cop0_sr & 0x10000);
@@ -59,9 +75,16 @@ bool cpu::cacheIsolated()
 
 void cpu::step()
 {
-	if (pc == 0xBFC06FF0 && exeInfo.present)
+	if (pc == EXE_HOOK_ADDRESS && exeInfo.present)
 	{
+		// Loaded now rather than at startup, since the BIOS clears RAM while it boots
 		logging::info("Jumping to EXE", logging::logSource::CPU);
+		Memory->writeBlock(exeInfo.loadAddress, exeInfo.image.data(), (uint32_t)exeInfo.image.size());
+		if (exeInfo.bssSize > 0)
+		{
+			std::vector<uint8_t> zeroes(exeInfo.bssSize, 0);
+			Memory->writeBlock(exeInfo.bssAddress, zeroes.data(), exeInfo.bssSize);
+		}
 		pc = exeInfo.initialPC;
 		next_pc = pc + 4;
 		setReg(28, exeInfo.initialR28);
@@ -99,6 +122,7 @@ void cpu::step()
 	}
 
 	memcpy(in_regs, out_regs, sizeof(in_regs));
+	cycles++;
 }
 
 void cpu::executeInstr(uint32_t instr)
@@ -460,6 +484,7 @@ void cpu::op_cop2(uint32_t instr) // Coprocessor 2 Operation (GTE)
 		{
 			case 0x00: // MFC - Move from Coprocessor
 			{
+				waitForGTE();
 				currentLoad = {rt, GTE->readDR(rd)};
 				break;
 			}
@@ -470,6 +495,7 @@ void cpu::op_cop2(uint32_t instr) // Coprocessor 2 Operation (GTE)
 			}
 			case 0x02: // CFC - Move Control from Coprocessor
 			{
+				waitForGTE();
 				currentLoad = {rt, GTE->readCR(rd)};
 				break;
 			}
@@ -486,7 +512,9 @@ void cpu::op_cop2(uint32_t instr) // Coprocessor 2 Operation (GTE)
 			case 0x10: case 0x11: case 0x12: case 0x13: case 0x14: case 0x15: case 0x16: case 0x17:
 			case 0x18: case 0x19: case 0x1A: case 0x1B: case 0x1C: case 0x1D: case 0x1E: case 0x1F:
 			{
-				GTE->instruction(instr);
+				// instruction() returns how many cycles the command takes after the one spent issuing it
+				waitForGTE();
+				gteBusyUntil = cycles + 1 + GTE->instruction(instr);
 				break;
 			}
 			default: logging::fatal("Invalid GTE command: " + helpers::intToHex(instr), logging::logSource::CPU); break;
@@ -546,6 +574,7 @@ void cpu::op_swc2(uint32_t instr) // Store Word Coprocessor 2 (GTE)
 	}
 	else
 	{
+		waitForGTE();
 		Memory->set32(addr, GTE->readDR(decode_rt(instr)));
 	}
 }
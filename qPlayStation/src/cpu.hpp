@@ -2,14 +2,7 @@
 #include "helpers.hpp"
 #include "memory.hpp"
 #include "gte.hpp"
-
-struct EXEInfo
-{
-	bool present;
-	uint32_t initialPC;
-	uint32_t initialR28;
-	uint32_t initialR29R30;
-};
+#include "exe.hpp"
 
 struct pendingLoad
 {
@@ -39,6 +32,7 @@ class cpu
 		void reset();
 		void step();
 		void updateInterruptRequest(bool interruptRequest);
+		uint64_t getCycles();
 	private:
 		gte* GTE;
 		memory* Memory;
@@ -56,7 +50,10 @@ class cpu
 		uint32_t cop0_sr;
 		uint32_t cop0_cause;
 		uint32_t cop0_epc;
+		uint64_t cycles; // every instruction costs one cycle, plus any time spent stalled on the GTE
+		uint64_t gteBusyUntil; // cycle count when the last GTE command finishes
 		bool cacheIsolated();
+		void waitForGTE();
 		void executeInstr(uint32_t instr);
 		void setReg(int index, uint32_t value);
 		uint32_t getReg(int index);
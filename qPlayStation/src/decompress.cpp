@@ -0,0 +1,554 @@
+#include "decompress.hpp"
+#include <algorithm>
+
+// ---- Deflate ----
+// Based on the layout of zlib's "puff" reference decoder: canonical Huffman codes decoded from counts and sorted symbols.
+
+namespace
+{
+	struct inflateState
+	{
+		const uint8_t* src;
+		size_t srcLength;
+		size_t srcPos;
+		uint32_t bitBuffer;
+		uint32_t bitCount;
+		uint8_t* dst;
+		size_t dstLength;
+		size_t dstPos;
+		bool overrun;
+	};
+
+	struct huffmanTable
+	{
+		uint16_t counts[16]; // number of codes of each length
+		uint16_t symbols[288]; // symbols ordered by code
+	};
+
+	const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	uint32_t getBits(inflateState& s, uint32_t count)
+	{
+		while (s.bitCount < count)
+		{
+			uint32_t byte = 0;
+			if (s.srcPos < s.srcLength)
+			{
+				byte = s.src[s.srcPos++];
+			}
+			else
+			{
+				s.overrun = true;
+			}
+			s.bitBuffer |= byte << s.bitCount;
+			s.bitCount += 8;
+		}
+		uint32_t value = s.bitBuffer & ((1u << count) - 1);
+		s.bitBuffer >>= count;
+		s.bitCount -= count;
+		return value;
+	}
+
+	// Returns false if the lengths don't make a usable code
+	bool buildTable(huffmanTable& table, const uint8_t* lengths, uint32_t count)
+	{
+		uint16_t offsets[16];
+		memset(table.counts, 0, sizeof(table.counts));
+		for (uint32_t i = 0; i < count; i++)
+		{
+			table.counts[lengths[i]]++;
+		}
+		if (table.counts[0] == count) { return true; } // no codes, only an error if something tries to use it
+
+		int32_t left = 1;
+		for (uint32_t length = 1; length < 16; length++)
+		{
+			left <<= 1;
+			left -= table.counts[length];
+			if (left < 0) { return false; } // over subscribed
+		}
+
+		offsets[1] = 0;
+		for (uint32_t length = 1; length < 15; length++)
+		{
+			offsets[length + 1] = offsets[length] + table.counts[length];
+		}
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (lengths[i] != 0)
+			{
+				table.symbols[offsets[lengths[i]]++] = (uint16_t)i;
+			}
+		}
+		return true;
+	}
+
+	int32_t decodeSymbol(inflateState& s, const huffmanTable& table)
+	{
+		int32_t code = 0;
+		int32_t first = 0;
+		int32_t index = 0;
+		for (uint32_t length = 1; length < 16; length++)
+		{
+			code |= getBits(s, 1);
+			int32_t count = table.counts[length];
+			if (code - first < count)
+			{
+				return table.symbols[index + (code - first)];
+			}
+			index += count;
+			first += count;
+			first <<= 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+
+	bool inflateCodes(inflateState& s, const huffmanTable& lengthCodes, const huffmanTable& distanceCodes)
+	{
+		while (true)
+		{
+			int32_t symbol = decodeSymbol(s, lengthCodes);
+			if (symbol < 0 || s.overrun) { return false; }
+			if (symbol < 256)
+			{
+				if (s.dstPos >= s.dstLength) { return false; }
+				s.dst[s.dstPos++] = (uint8_t)symbol;
+			}
+			else if (symbol == 256)
+			{
+				return true;
+			}
+			else
+			{
+				symbol -= 257;
+				if (symbol >= 29) { return false; }
+				uint32_t length = lengthBase[symbol] + getBits(s, lengthExtra[symbol]);
+				int32_t distanceSymbol = decodeSymbol(s, distanceCodes);
+				if (distanceSymbol < 0 || distanceSymbol >= 30) { return false; }
+				uint32_t distance = distanceBase[distanceSymbol] + getBits(s, distanceExtra[distanceSymbol]);
+				if (distance > s.dstPos || length > s.dstLength - s.dstPos) { return false; }
+				uint8_t* out = s.dst + s.dstPos;
+				const uint8_t* from = out - distance;
+				for (uint32_t i = 0; i < length; i++) // byte at a time because the copy can overlap itself
+				{
+					out[i] = from[i];
+				}
+				s.dstPos += length;
+			}
+		}
+	}
+
+	bool inflateStored(inflateState& s)
+	{
+		// Stored blocks start on a byte boundary
+		s.bitBuffer = 0;
+		s.bitCount = 0;
+		if (s.srcPos + 4 > s.srcLength) { return false; }
+		uint32_t length = s.src[s.srcPos] | (s.src[s.srcPos + 1] << 8);
+		uint32_t check = s.src[s.srcPos + 2] | (s.src[s.srcPos + 3] << 8);
+		s.srcPos += 4;
+		if (length != (~check & 0xFFFF)) { return false; }
+		if (s.srcPos + length > s.srcLength || s.dstPos + length > s.dstLength) { return false; }
+		memcpy(s.dst + s.dstPos, s.src + s.srcPos, length);
+		s.srcPos += length;
+		s.dstPos += length;
+		return true;
+	}
+
+	struct fixedTables
+	{
+		huffmanTable lengthCodes;
+		huffmanTable distanceCodes;
+
+		fixedTables()
+		{
+			uint8_t lengths[288];
+			uint32_t i = 0;
+			for (; i < 144; i++) { lengths[i] = 8; }
+			for (; i < 256; i++) { lengths[i] = 9; }
+			for (; i < 280; i++) { lengths[i] = 7; }
+			for (; i < 288; i++) { lengths[i] = 8; }
+			buildTable(lengthCodes, lengths, 288);
+			for (i = 0; i < 30; i++) { lengths[i] = 5; }
+			buildTable(distanceCodes, lengths, 30);
+		}
+	};
+
+	bool inflateFixed(inflateState& s)
+	{
+		static const fixedTables tables; // static init is thread safe, and disc images decompress on several threads
+		return inflateCodes(s, tables.lengthCodes, tables.distanceCodes);
+	}
+
+	bool inflateDynamic(inflateState& s)
+	{
+		uint32_t lengthCount = getBits(s, 5) + 257;
+		uint32_t distanceCount = getBits(s, 5) + 1;
+		uint32_t codeLengthCount = getBits(s, 4) + 4;
+		if (lengthCount > 286 || distanceCount > 30) { return false; }
+
+		uint8_t lengths[286 + 30] = {};
+		for (uint32_t i = 0; i < codeLengthCount; i++)
+		{
+			lengths[codeLengthOrder[i]] = (uint8_t)getBits(s, 3);
+		}
+		huffmanTable codeLengthCodes;
+		if (!buildTable(codeLengthCodes, lengths, 19)) { return false; }
+
+		uint32_t index = 0;
+		memset(lengths, 0, sizeof(lengths));
+		while (index < lengthCount + distanceCount)
+		{
+			int32_t symbol = decodeSymbol(s, codeLengthCodes);
+			if (symbol < 0 || s.overrun) { return false; }
+			if (symbol < 16)
+			{
+				lengths[index++] = (uint8_t)symbol;
+				continue;
+			}
+			uint8_t repeated = 0;
+			uint32_t repeat;
+			if (symbol == 16)
+			{
+				if (index == 0) { return false; }
+				repeated = lengths[index - 1];
+				repeat = 3 + getBits(s, 2);
+			}
+			else if (symbol == 17)
+			{
+				repeat = 3 + getBits(s, 3);
+			}
+			else
+			{
+				repeat = 11 + getBits(s, 7);
+			}
+			if (index + repeat > lengthCount + distanceCount) { return false; }
+			while (repeat--)
+			{
+				lengths[index++] = repeated;
+			}
+		}
+		if (lengths[256] == 0) { return false; } // no end of block code
+
+		huffmanTable lengthCodes;
+		huffmanTable distanceCodes;
+		if (!buildTable(lengthCodes, lengths, lengthCount)) { return false; }
+		if (!buildTable(distanceCodes, lengths + lengthCount, distanceCount)) { return false; }
+		return inflateCodes(s, lengthCodes, distanceCodes);
+	}
+}
+
+bool decompress::inflate(const uint8_t* src, size_t srcLength, uint8_t* dst, size_t dstLength)
+{
+	inflateState s = { src, srcLength, 0, 0, 0, dst, dstLength, 0, false };
+	bool last = false;
+	while (!last)
+	{
+		last = getBits(s, 1);
+		bool ok = false;
+		switch (getBits(s, 2))
+		{
+			case 0: ok = inflateStored(s); break;
+			case 1: ok = inflateFixed(s); break;
+			case 2: ok = inflateDynamic(s); break;
+		}
+		if (!ok || s.overrun) { return false; }
+	}
+	return s.dstPos == dstLength;
+}
+
+// ---- LZMA ----
+// Follows the structure of LzmaSpec.cpp from the LZMA SDK. The whole output buffer is the dictionary.
+
+namespace
+{
+	const uint32_t lzmaLC = 3;
+	const uint32_t lzmaLP = 0;
+	const uint32_t lzmaPB = 2;
+	const uint32_t lzmaStates = 12;
+	const uint32_t lzmaPosBitsMax = 4;
+	const uint32_t lzmaLenToPosStates = 4;
+	const uint32_t lzmaAlignBits = 4;
+	const uint32_t lzmaEndPosModelIndex = 14;
+	const uint32_t lzmaFullDistances = 1 << (lzmaEndPosModelIndex >> 1);
+	const uint32_t lzmaMatchMinLength = 2;
+
+	typedef uint16_t lzmaProb;
+
+	class rangeDecoder
+	{
+		public:
+			rangeDecoder(const uint8_t* s, size_t length)
+			{
+				src = s;
+				srcLength = length;
+				srcPos = 0;
+				range = 0xFFFFFFFF;
+				code = 0;
+				corrupted = readByte() != 0;
+				for (int i = 0; i < 4; i++)
+				{
+					code = (code << 8) | readByte();
+				}
+				if (code == range) { corrupted = true; }
+			}
+
+			uint32_t decodeBit(lzmaProb* prob)
+			{
+				uint32_t value = *prob;
+				uint32_t bound = (range >> 11) * value;
+				uint32_t bit;
+				if (code < bound)
+				{
+					value += ((1 << 11) - value) >> 5;
+					range = bound;
+					bit = 0;
+				}
+				else
+				{
+					value -= value >> 5;
+					code -= bound;
+					range -= bound;
+					bit = 1;
+				}
+				*prob = (lzmaProb)value;
+				normalise();
+				return bit;
+			}
+
+			uint32_t decodeDirectBits(uint32_t count)
+			{
+				uint32_t result = 0;
+				do
+				{
+					range >>= 1;
+					code -= range;
+					uint32_t t = 0 - (code >> 31);
+					code += range & t;
+					if (code == range) { corrupted = true; }
+					normalise();
+					result = (result << 1) + (t + 1);
+				} while (--count);
+				return result;
+			}
+
+			uint32_t bitTree(lzmaProb* probs, uint32_t bits)
+			{
+				uint32_t m = 1;
+				for (uint32_t i = 0; i < bits; i++)
+				{
+					m = (m << 1) + decodeBit(&probs[m]);
+				}
+				return m - (1 << bits);
+			}
+
+			uint32_t bitTreeReverse(lzmaProb* probs, uint32_t bits)
+			{
+				uint32_t m = 1;
+				uint32_t symbol = 0;
+				for (uint32_t i = 0; i < bits; i++)
+				{
+					uint32_t bit = decodeBit(&probs[m]);
+					m = (m << 1) + bit;
+					symbol |= bit << i;
+				}
+				return symbol;
+			}
+
+			bool corrupted;
+			bool overrun() { return srcPos > srcLength; }
+		private:
+			const uint8_t* src;
+			size_t srcLength;
+			size_t srcPos;
+			uint32_t range;
+			uint32_t code;
+
+			uint8_t readByte()
+			{
+				if (srcPos >= srcLength)
+				{
+					srcPos = srcLength + 1;
+					return 0;
+				}
+				return src[srcPos++];
+			}
+
+			void normalise()
+			{
+				if (range < (1u << 24))
+				{
+					range <<= 8;
+					code = (code << 8) | readByte();
+				}
+			}
+	};
+
+	struct lengthDecoder
+	{
+		lzmaProb choice;
+		lzmaProb choice2;
+		lzmaProb low[1 << lzmaPosBitsMax][1 << 3];
+		lzmaProb mid[1 << lzmaPosBitsMax][1 << 3];
+		lzmaProb high[1 << 8];
+
+		uint32_t decode(rangeDecoder& rc, uint32_t posState)
+		{
+			if (rc.decodeBit(&choice) == 0) { return rc.bitTree(low[posState], 3); }
+			if (rc.decodeBit(&choice2) == 0) { return 8 + rc.bitTree(mid[posState], 3); }
+			return 16 + rc.bitTree(high, 8);
+		}
+	};
+
+	// Everything starts at a probability of one half
+	struct lzmaModel
+	{
+		lzmaProb literals[0x300 << (lzmaLC + lzmaLP)];
+		lzmaProb posSlot[lzmaLenToPosStates][1 << 6];
+		lzmaProb posDecoders[1 + lzmaFullDistances - lzmaEndPosModelIndex];
+		lzmaProb align[1 << lzmaAlignBits];
+		lzmaProb isMatch[lzmaStates << lzmaPosBitsMax];
+		lzmaProb isRep[lzmaStates];
+		lzmaProb isRepG0[lzmaStates];
+		lzmaProb isRepG1[lzmaStates];
+		lzmaProb isRepG2[lzmaStates];
+		lzmaProb isRep0Long[lzmaStates << lzmaPosBitsMax];
+		lengthDecoder lengths;
+		lengthDecoder repLengths;
+	};
+}
+
+bool decompress::lzma(const uint8_t* src, size_t srcLength, uint8_t* dst, size_t dstLength)
+{
+	static_assert(sizeof(lzmaModel) % sizeof(lzmaProb) == 0, "LZMA model must be all probabilities");
+	std::vector<lzmaProb> modelStorage(sizeof(lzmaModel) / sizeof(lzmaProb), 1 << 10);
+	lzmaModel& model = *(lzmaModel*)modelStorage.data();
+
+	rangeDecoder rc(src, srcLength);
+	uint32_t rep0 = 0, rep1 = 0, rep2 = 0, rep3 = 0;
+	uint32_t state = 0;
+	size_t pos = 0;
+
+	while (pos < dstLength)
+	{
+		if (rc.corrupted || rc.overrun()) { return false; }
+		uint32_t posState = pos & ((1 << lzmaPB) - 1);
+
+		if (rc.decodeBit(&model.isMatch[(state << lzmaPosBitsMax) + posState]) == 0)
+		{
+			uint32_t previous = (pos > 0) ? dst[pos - 1] : 0;
+			uint32_t literalState = ((pos & ((1 << lzmaLP) - 1)) << lzmaLC) + (previous >> (8 - lzmaLC));
+			lzmaProb* probs = &model.literals[0x300 * literalState];
+			uint32_t symbol = 1;
+			if (state >= 7)
+			{
+				// After a match the literal is coded relative to the byte the match would have given
+				if (rep0 + 1 > pos) { return false; }
+				uint32_t matchByte = dst[pos - rep0 - 1];
+				do
+				{
+					uint32_t matchBit = (matchByte >> 7) & 1;
+					matchByte <<= 1;
+					uint32_t bit = rc.decodeBit(&probs[((1 + matchBit) << 8) + symbol]);
+					symbol = (symbol << 1) | bit;
+					if (matchBit != bit) { break; }
+				} while (symbol < 0x100);
+			}
+			while (symbol < 0x100)
+			{
+				symbol = (symbol << 1) | rc.decodeBit(&probs[symbol]);
+			}
+			dst[pos++] = (uint8_t)(symbol - 0x100);
+			state = (state < 4) ? 0 : ((state < 10) ? state - 3 : state - 6);
+			continue;
+		}
+
+		uint32_t length;
+		if (rc.decodeBit(&model.isRep[state]) != 0)
+		{
+			if (pos == 0) { return false; }
+			if (rc.decodeBit(&model.isRepG0[state]) == 0)
+			{
+				if (rc.decodeBit(&model.isRep0Long[(state << lzmaPosBitsMax) + posState]) == 0)
+				{
+					// Short rep: a single byte from rep0
+					state = (state < 7) ? 9 : 11;
+					if (rep0 + 1 > pos) { return false; }
+					dst[pos] = dst[pos - rep0 - 1];
+					pos++;
+					continue;
+				}
+			}
+			else
+			{
+				uint32_t distance;
+				if (rc.decodeBit(&model.isRepG1[state]) == 0)
+				{
+					distance = rep1;
+				}
+				else
+				{
+					if (rc.decodeBit(&model.isRepG2[state]) == 0)
+					{
+						distance = rep2;
+					}
+					else
+					{
+						distance = rep3;
+						rep3 = rep2;
+					}
+					rep2 = rep1;
+				}
+				rep1 = rep0;
+				rep0 = distance;
+			}
+			length = model.repLengths.decode(rc, posState);
+			state = (state < 7) ? 8 : 11;
+		}
+		else
+		{
+			rep3 = rep2;
+			rep2 = rep1;
+			rep1 = rep0;
+			length = model.lengths.decode(rc, posState);
+			state = (state < 7) ? 7 : 10;
+
+			uint32_t lengthState = std::min(length, lzmaLenToPosStates - 1);
+			uint32_t slot = rc.bitTree(model.posSlot[lengthState], 6);
+			if (slot < 4)
+			{
+				rep0 = slot;
+			}
+			else
+			{
+				uint32_t directBits = (slot >> 1) - 1;
+				uint32_t distance = (2 | (slot & 1)) << directBits;
+				if (slot < lzmaEndPosModelIndex)
+				{
+					distance += rc.bitTreeReverse(&model.posDecoders[distance - slot], directBits);
+				}
+				else
+				{
+					distance += rc.decodeDirectBits(directBits - lzmaAlignBits) << lzmaAlignBits;
+					distance += rc.bitTreeReverse(model.align, lzmaAlignBits);
+				}
+				rep0 = distance;
+			}
+			if (rep0 == 0xFFFFFFFF) { break; } // end marker
+		}
+
+		length += lzmaMatchMinLength;
+		if (rep0 + 1 > pos || length > dstLength - pos) { return false; }
+		for (uint32_t i = 0; i < length; i++) // byte at a time because the copy can overlap itself
+		{
+			dst[pos] = dst[pos - rep0 - 1];
+			pos++;
+		}
+	}
+	return pos == dstLength && !rc.corrupted;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "helpers.hpp"
+
+// Just enough decompression for compressed disc images. Both decode a whole buffer whose
+// uncompressed size is already known, and return false if the data is corrupt or the wrong size.
+class decompress
+{
+	private:
+		decompress() {} //private constructor means no instances of this object can be created
+	public:
+		// Raw deflate stream (no zlib or gzip header)
+		static bool inflate(const uint8_t* src, size_t srcLength, uint8_t* dst, size_t dstLength);
+		// Raw LZMA stream (no header) with the default lc=3, lp=0, pb=2 properties
+		static bool lzma(const uint8_t* src, size_t srcLength, uint8_t* dst, size_t dstLength);
+};
@@ -0,0 +1,424 @@
+#include "disc.hpp"
+#include "chd.hpp"
+#include "ecc.hpp"
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const uint8_t sectorSync[12] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+
+#ifdef _WIN32
+mappedFile::mappedFile(std::string path)
+{
+	data = nullptr;
+	size = 0;
+	mappingHandle = NULL;
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		logging::fatal("unable to open disc image file: " + path, logging::logSource::CDROM);
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(fileHandle, &fileSize);
+	size = fileSize.QuadPart;
+	if (size == 0)
+	{
+		logging::fatal("disc image file is empty: " + path, logging::logSource::CDROM);
+	}
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle != NULL)
+	{
+		data = (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (data == nullptr)
+	{
+		logging::fatal("unable to map disc image file: " + path, logging::logSource::CDROM);
+	}
+}
+
+mappedFile::~mappedFile()
+{
+	if (data != nullptr) { UnmapViewOfFile(data); }
+	if (mappingHandle != NULL) { CloseHandle(mappingHandle); }
+	if (fileHandle != INVALID_HANDLE_VALUE) { CloseHandle(fileHandle); }
+}
+#else
+mappedFile::mappedFile(std::string path)
+{
+	data = nullptr;
+	size = 0;
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		logging::fatal("unable to open disc image file: " + path, logging::logSource::CDROM);
+	}
+	struct stat info;
+	fstat(fd, &info);
+	size = info.st_size;
+	if (size == 0)
+	{
+		close(fd);
+		logging::fatal("disc image file is empty: " + path, logging::logSource::CDROM);
+	}
+	void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping keeps the file open
+	if (mapping == MAP_FAILED)
+	{
+		logging::fatal("unable to map disc image file: " + path, logging::logSource::CDROM);
+	}
+	data = (const uint8_t*)mapping;
+}
+
+mappedFile::~mappedFile()
+{
+	if (data != nullptr) { munmap((void*)data, size); }
+}
+#endif
+
+sectorCache::sectorCache(uint32_t slots)
+{
+	slotCount = slots;
+	data.resize((size_t)slots * SECTOR_SIZE);
+	stats = { 0, 0 };
+}
+
+uint8_t* sectorCache::lookup(uint32_t lba)
+{
+	auto it = slotForLBA.find(lba);
+	if (it == slotForLBA.end())
+	{
+		stats.misses++;
+		return nullptr;
+	}
+	stats.hits++;
+	lru.splice(lru.begin(), lru, it->second.first);
+	return &data[(size_t)it->second.second * SECTOR_SIZE];
+}
+
+// Only call this after lookup() misses
+uint8_t* sectorCache::insert(uint32_t lba)
+{
+	uint32_t slot;
+	if (slotForLBA.size() < slotCount)
+	{
+		slot = (uint32_t)slotForLBA.size();
+	}
+	else
+	{
+		uint32_t oldest = lru.back();
+		lru.pop_back();
+		slot = slotForLBA[oldest].second;
+		slotForLBA.erase(oldest);
+	}
+	lru.push_front(lba);
+	slotForLBA[lba] = { lru.begin(), slot };
+	return &data[(size_t)slot * SECTOR_SIZE];
+}
+
+void sectorCache::clear()
+{
+	lru.clear();
+	slotForLBA.clear();
+}
+
+discImage* discImage::open(std::string path, uint32_t chdCacheMiB)
+{
+	std::string extension = path.substr(path.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	if (extension == "cue" || extension == "bin" || extension == "iso")
+	{
+		return new binCueDisc(path);
+	}
+	if (extension == "chd")
+	{
+		return new chdDisc(path, chdCacheMiB);
+	}
+	logging::fatal("unsupported disc image format: " + path, logging::logSource::CDROM);
+	return nullptr;
+}
+
+const discTrack* discImage::findTrack(uint32_t lba)
+{
+	for (const discTrack& track : tracks)
+	{
+		if (lba >= track.firstLBA && lba < track.firstLBA + track.sectorCount)
+		{
+			return &track;
+		}
+	}
+	return nullptr;
+}
+
+const uint8_t* discImage::getSector(uint32_t lba)
+{
+	const discTrack* track = findTrack(lba);
+	if (track != nullptr)
+	{
+		const uint8_t* raw = rawSector(track, lba);
+		if (raw != nullptr) { return raw; }
+	}
+
+	uint8_t* sector = cache.lookup(lba);
+	if (sector == nullptr)
+	{
+		sector = cache.insert(lba);
+		buildSector(track, lba, sector);
+	}
+	return sector;
+}
+
+const uint8_t* discImage::getUserData(uint32_t lba)
+{
+	const uint8_t* sector = getSector(lba);
+	// Mode 2 has an 8 byte subheader before the data
+	return sector + ((sector[15] == 2) ? 24 : 16);
+}
+
+void discImage::buildHeader(const discTrack* track, uint32_t lba, uint8_t* out)
+{
+	msf position = lbaToMSF(lba);
+	memcpy(out, sectorSync, sizeof(sectorSync));
+	out[12] = toBCD(position.minute);
+	out[13] = toBCD(position.second);
+	out[14] = toBCD(position.frame);
+	out[15] = (track->type == trackType::Mode1) ? 1 : 2;
+}
+
+void discImage::buildCookedSector(const discTrack* track, uint32_t lba, const uint8_t* userData, uint8_t* out)
+{
+	memset(out, 0, SECTOR_SIZE);
+	buildHeader(track, lba, out);
+	if (track->type == trackType::Mode1)
+	{
+		memcpy(out + 16, userData, SECTOR_USER_DATA_SIZE);
+	}
+	else
+	{
+		// Mode 2 Form 1 has an 8 byte subheader first, the submode (stored twice) just says it's data
+		out[18] = 0x08;
+		out[22] = 0x08;
+		memcpy(out + 24, userData, SECTOR_USER_DATA_SIZE);
+	}
+	// Some copy protection and ReadS with whole sectors look at these, so they have to be right
+	sectorEcc::generate(out);
+}
+
+binCueDisc::binCueDisc(std::string path)
+{
+	std::string extension = path.substr(path.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	if (extension == "cue")
+	{
+		parseCue(path);
+	}
+	else if (extension == "iso")
+	{
+		addSingleBin(path, SECTOR_USER_DATA_SIZE); // only the user data of each sector, the rest is rebuilt when read
+	}
+	else
+	{
+		addSingleBin(path, SECTOR_SIZE);
+	}
+	logging::info("Loaded disc image with " + std::to_string(tracks.size()) + " tracks", logging::logSource::CDROM);
+}
+
+binCueDisc::~binCueDisc()
+{
+	for (mappedFile* file : files)
+	{
+		delete(file);
+	}
+}
+
+void binCueDisc::addSingleBin(std::string path, uint32_t sectorSize)
+{
+	files.push_back(new mappedFile(path));
+	discTrack track = { 1, trackType::Mode2, sectorSize, 0, 0, DISC_PREGAP_SECTORS, DISC_PREGAP_SECTORS, (uint32_t)(files[0]->getSize() / sectorSize) };
+	tracks.push_back(track);
+	leadOutLBA = track.firstLBA + track.sectorCount;
+}
+
+struct cueTrack
+{
+	discTrack track;
+	int32_t index0;	// frames from the start of the file, -1 if not given
+	int32_t index1;
+	uint32_t pregap;	// silence that isn't stored in the file
+};
+
+static uint32_t parseCueMSF(std::string text, std::string cuePath)
+{
+	uint32_t minute, second, frame;
+	char colon1, colon2;
+	std::stringstream stream(text);
+	if (!(stream >> minute >> colon1 >> second >> colon2 >> frame) || colon1 != ':' || colon2 != ':')
+	{
+		logging::fatal("invalid time " + text + " in cue sheet: " + cuePath, logging::logSource::CDROM);
+	}
+	return discImage::msfToLBA({ (uint8_t)minute, (uint8_t)second, (uint8_t)frame });
+}
+
+void binCueDisc::parseCue(std::string path)
+{
+	std::ifstream cue(path);
+	if (!cue.is_open())
+	{
+		logging::fatal("unable to open cue sheet: " + path, logging::logSource::CDROM);
+	}
+	size_t slash = path.find_last_of("/\\");
+	std::string directory = (slash == std::string::npos) ? "" : path.substr(0, slash + 1);
+
+	std::vector<cueTrack> cueTracks;
+	std::string line;
+	while (std::getline(cue, line))
+	{
+		std::stringstream stream(line);
+		std::string command;
+		stream >> command;
+		std::transform(command.begin(), command.end(), command.begin(), ::toupper);
+
+		if (command == "FILE")
+		{
+			// The name is usually quoted and can have spaces in it
+			std::string rest;
+			std::getline(stream, rest);
+			size_t open = rest.find('"');
+			size_t close = rest.rfind('"');
+			std::string name;
+			std::string type;
+			if (open != std::string::npos && close > open)
+			{
+				name = rest.substr(open + 1, close - open - 1);
+				std::stringstream(rest.substr(close + 1)) >> type;
+			}
+			else
+			{
+				std::stringstream(rest) >> name >> type;
+			}
+			if (type != "BINARY")
+			{
+				logging::fatal("unsupported cue FILE type " + type + " in " + path, logging::logSource::CDROM);
+			}
+			files.push_back(new mappedFile(directory + name));
+		}
+		else if (command == "TRACK")
+		{
+			if (files.empty())
+			{
+				logging::fatal("TRACK before FILE in cue sheet: " + path, logging::logSource::CDROM);
+			}
+			uint32_t number;
+			std::string mode;
+			stream >> number >> mode;
+			cueTrack entry = {};
+			entry.track.number = (uint8_t)number;
+			entry.track.fileIndex = (uint32_t)files.size() - 1;
+			entry.index0 = -1;
+			entry.index1 = -1;
+			if (mode == "AUDIO") { entry.track.type = trackType::Audio; entry.track.sectorSize = SECTOR_SIZE; }
+			else if (mode == "MODE1/2352") { entry.track.type = trackType::Mode1; entry.track.sectorSize = SECTOR_SIZE; }
+			else if (mode == "MODE1/2048") { entry.track.type = trackType::Mode1; entry.track.sectorSize = SECTOR_USER_DATA_SIZE; }
+			else if (mode == "MODE2/2048") { entry.track.type = trackType::Mode2; entry.track.sectorSize = SECTOR_USER_DATA_SIZE; }
+			else if (mode == "MODE2/2352") { entry.track.type = trackType::Mode2; entry.track.sectorSize = SECTOR_SIZE; }
+			else
+			{
+				logging::fatal("unsupported track mode " + mode + " in cue sheet: " + path, logging::logSource::CDROM);
+			}
+			cueTracks.push_back(entry);
+		}
+		else if (command == "INDEX" || command == "PREGAP")
+		{
+			if (cueTracks.empty())
+			{
+				logging::fatal(command + " before TRACK in cue sheet: " + path, logging::logSource::CDROM);
+			}
+			cueTrack& current = cueTracks.back();
+			std::string time;
+			if (command == "PREGAP")
+			{
+				stream >> time;
+				current.pregap = parseCueMSF(time, path);
+			}
+			else
+			{
+				uint32_t index;
+				stream >> index >> time;
+				if (index == 0) { current.index0 = parseCueMSF(time, path); }
+				else if (index == 1) { current.index1 = parseCueMSF(time, path); }
+			}
+		}
+		// Everything else (REM, TITLE, FLAGS, etc.) doesn't affect the layout
+	}
+
+	if (cueTracks.empty())
+	{
+		logging::fatal("no tracks in cue sheet: " + path, logging::logSource::CDROM);
+	}
+
+	// Lay the tracks out one after another. Index times are relative to the start of each track's file.
+	uint32_t discPosition = 0;
+	for (size_t i = 0; i < cueTracks.size(); i++)
+	{
+		cueTrack& current = cueTracks[i];
+		if (current.index1 < 0)
+		{
+			logging::fatal("track " + std::to_string(current.track.number) + " has no INDEX 01 in cue sheet: " + path, logging::logSource::CDROM);
+		}
+		uint32_t firstIndex = (current.index0 >= 0) ? current.index0 : current.index1;
+		uint32_t gap = current.pregap;
+		if (i == 0 && current.index0 < 0 && current.pregap == 0)
+		{
+			gap = DISC_PREGAP_SECTORS; // the 2 second lead in before track 1 is never stored
+		}
+
+		uint64_t fileSectors = files[current.track.fileIndex]->getSize() / current.track.sectorSize;
+		uint64_t endIndex = fileSectors;
+		if (i + 1 < cueTracks.size() && cueTracks[i + 1].track.fileIndex == current.track.fileIndex)
+		{
+			const cueTrack& next = cueTracks[i + 1];
+			endIndex = (next.index0 >= 0) ? next.index0 : next.index1;
+		}
+		if (endIndex < firstIndex)
+		{
+			logging::fatal("track " + std::to_string(current.track.number) + " is out of order in cue sheet: " + path, logging::logSource::CDROM);
+		}
+
+		current.track.fileOffset = (uint64_t)firstIndex * current.track.sectorSize;
+		current.track.firstLBA = discPosition + gap;
+		current.track.indexOneLBA = current.track.firstLBA + (current.index1 - firstIndex);
+		current.track.sectorCount = (uint32_t)(endIndex - firstIndex);
+		discPosition = current.track.firstLBA + current.track.sectorCount;
+		tracks.push_back(current.track);
+	}
+	leadOutLBA = discPosition;
+}
+
+const uint8_t* binCueDisc::rawSector(const discTrack* track, uint32_t lba)
+{
+	if (track->sectorSize != SECTOR_SIZE) { return nullptr; }
+	mappedFile* file = files[track->fileIndex];
+	uint64_t offset = track->fileOffset + ((uint64_t)(lba - track->firstLBA) * SECTOR_SIZE);
+	if (offset + SECTOR_SIZE > file->getSize()) { return nullptr; }
+	return file->getData() + offset;
+}
+
+void binCueDisc::buildSector(const discTrack* track, uint32_t lba, uint8_t* out)
+{
+	mappedFile* file = (track != nullptr) ? files[track->fileIndex] : nullptr;
+	uint64_t offset = (track != nullptr) ? track->fileOffset + ((uint64_t)(lba - track->firstLBA) * SECTOR_USER_DATA_SIZE) : 0;
+	if (track == nullptr || track->sectorSize != SECTOR_USER_DATA_SIZE || offset + SECTOR_USER_DATA_SIZE > file->getSize())
+	{
+		memset(out, 0, SECTOR_SIZE); // gaps are silent
+		return;
+	}
+	// Cooked tracks only store the user data, so put the sync and header back around it
+	buildCookedSector(track, lba, file->getData() + offset, out);
+}
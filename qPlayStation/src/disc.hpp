@@ -0,0 +1,120 @@
+#pragma once
+#include "helpers.hpp"
+#include <unordered_map>
+
+#define SECTOR_SIZE 2352
+#define SECTOR_USER_DATA_SIZE 2048
+#define SECTORS_PER_SECOND 75
+#define DISC_PREGAP_SECTORS 150 // track 1 starts at 00:02:00
+
+enum class trackType : uint8_t
+{
+	Audio,
+	Mode1,
+	Mode2
+};
+
+struct discTrack
+{
+	uint8_t number;
+	trackType type;
+	uint32_t sectorSize;	// bytes per sector in the image file, 2352 or 2048
+	uint32_t fileIndex;		// which of the image files holds this track
+	uint64_t fileOffset;	// byte offset of firstLBA in that file
+	uint32_t firstLBA;		// first sector stored in the file (INDEX 00 if there is one)
+	uint32_t indexOneLBA;	// where the track actually starts (INDEX 01)
+	uint32_t sectorCount;	// sectors stored in the file from firstLBA
+};
+
+struct msf
+{
+	uint8_t minute;
+	uint8_t second;
+	uint8_t frame;
+};
+
+// A read only view of a whole file. Pages are only loaded when they're touched, so opening a 700MB image is instant.
+class mappedFile
+{
+	public:
+		mappedFile(std::string path);
+		~mappedFile();
+		const uint8_t* getData() { return data; }
+		uint64_t getSize() { return size; }
+	private:
+		const uint8_t* data;
+		uint64_t size;
+#ifdef _WIN32
+		void* fileHandle;
+		void* mappingHandle;
+#endif
+};
+
+struct sectorCacheStats
+{
+	uint64_t hits;
+	uint64_t misses;
+};
+
+// Small LRU cache for sectors that have to be built rather than read straight out of a mapped file.
+// Pointers returned stay valid until the next insert.
+class sectorCache
+{
+	public:
+		sectorCache(uint32_t slots);
+		uint8_t* lookup(uint32_t lba);
+		uint8_t* insert(uint32_t lba);
+		void clear();
+		sectorCacheStats getStats() { return stats; }
+	private:
+		std::vector<uint8_t> data;
+		std::list<uint32_t> lru; // most recently used at the front
+		std::unordered_map<uint32_t, std::pair<std::list<uint32_t>::iterator, uint32_t>> slotForLBA;
+		uint32_t slotCount;
+		sectorCacheStats stats;
+};
+
+// Base class for all disc image formats. Everything is addressed by absolute LBA, where 00:00:00 is LBA 0.
+class discImage
+{
+	public:
+		virtual ~discImage() {}
+		static discImage* open(std::string path, uint32_t chdCacheMiB);
+		const uint8_t* getSector(uint32_t lba); // full 2352 byte raw sector
+		const uint8_t* getUserData(uint32_t lba); // the 2048 bytes of data in a Mode 1 or Mode 2 Form 1 sector
+		const std::vector<discTrack>& getTracks() { return tracks; }
+		const discTrack* findTrack(uint32_t lba);
+		uint32_t getLeadOutLBA() { return leadOutLBA; }
+		sectorCacheStats getCacheStats() { return cache.getStats(); }
+
+		static uint32_t msfToLBA(msf m) { return (((m.minute * 60) + m.second) * SECTORS_PER_SECOND) + m.frame; }
+		static msf lbaToMSF(uint32_t lba) { return { (uint8_t)(lba / (60 * SECTORS_PER_SECOND)), (uint8_t)((lba / SECTORS_PER_SECOND) % 60), (uint8_t)(lba % SECTORS_PER_SECOND) }; }
+		static uint8_t toBCD(uint8_t value) { return ((value / 10) << 4) | (value % 10); }
+		static uint8_t fromBCD(uint8_t value) { return ((value >> 4) * 10) + (value & 0xF); }
+	protected:
+		discImage() : cache(32) { leadOutLBA = 0; }
+		std::vector<discTrack> tracks;
+		uint32_t leadOutLBA;
+		sectorCache cache;
+		// Returns the sector straight from the image if it's stored there raw, or nullptr if it has to be built
+		virtual const uint8_t* rawSector(const discTrack* track, uint32_t lba) = 0;
+		// Fills in a sector that isn't stored raw. track is nullptr for gaps that aren't in the image at all.
+		virtual void buildSector(const discTrack* track, uint32_t lba, uint8_t* out) = 0;
+		void buildHeader(const discTrack* track, uint32_t lba, uint8_t* out);
+		// For tracks that only store the 2048 bytes of user data
+		void buildCookedSector(const discTrack* track, uint32_t lba, const uint8_t* userData, uint8_t* out);
+};
+
+// BIN/CUE images, plus a lone .bin or .iso which is treated as a single data track
+class binCueDisc : public discImage
+{
+	public:
+		binCueDisc(std::string path);
+		~binCueDisc();
+	private:
+		std::vector<mappedFile*> files;
+		void parseCue(std::string path);
+		void addSingleBin(std::string path, uint32_t sectorSize);
+		const uint8_t* rawSector(const discTrack* track, uint32_t lba);
+		void buildSector(const discTrack* track, uint32_t lba, uint8_t* out);
+};
@@ -0,0 +1,122 @@
+#include "discReader.hpp"
+
+discReader::discReader(discImage* d)
+{
+	Disc = d;
+	ring.resize(READ_AHEAD_SLOTS);
+	head = 0;
+	tail = 0;
+	stopping = false;
+	active = false;
+	generation = 0;
+	requestLBA = 0;
+	lookahead = 0;
+	popGeneration = 0;
+	lateCount = 0;
+	failed = false;
+	thread = std::thread(&discReader::readerThread, this);
+}
+
+discReader::~discReader()
+{
+	{
+		std::lock_guard<std::mutex> guard(controlLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	thread.join();
+	if (lateCount > 0)
+	{
+		logging::info("CD read ahead fell behind " + std::to_string(lateCount) + " times", logging::logSource::CDROM);
+	}
+}
+
+void discReader::start(uint32_t lba, uint32_t speed)
+{
+	{
+		std::lock_guard<std::mutex> guard(controlLock);
+		generation++;
+		popGeneration = generation;
+		tail.store(head.load()); // anything already read is for the old position
+		requestLBA = lba;
+		active = true;
+		// About a fifth of a second ahead, which is plenty to hide a slow disk but doesn't waste reads if the game seeks away
+		lookahead = std::min<uint32_t>(16 * speed, READ_AHEAD_SLOTS);
+	}
+	wake.notify_all();
+}
+
+void discReader::stop()
+{
+	std::lock_guard<std::mutex> guard(controlLock);
+	generation++;
+	popGeneration = generation;
+	tail.store(head.load());
+	active = false;
+}
+
+bool discReader::pop(uint32_t lba, uint8_t* out)
+{
+	if (failed.load(std::memory_order_acquire))
+	{
+		std::rethrow_exception(error); // a fatal error from the disc image, raised here so main can handle it
+	}
+	uint32_t currentTail = tail.load(std::memory_order_relaxed);
+	while (currentTail != head.load(std::memory_order_acquire))
+	{
+		readAheadSlot& slot = ring[currentTail % READ_AHEAD_SLOTS];
+		if (slot.generation == popGeneration && slot.lba == lba)
+		{
+			memcpy(out, slot.data, SECTOR_SIZE);
+			tail.store(currentTail + 1, std::memory_order_release);
+			wake.notify_one();
+			return true;
+		}
+		// Left over from before a seek
+		currentTail++;
+		tail.store(currentTail, std::memory_order_release);
+	}
+	wake.notify_one();
+	lateCount++;
+	return false;
+}
+
+void discReader::readerThread()
+{
+	uint32_t readGeneration = 0;
+	uint32_t lba = 0;
+	std::unique_lock<std::mutex> guard(controlLock);
+	while (true)
+	{
+		wake.wait(guard, [&] {
+			return stopping || (active && (generation != readGeneration || (head.load() - tail.load()) < lookahead));
+		});
+		if (stopping) { return; }
+		if (generation != readGeneration)
+		{
+			readGeneration = generation;
+			lba = requestLBA;
+		}
+		uint32_t currentHead = head.load(std::memory_order_relaxed);
+		readAheadSlot& slot = ring[currentHead % READ_AHEAD_SLOTS];
+		slot.lba = lba;
+		slot.generation = readGeneration;
+		guard.unlock();
+
+		try
+		{
+			memcpy(slot.data, Disc->getSector(lba), SECTOR_SIZE);
+		}
+		catch (...)
+		{
+			// Letting it out of the thread would end the process, so the CPU thread raises it again from pop
+			error = std::current_exception();
+			failed.store(true, std::memory_order_release);
+			return;
+		}
+		lba++;
+
+		guard.lock();
+		head.store(currentHead + 1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "helpers.hpp"
+#include "disc.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+#define READ_AHEAD_SLOTS 64
+
+struct readAheadSlot
+{
+	uint32_t lba;
+	uint32_t generation; // which start() the sector was read for, so sectors from before a seek can be thrown away
+	uint8_t data[SECTOR_SIZE];
+};
+
+// Reads sectors ahead of the emulated drive head on its own thread, so slow storage never stalls the CPU thread.
+// All disc image access happens on the reader thread once it's running.
+class discReader
+{
+	public:
+		discReader(discImage* d);
+		~discReader();
+		void start(uint32_t lba, uint32_t speed); // speed is in multiples of 75 sectors/second
+		void stop();
+		// Copies out the next sector if it has been read, returns false if the reader hasn't got there yet.
+		// Rethrows anything the disc image threw on the reader thread.
+		bool pop(uint32_t lba, uint8_t* out);
+		uint64_t getLateCount() { return lateCount; }
+	private:
+		discImage* Disc;
+		std::vector<readAheadSlot> ring;
+		std::atomic<uint32_t> head; // written by the reader thread
+		std::atomic<uint32_t> tail; // written by the CPU thread
+		std::mutex controlLock;
+		std::condition_variable wake;
+		std::thread thread;
+		bool stopping;
+		bool active;
+		uint32_t generation;
+		uint32_t requestLBA;
+		uint32_t lookahead;
+		uint32_t popGeneration;
+		uint64_t lateCount;
+		std::exception_ptr error; // what the disc image threw on the reader thread
+		std::atomic<bool> failed; // set once error is, the reader thread has stopped
+		void readerThread();
+};
@@ -1,9 +1,12 @@
 #include "dma.hpp"
 
-dma::dma(ram* r, gpu* g)
+dma::dma(ram* r, gpu* g, cdrom* c, spu* s, mdec* m)
 {
 	RAM = r;
 	GPU = g;
+	CDROM = c;
+	SPU = s;
+	MDEC = m;
 	for (int i = 0; i < 7; i++)
 	{
 		channels[i] = new dmaChannel();
@@ -182,6 +185,32 @@ void dma::doDMA(uint8_t port)
 			case 1: wordsToTransfer = (*chan).blockSize * (*chan).blockCount; break;
 		}
 
+		if (port == (uint8_t)dmaPort::CDROM && !(*chan).direction && !(*chan).addrMode)
+		{
+			// Sector data goes into RAM in sector sized chunks rather than a word at a time
+			uint8_t buffer[SECTOR_SIZE];
+			uint32_t bytesLeft = wordsToTransfer * 4;
+			while (bytesLeft > 0)
+			{
+				uint32_t chunk = std::min<uint32_t>(bytesLeft, sizeof(buffer));
+				CDROM->readData(buffer, chunk);
+				RAM->writeBlock(currentAddr & 0x1FFFFC, buffer, chunk);
+				currentAddr += chunk;
+				bytesLeft -= chunk;
+			}
+			wordsToTransfer = 0;
+		}
+		if (port == (uint8_t)dmaPort::MDECout && !(*chan).direction && !(*chan).addrMode && MDEC->getOutputWords() < wordsToTransfer)
+		{
+			// The hardware waits for the out request, so leave the channel running until channel 0 has sent the data to decode
+			return;
+		}
+		if ((port == (uint8_t)dmaPort::SPU || port == (uint8_t)dmaPort::MDECin || port == (uint8_t)dmaPort::MDECout) && !(*chan).addrMode)
+		{
+			bulkCopy(port, chan, currentAddr, wordsToTransfer);
+			wordsToTransfer = 0;
+		}
+
 		while (wordsToTransfer > 0)
 		{
 			uint32_t adjAddr = currentAddr & 0x1FFFFC;
@@ -195,6 +224,16 @@ void dma::doDMA(uint8_t port)
 						GPU->set32(0, srcWord);
 						break;
 					}
+					case (uint8_t)dmaPort::SPU:
+					{
+						SPU->dmaWrite((const uint8_t*)&srcWord, 4);
+						break;
+					}
+					case (uint8_t)dmaPort::MDECin:
+					{
+						MDEC->set32(0, srcWord);
+						break;
+					}
 					default: logging::fatal("unhandled DMA (RAM to Device) port: " + std::to_string(port), logging::logSource::DMA);
 				}
 			}
@@ -213,6 +252,23 @@ void dma::doDMA(uint8_t port)
 						srcWord = GPU->get32(0);
 						break;
 					}
+					case (uint8_t)dmaPort::CDROM:
+					{
+						uint8_t bytes[4];
+						CDROM->readData(bytes, 4);
+						srcWord = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
+						break;
+					}
+					case (uint8_t)dmaPort::SPU:
+					{
+						SPU->dmaRead((uint8_t*)&srcWord, 4);
+						break;
+					}
+					case (uint8_t)dmaPort::MDECout:
+					{
+						srcWord = MDEC->get32(0);
+						break;
+					}
 					default: logging::fatal("unhandled DMA (device to RAM) port: " + std::to_string(port), logging::logSource::DMA);
 				}
 				RAM->set32(adjAddr, srcWord);
@@ -223,6 +279,47 @@ void dma::doDMA(uint8_t port)
 	}
 	(*chan).enabled = false;
 	(*chan).trigger = false;
+
+	// Output that channel 1 was waiting for may have just been decoded
+	if (port == (uint8_t)dmaPort::MDECin && channels[(uint8_t)dmaPort::MDECout]->isActive())
+	{
+		doDMA((uint8_t)dmaPort::MDECout);
+	}
+}
+
+// Sample uploads can be hundreds of KiB and FMVs push a whole frame through the MDEC, so these go between main RAM
+// and the device in large spans instead of a word at a time. In request mode the SPU and the MDEC's input are always
+// ready for the next block (and the MDEC's output is by the time this runs), so the whole blockSize * blockCount transfer happens at once.
+void dma::bulkCopy(uint8_t port, dmaChannel* chan, uint32_t addr, uint32_t words)
+{
+	uint8_t buffer[0x4000];
+	uint32_t bytesLeft = words * 4;
+	while (bytesLeft > 0)
+	{
+		uint32_t chunk = std::min<uint32_t>(bytesLeft, sizeof(buffer));
+		if ((*chan).direction) // RAM to Device
+		{
+			RAM->readBlock(addr & 0x1FFFFC, buffer, chunk);
+			switch (port)
+			{
+				case (uint8_t)dmaPort::SPU: SPU->dmaWrite(buffer, chunk); break;
+				case (uint8_t)dmaPort::MDECin: MDEC->dmaWrite(buffer, chunk); break;
+				default: logging::fatal("unhandled DMA (RAM to Device) port: " + std::to_string(port), logging::logSource::DMA);
+			}
+		}
+		else // Device to RAM
+		{
+			switch (port)
+			{
+				case (uint8_t)dmaPort::SPU: SPU->dmaRead(buffer, chunk); break;
+				case (uint8_t)dmaPort::MDECout: MDEC->dmaRead(buffer, chunk); break;
+				default: logging::fatal("unhandled DMA (device to RAM) port: " + std::to_string(port), logging::logSource::DMA);
+			}
+			RAM->writeBlock(addr & 0x1FFFFC, buffer, chunk);
+		}
+		addr += chunk;
+		bytesLeft -= chunk;
+	}
 }
 
 void dmaChannel::setControl(uint32_t value)
@@ -3,6 +3,9 @@
 #include "peripheral.hpp"
 #include "ram.hpp"
 #include "gpu.hpp"
+#include "cdrom.hpp"
+#include "spu.hpp"
+#include "mdec.hpp"
 
 class dmaChannel
 {
@@ -33,7 +36,7 @@ class dmaChannel
 class dma : public peripheral
 {
 	public:
-		dma(ram* r, gpu* g);
+		dma(ram* r, gpu* g, cdrom* c, spu* s, mdec* m);
 		~dma();
 		void reset();
 		void set32(uint32_t addr, uint32_t value);
@@ -45,6 +48,9 @@ class dma : public peripheral
 	private:
 		ram* RAM;
 		gpu* GPU;
+		cdrom* CDROM;
+		spu* SPU;
+		mdec* MDEC;
 
 		dmaChannel* channels[7];
 		uint32_t control;
@@ -55,6 +61,7 @@ class dma : public peripheral
 		bool irq_force;
 
 		void doDMA(uint8_t port);
+		void bulkCopy(uint8_t port, dmaChannel* chan, uint32_t addr, uint32_t words);
 };
 
 enum class dmaPort : uint8_t
@@ -0,0 +1,171 @@
+#include "ecc.hpp"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SECTOR_ECC_SSE2
+#endif
+
+#define ECC_P_COLUMNS 86 // P parity is over 86 columns of 24 bytes
+#define ECC_P_ROWS 24
+#define ECC_Q_DIAGONALS 52 // Q parity is over 52 diagonals of 43 bytes, which includes the P parity
+#define ECC_Q_ROWS 43
+
+struct eccTables
+{
+	uint32_t edc[4][256]; // slice by 4 CRC tables
+	uint8_t multiplyBy2[256]; // in GF(2^8) with the CD polynomial 0x11D
+	uint8_t divideBy3[256];
+
+	eccTables()
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; bit++)
+			{
+				crc = (crc >> 1) ^ ((crc & 1) ? 0xD8018001 : 0);
+			}
+			edc[0][i] = crc;
+
+			uint8_t doubled = (uint8_t)((i << 1) ^ ((i & 0x80) ? 0x11D : 0));
+			multiplyBy2[i] = doubled;
+			divideBy3[i ^ doubled] = (uint8_t)i; // x * 3 is x ^ (x * 2)
+		}
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			for (int slice = 1; slice < 4; slice++)
+			{
+				edc[slice][i] = (edc[slice - 1][i] >> 8) ^ edc[0][edc[slice - 1][i] & 0xFF];
+			}
+		}
+	}
+};
+
+static const eccTables tables;
+
+uint32_t sectorEcc::computeEDC(const uint8_t* data, uint32_t length)
+{
+	uint32_t crc = 0;
+	while (length >= 4)
+	{
+		crc ^= data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+		crc = tables.edc[3][crc & 0xFF] ^ tables.edc[2][(crc >> 8) & 0xFF] ^ tables.edc[1][(crc >> 16) & 0xFF] ^ tables.edc[0][crc >> 24];
+		data += 4;
+		length -= 4;
+	}
+	while (length > 0)
+	{
+		crc = (crc >> 8) ^ tables.edc[0][(crc ^ *data) & 0xFF];
+		data++;
+		length--;
+	}
+	return crc;
+}
+
+// Works out the two parity bytes for each of width codewords at once. Byte i of every row belongs to codeword i.
+// The first parity byte of each codeword goes to dest[i] and the second to dest[width + i].
+void sectorEcc::computeParity(const uint8_t* rows, uint32_t rowCount, uint32_t width, uint8_t* dest)
+{
+	uint8_t a[ECC_P_COLUMNS] = {};
+	uint8_t b[ECC_P_COLUMNS] = {};
+	for (uint32_t row = 0; row < rowCount; row++)
+	{
+		const uint8_t* data = rows + (row * width);
+		uint32_t i = 0;
+#ifdef SECTOR_ECC_SSE2
+		// Multiplying by 2 is a shift, plus the polynomial wherever the top bit was set
+		const __m128i polynomial = _mm_set1_epi8(0x1D);
+		for (; i + 16 <= width; i += 16)
+		{
+			__m128i value = _mm_loadu_si128((const __m128i*)(data + i));
+			__m128i sumA = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(a + i)), value);
+			__m128i topBit = _mm_cmplt_epi8(sumA, _mm_setzero_si128());
+			sumA = _mm_xor_si128(_mm_add_epi8(sumA, sumA), _mm_and_si128(topBit, polynomial));
+			_mm_storeu_si128((__m128i*)(a + i), sumA);
+			_mm_storeu_si128((__m128i*)(b + i), _mm_xor_si128(_mm_loadu_si128((const __m128i*)(b + i)), value));
+		}
+#endif
+		for (; i < width; i++)
+		{
+			a[i] = tables.multiplyBy2[a[i] ^ data[i]];
+			b[i] ^= data[i];
+		}
+	}
+	for (uint32_t i = 0; i < width; i++)
+	{
+		uint8_t parity = tables.divideBy3[tables.multiplyBy2[a[i]] ^ b[i]];
+		dest[i] = parity;
+		dest[width + i] = parity ^ b[i];
+	}
+}
+
+void sectorEcc::generateECC(uint8_t* sector)
+{
+	// Mode 2 doesn't protect the header, since the ECC is for the data the drive hands over which starts after it
+	uint8_t header[4];
+	bool mode2 = sector[15] == 2;
+	if (mode2)
+	{
+		memcpy(header, sector + 12, 4);
+		memset(sector + 12, 0, 4);
+	}
+	const uint8_t* data = sector + 12;
+
+	// P codewords are columns, so the sector can be used as the rows directly
+	computeParity(data, ECC_P_ROWS, ECC_P_COLUMNS, sector + SECTOR_ECC_P_OFFSET);
+
+	// Q codewords run diagonally through the 16 bit words of the sector seen as 26 rows of 43 words.
+	// Gathering each step of the diagonals into a row lets them share the same column code as P.
+	uint8_t qRows[ECC_Q_ROWS * ECC_Q_DIAGONALS];
+	for (uint32_t step = 0; step < ECC_Q_ROWS; step++)
+	{
+		uint8_t* row = qRows + (step * ECC_Q_DIAGONALS);
+		for (uint32_t diagonal = 0; diagonal < ECC_Q_DIAGONALS / 2; diagonal++)
+		{
+			uint32_t word = (43 * ((diagonal + step) % 26)) + step;
+			row[diagonal * 2] = data[word * 2];
+			row[(diagonal * 2) + 1] = data[(word * 2) + 1];
+		}
+	}
+	computeParity(qRows, ECC_Q_ROWS, ECC_Q_DIAGONALS, sector + SECTOR_ECC_Q_OFFSET);
+
+	if (mode2)
+	{
+		memcpy(sector + 12, header, 4);
+	}
+}
+
+static void storeEDC(uint8_t* out, uint32_t edc)
+{
+	out[0] = edc & 0xFF;
+	out[1] = (edc >> 8) & 0xFF;
+	out[2] = (edc >> 16) & 0xFF;
+	out[3] = (edc >> 24) & 0xFF;
+}
+
+void sectorEcc::generate(uint8_t* sector)
+{
+	switch (sector[15])
+	{
+		case 1:
+		{
+			storeEDC(sector + SECTOR_EDC_MODE1_OFFSET, computeEDC(sector, SECTOR_EDC_MODE1_OFFSET));
+			memset(sector + SECTOR_EDC_MODE1_OFFSET + 4, 0, 8);
+			generateECC(sector);
+			break;
+		}
+		case 2:
+		{
+			// Bit 5 of the submode marks Form 2, which trades the ECC for more data
+			if (sector[18] & 0x20)
+			{
+				storeEDC(sector + SECTOR_EDC_FORM2_OFFSET, computeEDC(sector + 16, SECTOR_EDC_FORM2_OFFSET - 16));
+			}
+			else
+			{
+				storeEDC(sector + SECTOR_EDC_FORM1_OFFSET, computeEDC(sector + 16, SECTOR_EDC_FORM1_OFFSET - 16));
+				generateECC(sector);
+			}
+			break;
+		}
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "helpers.hpp"
+
+#define SECTOR_EDC_MODE1_OFFSET 0x810
+#define SECTOR_EDC_FORM1_OFFSET 0x818
+#define SECTOR_EDC_FORM2_OFFSET 0x92C
+#define SECTOR_ECC_P_OFFSET 0x81C
+#define SECTOR_ECC_Q_OFFSET 0x8C8
+
+// Error detection (EDC, a CRC32) and correction (ECC, Reed-Solomon P and Q parity) codes for raw CD sectors.
+// Only generation is needed, since images never have read errors to correct.
+class sectorEcc
+{
+	public:
+		static uint32_t computeEDC(const uint8_t* data, uint32_t length);
+		// Fills in the P and Q parity of a Mode 1 or Mode 2 Form 1 sector from everything before them
+		static void generateECC(uint8_t* sector);
+		// Fills in the EDC, and ECC where there is one, for whatever mode (and form) the header and subheader say
+		static void generate(uint8_t* sector);
+	private:
+		//private constructor means no instances of this object can be created
+		sectorEcc() {}
+		static void computeParity(const uint8_t* rows, uint32_t rowCount, uint32_t width, uint8_t* dest);
+};
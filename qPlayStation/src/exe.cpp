@@ -0,0 +1,47 @@
+#include "exe.hpp"
+
+EXEInfo exeLoader::fromFile(std::string path)
+{
+	std::ifstream exeFile(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!exeFile.is_open())
+	{
+		logging::fatal("unable to load EXE file " + path, logging::logSource::qPS);
+	}
+	std::vector<uint8_t> data((size_t)exeFile.tellg());
+	exeFile.seekg(0, std::ios::beg);
+	exeFile.read((char*)data.data(), data.size());
+	return fromData(data, path);
+}
+
+EXEInfo exeLoader::fromData(const std::vector<uint8_t>& data, std::string name, uint32_t stack)
+{
+	exeHeader header;
+	if (data.size() < EXE_HEADER_SIZE)
+	{
+		logging::fatal(name + " is too small to be an EXE", logging::logSource::qPS);
+	}
+	memcpy(&header, data.data(), sizeof(header));
+	if (memcmp(header.id, "PS-X EXE", sizeof(header.id)) != 0)
+	{
+		logging::fatal(name + " has incorrect header", logging::logSource::qPS);
+	}
+
+	// Some EXEs are cut short of the size in the header, the rest is left as whatever was in RAM
+	uint32_t available = (uint32_t)(data.size() - EXE_HEADER_SIZE);
+	if (header.loadSize > available)
+	{
+		logging::warning(name + " is shorter than its header says", logging::logSource::qPS);
+	}
+
+	EXEInfo info;
+	info.present = true;
+	info.initialPC = header.initialPC;
+	info.initialR28 = header.initialGP;
+	info.initialR29R30 = (header.stackBase != 0) ? (header.stackBase + header.stackOffset) : stack;
+	info.loadAddress = header.loadAddress;
+	info.bssAddress = header.bssAddress;
+	info.bssSize = header.bssSize;
+	info.image.assign(data.begin() + EXE_HEADER_SIZE, data.begin() + EXE_HEADER_SIZE + std::min(header.loadSize, available));
+	logging::info("Loaded EXE " + name + ": " + std::to_string(info.image.size()) + " bytes at " + helpers::intToHex(info.loadAddress), logging::logSource::qPS);
+	return info;
+}
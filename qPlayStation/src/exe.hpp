@@ -0,0 +1,48 @@
+#pragma once
+#include "helpers.hpp"
+
+#define EXE_HOOK_ADDRESS 0xBFC06FF0 // the BIOS has finished setting up the kernel and is about to start the shell
+#define EXE_HEADER_SIZE 0x800
+#define EXE_DEFAULT_STACK 0x801FFF00
+
+// Layout of the first 0x38 bytes of a PS-X EXE header, everything is little endian
+struct exeHeader
+{
+	char id[8];				// "PS-X EXE"
+	uint32_t text;
+	uint32_t data;
+	uint32_t initialPC;
+	uint32_t initialGP;
+	uint32_t loadAddress;
+	uint32_t loadSize;
+	uint32_t dataAddress;
+	uint32_t dataSize;
+	uint32_t bssAddress;	// zero filled when the EXE is loaded
+	uint32_t bssSize;
+	uint32_t stackBase;		// 0 means keep the stack the BIOS (or SYSTEM.CNF) gave it
+	uint32_t stackOffset;
+};
+
+// An EXE waiting to be copied into RAM once the BIOS reaches EXE_HOOK_ADDRESS
+struct EXEInfo
+{
+	bool present;
+	uint32_t initialPC;
+	uint32_t initialR28;
+	uint32_t initialR29R30;
+	uint32_t loadAddress;
+	uint32_t bssAddress;
+	uint32_t bssSize;
+	std::vector<uint8_t> image; // everything after the header
+};
+
+class exeLoader
+{
+	public:
+		static EXEInfo fromFile(std::string path);
+		// stack is used if the EXE doesn't set its own
+		static EXEInfo fromData(const std::vector<uint8_t>& data, std::string name, uint32_t stack = EXE_DEFAULT_STACK);
+	private:
+		//private constructor means no instances of this object can be created
+		exeLoader() {}
+};
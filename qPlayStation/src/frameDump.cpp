@@ -0,0 +1,178 @@
+#include "frameDump.hpp"
+#include <algorithm>
+
+static void rgb555ToRGB(uint16_t pixel, uint8_t* out)
+{
+	uint8_t r = pixel & 0x1F;
+	uint8_t g = (pixel >> 5) & 0x1F;
+	uint8_t b = (pixel >> 10) & 0x1F;
+	// Copy the top bits into the bottom so 0x1F becomes 0xFF
+	out[0] = (r << 3) | (r >> 2);
+	out[1] = (g << 3) | (g >> 2);
+	out[2] = (b << 3) | (b >> 2);
+}
+
+void frameDump::displayToRGB(const uint8_t* vram, DisplayArea area, std::vector<uint8_t>& out)
+{
+	out.resize((size_t)area.width * area.height * 3);
+	uint8_t* dest = out.data();
+	for (uint32_t line = 0; line < area.height; line++)
+	{
+		const uint8_t* src = &vram[((area.y + line) & 0x1FF) * 2048];
+		if (area.is24Bit)
+		{
+			uint32_t byteX = area.x * 2;
+			for (uint32_t x = 0; x < area.width; x++)
+			{
+				dest[0] = src[byteX % 2048];
+				dest[1] = src[(byteX + 1) % 2048];
+				dest[2] = src[(byteX + 2) % 2048];
+				dest += 3;
+				byteX += 3;
+			}
+		}
+		else
+		{
+			for (uint32_t x = 0; x < area.width; x++)
+			{
+				uint32_t byteX = ((area.x + x) & 0x3FF) * 2;
+				rgb555ToRGB(src[byteX] | (src[byteX + 1] << 8), dest);
+				dest += 3;
+			}
+		}
+	}
+}
+
+void frameDump::vramToRGB(const uint8_t* vram, std::vector<uint8_t>& out)
+{
+	out.resize(1024 * 512 * 3);
+	for (uint32_t i = 0; i < 1024 * 512; i++)
+	{
+		rgb555ToRGB(vram[i * 2] | (vram[(i * 2) + 1] << 8), &out[i * 3]);
+	}
+}
+
+uint32_t frameDump::crc32(const uint8_t* data, size_t size, uint32_t crc)
+{
+	static uint32_t table[256];
+	static bool tableBuilt = false;
+	if (!tableBuilt)
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++)
+			{
+				c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+			}
+			table[i] = c;
+		}
+		tableBuilt = true;
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void put32BE(std::vector<uint8_t>& v, uint32_t value)
+{
+	v.push_back(value >> 24);
+	v.push_back((value >> 16) & 0xFF);
+	v.push_back((value >> 8) & 0xFF);
+	v.push_back(value & 0xFF);
+}
+
+void frameDump::writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+{
+	std::vector<uint8_t> header;
+	put32BE(header, (uint32_t)data.size());
+	file.write((const char*)header.data(), 4);
+	file.write(type, 4);
+	file.write((const char*)data.data(), data.size());
+
+	uint32_t crc = crc32((const uint8_t*)type, 4);
+	crc = crc32(data.data(), data.size(), crc);
+	std::vector<uint8_t> footer;
+	put32BE(footer, crc);
+	file.write((const char*)footer.data(), 4);
+}
+
+// Writes an 8 bit RGB PNG. The image data is stored without compression,
+// which keeps this simple and fast - dumps are meant to be compared, not archived.
+void frameDump::writePNG(std::string path, uint32_t width, uint32_t height, const std::vector<uint8_t>& rgb)
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		logging::error("unable to write " + path, logging::logSource::qPS);
+		return;
+	}
+	const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	file.write((const char*)signature, 8);
+
+	std::vector<uint8_t> ihdr;
+	put32BE(ihdr, width);
+	put32BE(ihdr, height);
+	ihdr.push_back(8); // bit depth
+	ihdr.push_back(2); // colour type - RGB
+	ihdr.push_back(0); // compression
+	ihdr.push_back(0); // filter
+	ihdr.push_back(0); // no interlace
+	writeChunk(file, "IHDR", ihdr);
+
+	// Each row starts with a filter type byte (0 = none)
+	std::vector<uint8_t> raw;
+	raw.reserve((size_t)height * ((width * 3) + 1));
+	for (uint32_t y = 0; y < height; y++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), rgb.begin() + ((size_t)y * width * 3), rgb.begin() + ((size_t)(y + 1) * width * 3));
+	}
+
+	// zlib stream made of "stored" deflate blocks
+	std::vector<uint8_t> idat;
+	idat.push_back(0x78);
+	idat.push_back(0x01);
+	size_t pos = 0;
+	do
+	{
+		uint16_t blockSize = (uint16_t)std::min(raw.size() - pos, (size_t)0xFFFF);
+		bool last = (pos + blockSize) == raw.size();
+		idat.push_back(last ? 1 : 0);
+		idat.push_back(blockSize & 0xFF);
+		idat.push_back(blockSize >> 8);
+		idat.push_back(~blockSize & 0xFF);
+		idat.push_back((~blockSize >> 8) & 0xFF);
+		idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + blockSize);
+		pos += blockSize;
+	} while (pos < raw.size());
+
+	uint32_t a = 1;
+	uint32_t b = 0;
+	for (uint8_t byte : raw)
+	{
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	put32BE(idat, (b << 16) | a);
+	writeChunk(file, "IDAT", idat);
+
+	writeChunk(file, "IEND", {});
+	file.close();
+}
+
+void frameDump::writeRaw(std::string path, const uint8_t* data, size_t size)
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		logging::error("unable to write " + path, logging::logSource::qPS);
+		return;
+	}
+	file.write((const char*)data, size);
+	file.close();
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "helpers.hpp"
+#include "gpu.hpp"
+
+// Converts VRAM contents to 24 bit RGB images and writes them to disk
+class frameDump
+{
+	public:
+		// Output is width * height * 3 bytes
+		static void displayToRGB(const uint8_t* vram, DisplayArea area, std::vector<uint8_t>& out);
+		static void vramToRGB(const uint8_t* vram, std::vector<uint8_t>& out);
+		static void writePNG(std::string path, uint32_t width, uint32_t height, const std::vector<uint8_t>& rgb);
+		static void writeRaw(std::string path, const uint8_t* data, size_t size);
+	private:
+		//private constructor means no instances of this object can be created
+		frameDump() {}
+		static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+		static void writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data);
+};
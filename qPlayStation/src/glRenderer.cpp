@@ -0,0 +1,372 @@
+#include "glRenderer.hpp"
+
+glRenderer::glRenderer(SDL_Window* window, uint8_t* v)
+{
+	sdlWindow = window;
+	vram = v;
+	drawingArea = { 0, 0, 0, 0, 0, 0 };
+	warnedDrawState = false;
+	glBuffer = new uint8_t[2048 * 512];
+
+	sdlRenderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED/* | SDL_RENDERER_PRESENTVSYNC*/);
+	if (sdlRenderer == NULL)
+	{
+		logging::fatal("Renderer could not be created! SDL_Error: " + std::string(SDL_GetError()), logging::logSource::GPU);
+	}
+	screenTexture = SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_ARGB1555, SDL_TEXTUREACCESS_STREAMING, 1024, 512);
+
+	initOpenGL();
+}
+
+glRenderer::~glRenderer()
+{
+	delete(vertices);
+	glDeleteVertexArrays(1, &vertexArrayObject);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+	glDeleteProgram(program);
+	SDL_GL_DeleteContext(glContext);
+	SDL_DestroyTexture(screenTexture);
+	SDL_DestroyRenderer(sdlRenderer);
+	delete[] glBuffer;
+}
+
+void glRenderer::setDrawingArea(DrawingArea area)
+{
+	// Anything already queued was meant for the old area
+	draw();
+	drawingArea = area;
+	// GL's origin is the bottom left, VRAM's is the top left
+	if (area.right >= area.left && area.bottom >= area.top)
+	{
+		glScissor(area.left, 511 - area.bottom, (area.right - area.left) + 1, (area.bottom - area.top) + 1);
+	}
+	else
+	{
+		glScissor(0, 0, 0, 0);
+	}
+}
+
+void glRenderer::setTextureWindow(TextureWindow window)
+{
+	glUniform4ui(texWindowInfo, window.xMask, window.xOffset, window.yMask, window.yOffset);
+}
+
+void glRenderer::setDrawState(DrawState state)
+{
+	// Semi transparency, masking and dithering aren't implemented in the shaders yet, so say so the first time a game uses them
+	if (!warnedDrawState && (state.semiTransparent || state.dither || state.setMask || state.checkMask))
+	{
+		logging::warning("The GL renderer ignores semi transparency, the mask bit and dithering, use --renderer software for accurate output", logging::logSource::GPU);
+		warnedDrawState = true;
+	}
+}
+
+template <class T> Buffer<T>::Buffer()
+{
+	glGenBuffers(1, &bufObject);
+	glBindBuffer(GL_ARRAY_BUFFER, bufObject);
+
+	GLsizeiptr elementSize = sizeof(T);
+	GLsizeiptr bufferSize = elementSize * VERTEX_BUFFER_LEN;
+
+	glBufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+	map = (T*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+
+	memset(map, 0, bufferSize);
+}
+
+template <class T> Buffer<T>::~Buffer()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, bufObject);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	glDeleteBuffers(1, &bufObject);
+}
+
+template <class T> void Buffer<T>::set(uint32_t index, T value)
+{
+	if (index >= VERTEX_BUFFER_LEN)
+	{
+		logging::fatal("Vertex buffer overflow", logging::logSource::GPU);
+	}
+	map[index] = value;
+}
+
+void GLAPIENTRY GLDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
+{
+	logging::warning(std::string(message), logging::logSource::GPU);
+}
+
+void glRenderer::initOpenGL()
+{
+	const char* vertexShaderSrc =
+		"#version 330\n"
+		"in ivec2 vertex_position;\n"
+		"in uvec3 vertex_color;\n"
+		"in uvec2 texture_page;\n"
+		"in uvec2 texture_coord;\n"
+		"in uvec2 clut;\n"
+		"in uint texture_depth;\n"
+		"in uint texture_blend_mode;\n"
+		"out vec3 frag_color;\n"
+		"flat out uvec2 frag_texture_page;\n"
+		"out vec2 frag_texture_coord;\n"
+		"flat out uvec2 frag_clut;\n"
+		"flat out uint frag_texture_depth;\n"
+		"flat out uint frag_blend_mode;\n"
+		"void main() {\n"
+		"	float xpos = (float(vertex_position.x) / 512) - 1.0;\n"
+		"	float ypos = 1.0 - (float(vertex_position.y) / 256);\n"
+		"	gl_Position.xyzw = vec4(xpos, ypos, 0.0, 1.0);\n"
+		"	frag_color = vec3(float(vertex_color.r) / 255, float(vertex_color.g) / 255, float(vertex_color.b) / 255);\n"
+		"	frag_texture_page = texture_page;\n"
+		"	frag_texture_coord = vec2(texture_coord);\n"
+		"	frag_clut = clut;\n"
+		"	frag_texture_depth = texture_depth;\n"
+		"	frag_blend_mode = texture_blend_mode;\n"
+		"}\n";
+
+	const char* fragmentShaderSrc =
+		"#version 330\n"
+		"uniform sampler2D vramTexture;\n"
+		"uniform uvec4 texWindowInfo;\n"
+		"in vec3 frag_color;\n"
+		"flat in uvec2 frag_texture_page;\n"
+		"in vec2 frag_texture_coord;\n"
+		"flat in uvec2 frag_clut;\n"
+		"flat in uint frag_texture_depth;\n"
+		"flat in uint frag_blend_mode;\n"
+		"out vec4 o_color;\n"
+		"const uint BLEND_MODE_NO_TEXTURE = 0U;\n"
+		"const uint BLEND_MODE_RAW_TEXTURE = 1U;\n"
+		"const uint BLEND_MODE_TEXTURE_BLEND = 2U;\n"
+		"vec4 vram_get_pixel(uint x, uint y) {\n"
+		"	return texelFetch(vramTexture, ivec2(x & 0x3ffU, y & 0x1ffU), 0);\n"
+		"}\n"
+		"uint rebuild_psx_color(vec4 color) {\n"
+		"	uint a = uint(floor(color.a + 0.5));\n"
+		"	uint r = uint(floor(color.r * 31. + 0.5));\n"
+		"	uint g = uint(floor(color.g * 31. + 0.5));\n"
+		"	uint b = uint(floor(color.b * 31. + 0.5));\n"
+		"	return (a << 15) | (b << 10) | (g << 5) | r;\n"
+		"}\n"
+		"void main() {\n"
+		"	if (frag_blend_mode == BLEND_MODE_NO_TEXTURE) {\n"
+		"		o_color = vec4(frag_color, 1.0);\n"
+		"	} else {\n"
+		"		uint frag_texture_depth_new = frag_texture_depth;\n"
+		"		if ((frag_texture_depth & 1U) != 1U) { // Flip frag_texture_depth from 0, 1, 2 to 2, 1, 0\n"
+		"			frag_texture_depth_new ^= 0x2U;\n"
+		"		}\n"
+		"		uint pix_per_hw = 1U << frag_texture_depth_new;\n"
+		"		uint tex_x = uint(frag_texture_coord.x) & 0xffU;\n"
+		"		uint tex_y = uint(frag_texture_coord.y) & 0xffU;\n"
+		"		tex_x = (tex_x & (~(texWindowInfo.x << 3U))) | ((texWindowInfo.z & texWindowInfo.x) << 3U);\n"
+		"		tex_y = (tex_y & (~(texWindowInfo.y << 3U))) | ((texWindowInfo.w & texWindowInfo.x) << 3U);\n"
+		"		uint tex_x_pix = tex_x / pix_per_hw;\n"
+		"		tex_x_pix += frag_texture_page.x;\n"
+		"		tex_y += frag_texture_page.y;\n"
+		"		vec4 texel = vram_get_pixel(tex_x_pix, tex_y);\n"
+		"		if (frag_texture_depth_new > 0U) {\n"
+		"			uint icolor = rebuild_psx_color(texel);\n"
+		"			uint bpp = 16U >> frag_texture_depth_new;\n"
+		"			uint mask = ((1U << bpp) - 1U);\n"
+		"			uint align = tex_x & ((1U << frag_texture_depth_new) - 1U);\n"
+		"			uint shift = (align * bpp);\n"
+		"			uint index = (icolor >> shift) & mask;\n"
+		"			uint clut_x = frag_clut.x + index;\n"
+		"			uint clut_y = frag_clut.y;\n"
+		"			texel = vram_get_pixel(clut_x, clut_y);\n"
+		"		}\n"
+		"		if (rebuild_psx_color(texel) == 0U) {\n"
+		"			discard;\n"
+		"		}\n"
+		"		if (frag_blend_mode == BLEND_MODE_RAW_TEXTURE) {\n"
+		"			o_color = vec4(texel.rgb, 1.0);\n"
+		"		} else {\n"
+		"			o_color = vec4(frag_color * 2. * texel.rgb, 1.0);\n"
+		"		}\n"
+		"	}\n"
+		"}\n";
+
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
+	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+
+	glContext = SDL_GL_CreateContext(sdlWindow);
+	GLenum err = glewInit();
+	if (err != GLEW_OK)
+	{
+		logging::fatal("GLEW init error: " + std::string((char*)glewGetErrorString(err)), logging::logSource::GPU);
+	}
+	glEnable(GL_DEBUG_OUTPUT);
+	glDebugMessageCallback(GLDebugCallback, 0);
+
+	vertexShader = compileShader(vertexShaderSrc, GL_VERTEX_SHADER);
+	fragmentShader = compileShader(fragmentShaderSrc, GL_FRAGMENT_SHADER);
+
+	program = linkProgram(std::list<GLuint>{vertexShader, fragmentShader});
+
+	glUseProgram(program);
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_SCISSOR_TEST);
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+	glViewport(0, 0, 1024, 512);
+
+	glGenVertexArrays(1, &vertexArrayObject);
+	glBindVertexArray(vertexArrayObject);
+
+	GLsizei stride = sizeof(Vertex);
+	uint64_t offset = 0;
+	vertices = new Buffer<Vertex>();
+
+	glBindAttribLocation(program, 0, "vertex_position");
+	glEnableVertexAttribArray(0);
+	glVertexAttribIPointer(0, 2, GL_SHORT, stride, (void*)offset);
+	offset += sizeof(Position);
+
+	glBindAttribLocation(program, 1, "vertex_color");
+	glEnableVertexAttribArray(1);
+	glVertexAttribIPointer(1, 3, GL_UNSIGNED_BYTE, stride, (void*)offset);
+	offset += sizeof(Colour);
+
+	glBindAttribLocation(program, 2, "texture_page");
+	glEnableVertexAttribArray(2);
+	glVertexAttribIPointer(2, 2, GL_UNSIGNED_SHORT, stride, (void*)offset);
+	offset += sizeof(TexPage);
+
+	glBindAttribLocation(program, 3, "texture_coord");
+	glEnableVertexAttribArray(3);
+	glVertexAttribIPointer(3, 2, GL_UNSIGNED_BYTE, stride, (void*)offset);
+	offset += sizeof(TexCoord);
+
+	glBindAttribLocation(program, 4, "clut");
+	glEnableVertexAttribArray(4);
+	glVertexAttribIPointer(4, 2, GL_UNSIGNED_SHORT, stride, (void*)offset);
+	offset += sizeof(ClutAttr);
+
+	glBindAttribLocation(program, 5, "texture_depth");
+	glEnableVertexAttribArray(5);
+	glVertexAttribIPointer(5, 1, GL_UNSIGNED_BYTE, stride, (void*)offset);
+	offset += sizeof(TextureColourDepth);
+
+	glBindAttribLocation(program, 6, "texture_blend_mode");
+	glEnableVertexAttribArray(6);
+	glVertexAttribIPointer(6, 1, GL_UNSIGNED_BYTE, stride, (void*)offset);
+	offset += sizeof(GLubyte);
+
+	glGenTextures(1, &vramTexture);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, vramTexture);
+	glUniform1i(glGetUniformLocation(program, "vramTexture"), 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+	texWindowInfo = glGetUniformLocation(program, "texWindowInfo");
+
+	nVertices = 0;
+}
+
+GLuint glRenderer::compileShader(const char* str, GLenum shaderType)
+{
+	GLuint shader = glCreateShader(shaderType);
+
+	int length = (int)strlen(str);
+	glShaderSource(shader, 1, (const GLchar**)&str, &length);
+	glCompileShader(shader);
+
+	GLint status;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		logging::fatal("Shader compilation failed: " + std::string(str), logging::logSource::GPU);
+	}
+	return shader;
+}
+
+GLuint glRenderer::linkProgram(std::list<GLuint> shaders)
+{
+	GLuint program = glCreateProgram();
+	for (GLuint shader : shaders)
+	{
+		glAttachShader(program, shader);
+	}
+	glLinkProgram(program);
+
+	GLint status;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		logging::fatal("OpenGL program linking failed", logging::logSource::GPU);
+	}
+	return program;
+}
+
+void glRenderer::pushTriangle(Vertex v1, Vertex v2, Vertex v3)
+{
+	if (nVertices + 3 > VERTEX_BUFFER_LEN)
+	{
+		logging::warning("Vertex buffers full, forcing draw", logging::logSource::GPU);
+		draw();
+	}
+	vertices->set(nVertices, v1);
+	nVertices++;
+	vertices->set(nVertices, v2);
+	nVertices++;
+	vertices->set(nVertices, v3);
+	nVertices++;
+}
+
+
+void glRenderer::draw()
+{
+	if (nVertices == 0) { return; }
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1024, 512, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, vram);
+	glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+	glDrawArrays(GL_TRIANGLES, 0, nVertices);
+
+	// Wait for GPU (should probably change this later)
+	GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	bool drawingDone = false;
+	while (!drawingDone)
+	{
+		GLenum wait = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 10000000);
+		if (wait == GL_ALREADY_SIGNALED || wait == GL_CONDITION_SATISFIED)
+		{
+			drawingDone = true;
+		}
+	}
+	nVertices = 0;
+}
+
+void glRenderer::display()
+{
+	draw();
+	//SDL_GL_SwapWindow(sdlWindow);
+	glReadPixels(0, 0, 1024, 512, GL_BGRA, GL_UNSIGNED_SHORT_1_5_5_5_REV, glBuffer);
+	for (int32_t i = 0; i < 2048 * 512; i += 2)
+	{
+		int32_t row = i / 2048;
+		int32_t col = i % 2048;
+		row = (512 - row) - 1;
+		// Drawing is already clipped to the drawing area by the scissor test
+		if (glBuffer[i + 1] & 0x80)
+		{
+			vram[(row * 2048) + col] = glBuffer[i];
+			vram[(row * 2048) + col + 1] = glBuffer[i + 1];
+		}
+	}
+	SDL_UpdateTexture(screenTexture, NULL, vram, 2048);
+	SDL_RenderCopy(sdlRenderer, screenTexture, NULL, NULL);
+	SDL_RenderPresent(sdlRenderer);
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+#include "helpers.hpp"
+#include "renderer.hpp"
+
+// was 65536, increased based on it overflowing in amidog cpu test
+#define VERTEX_BUFFER_LEN 131072
+template <class T> struct Buffer
+{
+	GLuint bufObject;
+	T* map;
+
+	Buffer();
+	~Buffer();
+	void set(uint32_t index, T value);
+};
+
+class glRenderer : public renderer
+{
+	public:
+		glRenderer(SDL_Window* window, uint8_t* v);
+		~glRenderer();
+		void pushTriangle(Vertex v1, Vertex v2, Vertex v3);
+		void setDrawingArea(DrawingArea area);
+		void setTextureWindow(TextureWindow window);
+		void setDrawState(DrawState state);
+		void draw();
+		void display();
+	private:
+		uint8_t* vram;
+		DrawingArea drawingArea;
+		bool warnedDrawState; // only warn once about the draw state being ignored
+
+		SDL_Renderer* sdlRenderer;
+		SDL_Texture* screenTexture;
+		uint8_t* glBuffer;
+
+		SDL_Window* sdlWindow;
+		SDL_GLContext glContext;
+		GLuint vertexArrayObject;
+		GLuint vertexShader;
+		GLuint fragmentShader;
+		GLuint program;
+		GLuint vramTexture;
+		GLint texWindowInfo;
+		Buffer<Vertex>* vertices;
+		uint32_t nVertices;
+		void initOpenGL();
+		GLuint compileShader(const char* str, GLenum shaderType);
+		GLuint linkProgram(std::list<GLuint> shaders);
+};
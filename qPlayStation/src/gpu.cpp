@@ -1,33 +1,26 @@
 #include "gpu.hpp"
+#include "videoDump.hpp"
+#include <algorithm>
 
-gpu::gpu(SDL_Window* window, interruptController* i)
+gpu::gpu(SDL_Window* window, interruptController* i, rendererType type)
 {
 	InterruptController = i;
-	sdlWindow = window;
 	vram = new uint8_t[2048 * 512];
-	glBuffer = new uint8_t[2048 * 512];
 	memset(vram, 0, 2048 * 512);
 
-	sdlRenderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED/* | SDL_RENDERER_PRESENTVSYNC*/);
-	if (sdlRenderer == NULL)
-	{
-		logging::fatal("Renderer could not be created! SDL_Error: " + std::string(SDL_GetError()), logging::logSource::GPU);
-	}
-	screenTexture = SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_ARGB1555, SDL_TEXTUREACCESS_STREAMING, 1024, 512);
-
-	initOpenGL();
+	Renderer = createRenderer(type, window, vram);
+	Capture = nullptr;
+	VideoDump = nullptr;
+	stats = { 0, 0, 0 };
 	reset();
 }
 
 gpu::~gpu()
 {
-	glDeleteVertexArrays(1, &vertexArrayObject);
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
-	glDeleteProgram(program);
-	SDL_GL_DeleteContext(glContext);
+	delete(Capture);
+	delete(VideoDump);
+	delete(Renderer);
 	delete[] vram;
-	delete[] glBuffer;
 }
 
 void gpu::reset()
@@ -77,6 +70,7 @@ void gpu::reset()
 	gp1_resetCommandBuffer();
 
 	texWindowInfoUpdated();
+	drawingAreaUpdated();
 }
 
 void gpu::set32(uint32_t addr, uint32_t value)
@@ -85,6 +79,7 @@ void gpu::set32(uint32_t addr, uint32_t value)
 	{
 		case 0: // GP0 - for draw commands (triangles, rects etc.)
 		{
+			if (Capture) { Capture->gp0(value); }
 			if (gp0remainingCommands == 0)
 			{
 				currentGP0Instruction = getGP0Instr(value);
@@ -149,6 +144,7 @@ void gpu::set32(uint32_t addr, uint32_t value)
 		}
 		case 4: // GP1 - for GPU commands to set various GPU state stuff
 		{
+			if (Capture) { Capture->gp1(value); }
 			switch ((value >> 24) & 0x3F)
 			{
 				case 0x00: gp1_softReset(); break;
@@ -182,6 +178,7 @@ uint32_t gpu::get32(uint32_t addr)
 			}
 			else
 			{
+				if (Capture) { Capture->gpuRead(); }
 				gp0remainingCommands--; // just use gp0remainingCommands for the remaining words to transfer
 
 				uint32_t srcCoord = gp0commandBuffer[1];
@@ -273,6 +270,87 @@ uint16_t gpu::get16(uint32_t addr) { logging::fatal("unimplemented 16 bit GPU re
 void gpu::set8(uint32_t addr, uint8_t value) { logging::fatal("unimplemented 8 bit GPU write " + helpers::intToHex(addr), logging::logSource::GPU); }
 uint8_t gpu::get8(uint32_t addr) { logging::fatal("unimplemented 8 bit GPU read" + helpers::intToHex(addr), logging::logSource::GPU); return 0; }
 
+void gpu::startCapture(std::string path, uint32_t snapshotInterval)
+{
+	Renderer->draw(); // so the starting snapshot has everything drawn so far
+	delete(Capture);
+	Capture = new gpuCapture(path, snapshotInterval, vram);
+	std::vector<uint32_t> gp0Words;
+	std::vector<uint32_t> gp1Words;
+	getStateCommands(gp0Words, gp1Words);
+	Capture->state(gp0Words, gp1Words);
+}
+
+// The GP0 and GP1 commands that would put a freshly reset GPU into the current state
+void gpu::getStateCommands(std::vector<uint32_t>& gp0Words, std::vector<uint32_t>& gp1Words)
+{
+	gp0Words.push_back((0xE1u << 24) | texPageXBase | (texPageYBase << 4) | (semiTransparency << 5) | ((uint32_t)texPageColourDepth << 7) |
+		(dithering << 9) | (canDrawToDisplay << 10) | (texDisable << 11) | (texturedRectangleXFlip << 12) | (texturedRectangleYFlip << 13));
+	gp0Words.push_back((0xE2u << 24) | textureWindowXMask | (textureWindowYMask << 5) | (textureWindowXOffset << 10) | (textureWindowYOffset << 15));
+	gp0Words.push_back((0xE3u << 24) | drawingAreaLeft | (drawingAreaTop << 10));
+	gp0Words.push_back((0xE4u << 24) | drawingAreaRight | (drawingAreaBottom << 10));
+	gp0Words.push_back((0xE5u << 24) | (drawingXOffset & 0x7FF) | ((drawingYOffset & 0x7FF) << 11));
+	gp0Words.push_back((0xE6u << 24) | setMask | (preserveMaskedPixels << 1));
+	if (gp0Mode == GP0Mode::Command && gp0remainingCommands > 0)
+	{
+		// Part way through a command, so the rest of it in the capture still lines up
+		gp0Words.insert(gp0Words.end(), gp0commandBuffer, gp0commandBuffer + gp0commandBufferIndex);
+	}
+	else if (gp0Mode != GP0Mode::Command)
+	{
+		logging::warning("GPU capture started during a VRAM transfer, the start of the replay will be wrong", logging::logSource::GPU);
+	}
+
+	uint8_t hResFields = hResToFields(hRes);
+	gp1Words.push_back((0x03u << 24) | displayDisabled);
+	gp1Words.push_back((0x04u << 24) | (uint32_t)dmaDir);
+	gp1Words.push_back((0x05u << 24) | displayVRAMXStart | (displayVRAMYStart << 10));
+	gp1Words.push_back((0x06u << 24) | displayHorizontalStart | (displayHorizontalEnd << 12));
+	gp1Words.push_back((0x07u << 24) | displayLineStart | (displayLineEnd << 12));
+	gp1Words.push_back((0x08u << 24) | ((hResFields >> 1) & 3) | ((hResFields & 1) << 6) | ((uint32_t)vRes << 2) | ((uint32_t)vMode << 3) |
+		((uint32_t)dispColourDepth << 4) | (interlace << 5) | (reverseFlag << 7));
+}
+
+void gpu::startVideoDump(std::string path, uint32_t queueLength, videoDumpPolicy policy)
+{
+	delete(VideoDump);
+	VideoDump = new videoDump(path, queueLength, policy);
+}
+
+gpuStats gpu::getStats()
+{
+	return stats;
+}
+
+const uint8_t* gpu::getVRAM()
+{
+	return vram;
+}
+
+void gpu::loadVRAM(const uint8_t* data)
+{
+	Renderer->draw();
+	memcpy(vram, data, 2048 * 512);
+}
+
+DisplayArea gpu::getDisplayArea()
+{
+	DisplayArea area;
+	area.x = displayVRAMXStart;
+	area.y = displayVRAMYStart;
+	switch (hRes)
+	{
+		case horizontalRes::XRes256: area.width = 256; break;
+		case horizontalRes::XRes320: area.width = 320; break;
+		case horizontalRes::XRes512: area.width = 512; break;
+		case horizontalRes::XRes640: area.width = 640; break;
+		case horizontalRes::XRes368: area.width = 368; break;
+	}
+	area.height = (vRes == verticalRes::VRes480 && interlace) ? 480 : 240;
+	area.is24Bit = dispColourDepth == displayColourDepth::dispDepth24Bit;
+	return area;
+}
+
 void gpu::vramSet16(uint32_t addr, uint16_t value)
 {
 	vram[addr] = value & 0xFF;
@@ -292,15 +370,16 @@ gp0Instruction gpu::getGP0Instr(uint32_t value)
 		case 0x01: return { 1, &gpu::gp0_clearCache };
 		case 0x02: return { 3, &gpu::gp0_fillRectVRAM };
 		case 0x1F: return { 1, &gpu::gp0_interruptRequest };
-		case 0x28: return { 5, &gpu::gp0_quad_mono_opaque };
-		case 0x2C: return { 9, &gpu::gp0_quad_texture_blend_opaque };
-		case 0x30: return { 6, &gpu::gp0_tri_shaded_opaque };
-		case 0x38: return { 8, &gpu::gp0_quad_shaded_opaque };
-		case 0x3C: return { 12, &gpu::gp0_quad_shaded_texture_blend_opaque };
-		case 0x60: return { 3, &gpu::gp0_rect_mono_opaque };
-		case 0x64: return { 4, &gpu::gp0_rect_texture_blend_opaque };
-		case 0x68: return { 2, &gpu::gp0_rect_mono_1x1_opaque };
-		case 0x74: return { 3, &gpu::gp0_rect_texture_blend_8x8_opaque };
+		// The semi transparent versions share handlers, the flag is read from the opcode in pushTriangle
+		case 0x28: case 0x2A: return { 5, &gpu::gp0_quad_mono_opaque };
+		case 0x2C: case 0x2E: return { 9, &gpu::gp0_quad_texture_blend_opaque };
+		case 0x30: case 0x32: return { 6, &gpu::gp0_tri_shaded_opaque };
+		case 0x38: case 0x3A: return { 8, &gpu::gp0_quad_shaded_opaque };
+		case 0x3C: case 0x3E: return { 12, &gpu::gp0_quad_shaded_texture_blend_opaque };
+		case 0x60: case 0x62: return { 3, &gpu::gp0_rect_mono_opaque };
+		case 0x64: case 0x66: return { 4, &gpu::gp0_rect_texture_blend_opaque };
+		case 0x68: case 0x6A: return { 2, &gpu::gp0_rect_mono_1x1_opaque };
+		case 0x74: case 0x76: return { 3, &gpu::gp0_rect_texture_blend_8x8_opaque };
 		case 0xA0: return { 3, &gpu::gp0_copyRectCPUtoVRAM };
 		case 0xC0: return { 3, &gpu::gp0_copyRectVRAMtoCPU };
 		case 0xE1: return { 1, &gpu::gp0_drawModeSetting };
@@ -384,6 +463,7 @@ void gpu::gp1_softReset()
 	displayLineEnd = 0x100;
 
 	texWindowInfoUpdated();
+	drawingAreaUpdated();
 
 	gp1_resetCommandBuffer();
 	//should also clear command FIFO and texture cache
@@ -529,6 +609,7 @@ void gpu::gp0_quad_texture_blend_opaque()
 	ClutAttr clut = ClutAttr::fromGP0(gp0commandBuffer[2]);
 	TexPage texPage = TexPage::fromGP0(gp0commandBuffer[4]);
 	TextureColourDepth texDepth = TextureColourDepth::fromGP0(gp0commandBuffer[4]);
+	semiTransparency = (gp0commandBuffer[4] >> 21) & 3; // textured polygons bring their own blend equation
 	GLubyte blend = (GLubyte)BlendMode::BlendTexture;
 	pushQuad({ Position::fromGP0(gp0commandBuffer[1]), c, texPage, TexCoord::fromGP0(gp0commandBuffer[2]), clut, texDepth, blend },
 		{ Position::fromGP0(gp0commandBuffer[3]), c, texPage, TexCoord::fromGP0(gp0commandBuffer[4]), clut, texDepth, blend },
@@ -556,6 +637,7 @@ void gpu::gp0_quad_shaded_texture_blend_opaque()
 	ClutAttr clut = ClutAttr::fromGP0(gp0commandBuffer[2]);
 	TexPage texPage = TexPage::fromGP0(gp0commandBuffer[5]);
 	TextureColourDepth texDepth = TextureColourDepth::fromGP0(gp0commandBuffer[5]);
+	semiTransparency = (gp0commandBuffer[5] >> 21) & 3; // textured polygons bring their own blend equation
 	GLubyte blend = (GLubyte)BlendMode::BlendTexture;
 	pushQuad({ Position::fromGP0(gp0commandBuffer[1]), Colour::fromGP0(gp0commandBuffer[0]), texPage, TexCoord::fromGP0(gp0commandBuffer[2]), clut, texDepth, blend },
 		{ Position::fromGP0(gp0commandBuffer[4]), Colour::fromGP0(gp0commandBuffer[3]), texPage, TexCoord::fromGP0(gp0commandBuffer[5]), clut, texDepth, blend },
@@ -654,6 +736,7 @@ void gpu::gp0_setDrawAreaTopLeft()
 	uint32_t value = gp0commandBuffer[0];
 	drawingAreaLeft = value & 0x3FF;
 	drawingAreaTop = (value >> 10) & 0x3FF;
+	drawingAreaUpdated();
 }
 
 void gpu::gp0_setDrawAreaBottomRight()
@@ -661,6 +744,7 @@ void gpu::gp0_setDrawAreaBottomRight()
 	uint32_t value = gp0commandBuffer[0];
 	drawingAreaRight = value & 0x3FF;
 	drawingAreaBottom = (value >> 10) & 0x3FF;
+	drawingAreaUpdated();
 }
 
 void gpu::gp0_setDrawOffset()
@@ -670,6 +754,7 @@ void gpu::gp0_setDrawOffset()
 	uint16_t y = (value >> 11) & 0x7FF;
 	drawingXOffset = ((int16_t)(x << 5)) >> 5; // force sign extend
 	drawingYOffset = ((int16_t)(y << 5)) >> 5;
+	drawingAreaUpdated();
 }
 
 void gpu::gp0_maskBitSetting()
@@ -681,271 +766,54 @@ void gpu::gp0_maskBitSetting()
 
 void gpu::texWindowInfoUpdated()
 {
-	glUniform4ui(texWindowInfo, textureWindowXMask, textureWindowXOffset, textureWindowYMask, textureWindowYOffset);
+	Renderer->setTextureWindow({ textureWindowXMask, textureWindowYMask, textureWindowXOffset, textureWindowYOffset });
 }
 
-template <class T> Buffer<T>::Buffer()
+void gpu::drawingAreaUpdated()
 {
-	glGenBuffers(1, &bufObject);
-	glBindBuffer(GL_ARRAY_BUFFER, bufObject);
-
-	GLsizeiptr elementSize = sizeof(T);
-	GLsizeiptr bufferSize = elementSize * VERTEX_BUFFER_LEN;
-
-	glBufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
-	map = (T*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
-
-	memset(map, 0, bufferSize);
-}
-
-template <class T> Buffer<T>::~Buffer()
-{
-	glBindBuffer(GL_ARRAY_BUFFER, bufObject);
-	glUnmapBuffer(GL_ARRAY_BUFFER);
-	glDeleteBuffers(1, &bufObject);
+	Renderer->setDrawingArea({ drawingAreaLeft, drawingAreaTop, drawingAreaRight, drawingAreaBottom, drawingXOffset, drawingYOffset });
 }
 
-template <class T> void Buffer<T>::set(uint32_t index, T value)
+void gpu::pushTriangle(Vertex v1, Vertex v2, Vertex v3)
 {
-	if (index >= VERTEX_BUFFER_LEN)
+	// Vertex coordinates are signed 11 bit values relative to the drawing offset.
+	// Renderers are given absolute VRAM coordinates.
+	Vertex* v[3] = { &v1, &v2, &v3 };
+	for (Vertex* vertex : v)
 	{
-		logging::fatal("Vertex buffer overflow", logging::logSource::GPU);
+		vertex->position.x = (GLshort)(helpers::signExtend<int32_t>(vertex->position.x & 0x7FF, 11) + drawingXOffset);
+		vertex->position.y = (GLshort)(helpers::signExtend<int32_t>(vertex->position.y & 0x7FF, 11) + drawingYOffset);
 	}
-	map[index] = value;
-}
-
-void GLAPIENTRY GLDebugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
-{
-	logging::warning(std::string(message), logging::logSource::GPU);
-}
-
-void gpu::initOpenGL()
-{
-	const char* vertexShaderSrc =
-		"#version 330\n"
-		"in ivec2 vertex_position;\n"
-		"in uvec3 vertex_color;\n"
-		"in uvec2 texture_page;\n"
-		"in uvec2 texture_coord;\n"
-		"in uvec2 clut;\n"
-		"in uint texture_depth;\n"
-		"in uint texture_blend_mode;\n"
-		"out vec3 frag_color;\n"
-		"flat out uvec2 frag_texture_page;\n"
-		"out vec2 frag_texture_coord;\n"
-		"flat out uvec2 frag_clut;\n"
-		"flat out uint frag_texture_depth;\n"
-		"flat out uint frag_blend_mode;\n"
-		"void main() {\n"
-		"	float xpos = (float(vertex_position.x) / 512) - 1.0;\n"
-		"	float ypos = 1.0 - (float(vertex_position.y) / 256);\n"
-		"	gl_Position.xyzw = vec4(xpos, ypos, 0.0, 1.0);\n"
-		"	frag_color = vec3(float(vertex_color.r) / 255, float(vertex_color.g) / 255, float(vertex_color.b) / 255);\n"
-		"	frag_texture_page = texture_page;\n"
-		"	frag_texture_coord = vec2(texture_coord);\n"
-		"	frag_clut = clut;\n"
-		"	frag_texture_depth = texture_depth;\n"
-		"	frag_blend_mode = texture_blend_mode;\n"
-		"}\n";
-
-	const char* fragmentShaderSrc =
-		"#version 330\n"
-		"uniform sampler2D vramTexture;\n"
-		"uniform uvec4 texWindowInfo;\n"
-		"in vec3 frag_color;\n"
-		"flat in uvec2 frag_texture_page;\n"
-		"in vec2 frag_texture_coord;\n"
-		"flat in uvec2 frag_clut;\n"
-		"flat in uint frag_texture_depth;\n"
-		"flat in uint frag_blend_mode;\n"
-		"out vec4 o_color;\n"
-		"const uint BLEND_MODE_NO_TEXTURE = 0U;\n"
-		"const uint BLEND_MODE_RAW_TEXTURE = 1U;\n"
-		"const uint BLEND_MODE_TEXTURE_BLEND = 2U;\n"
-		"vec4 vram_get_pixel(uint x, uint y) {\n"
-		"	return texelFetch(vramTexture, ivec2(x & 0x3ffU, y & 0x1ffU), 0);\n"
-		"}\n"
-		"uint rebuild_psx_color(vec4 color) {\n"
-		"	uint a = uint(floor(color.a + 0.5));\n"
-		"	uint r = uint(floor(color.r * 31. + 0.5));\n"
-		"	uint g = uint(floor(color.g * 31. + 0.5));\n"
-		"	uint b = uint(floor(color.b * 31. + 0.5));\n"
-		"	return (a << 15) | (b << 10) | (g << 5) | r;\n"
-		"}\n"
-		"void main() {\n"
-		"	if (frag_blend_mode == BLEND_MODE_NO_TEXTURE) {\n"
-		"		o_color = vec4(frag_color, 1.0);\n"
-		"	} else {\n"
-		"		uint frag_texture_depth_new = frag_texture_depth;\n"
-		"		if ((frag_texture_depth & 1U) != 1U) { // Flip frag_texture_depth from 0, 1, 2 to 2, 1, 0\n"
-		"			frag_texture_depth_new ^= 0x2U;\n"
-		"		}\n"
-		"		uint pix_per_hw = 1U << frag_texture_depth_new;\n"
-		"		uint tex_x = uint(frag_texture_coord.x) & 0xffU;\n"
-		"		uint tex_y = uint(frag_texture_coord.y) & 0xffU;\n"
-		"		tex_x = (tex_x & (~(texWindowInfo.x << 3U))) | ((texWindowInfo.z & texWindowInfo.x) << 3U);\n"
-		"		tex_y = (tex_y & (~(texWindowInfo.y << 3U))) | ((texWindowInfo.w & texWindowInfo.x) << 3U);\n"
-		"		uint tex_x_pix = tex_x / pix_per_hw;\n"
-		"		tex_x_pix += frag_texture_page.x;\n"
-		"		tex_y += frag_texture_page.y;\n"
-		"		vec4 texel = vram_get_pixel(tex_x_pix, tex_y);\n"
-		"		if (frag_texture_depth_new > 0U) {\n"
-		"			uint icolor = rebuild_psx_color(texel);\n"
-		"			uint bpp = 16U >> frag_texture_depth_new;\n"
-		"			uint mask = ((1U << bpp) - 1U);\n"
-		"			uint align = tex_x & ((1U << frag_texture_depth_new) - 1U);\n"
-		"			uint shift = (align * bpp);\n"
-		"			uint index = (icolor >> shift) & mask;\n"
-		"			uint clut_x = frag_clut.x + index;\n"
-		"			uint clut_y = frag_clut.y;\n"
-		"			texel = vram_get_pixel(clut_x, clut_y);\n"
-		"		}\n"
-		"		if (rebuild_psx_color(texel) == 0U) {\n"
-		"			discard;\n"
-		"		}\n"
-		"		if (frag_blend_mode == BLEND_MODE_RAW_TEXTURE) {\n"
-		"			o_color = vec4(texel.rgb, 1.0);\n"
-		"		} else {\n"
-		"			o_color = vec4(frag_color * 2. * texel.rgb, 1.0);\n"
-		"		}\n"
-		"	}\n"
-		"}\n";
-
-	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-	SDL_GL_SetAttribute(SDL_GL_ACCELERATED_VISUAL, 1);
-	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
-	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
-
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
-
-	glContext = SDL_GL_CreateContext(sdlWindow);
-	GLenum err = glewInit();
-	if (err != GLEW_OK)
-	{
-		logging::fatal("GLEW init error: " + std::string((char*)glewGetErrorString(err)), logging::logSource::GPU);
-	}
-	glEnable(GL_DEBUG_OUTPUT);
-	glDebugMessageCallback(GLDebugCallback, 0);
-
-	vertexShader = compileShader(vertexShaderSrc, GL_VERTEX_SHADER);
-	fragmentShader = compileShader(fragmentShaderSrc, GL_FRAGMENT_SHADER);
-
-	program = linkProgram(std::list<GLuint>{vertexShader, fragmentShader});
-
-	glUseProgram(program);
-
-	glDisable(GL_DEPTH_TEST);
-	glClearColor(0.0, 0.0, 0.0, 0.0);
-	glViewport(0, 0, 1024, 512);
-
-	glGenVertexArrays(1, &vertexArrayObject);
-	glBindVertexArray(vertexArrayObject);
-
-	GLsizei stride = sizeof(Vertex);
-	uint64_t offset = 0;
-	vertices = new Buffer<Vertex>();
-
-	glBindAttribLocation(program, 0, "vertex_position");
-	glEnableVertexAttribArray(0);
-	glVertexAttribIPointer(0, 2, GL_SHORT, stride, (void*)offset);
-	offset += sizeof(Position);
-
-	glBindAttribLocation(program, 1, "vertex_color");
-	glEnableVertexAttribArray(1);
-	glVertexAttribIPointer(1, 3, GL_UNSIGNED_BYTE, stride, (void*)offset);
-	offset += sizeof(Colour);
-
-	glBindAttribLocation(program, 2, "texture_page");
-	glEnableVertexAttribArray(2);
-	glVertexAttribIPointer(2, 2, GL_UNSIGNED_SHORT, stride, (void*)offset);
-	offset += sizeof(TexPage);
-
-	glBindAttribLocation(program, 3, "texture_coord");
-	glEnableVertexAttribArray(3);
-	glVertexAttribIPointer(3, 2, GL_UNSIGNED_BYTE, stride, (void*)offset);
-	offset += sizeof(TexCoord);
-
-	glBindAttribLocation(program, 4, "clut");
-	glEnableVertexAttribArray(4);
-	glVertexAttribIPointer(4, 2, GL_UNSIGNED_SHORT, stride, (void*)offset);
-	offset += sizeof(ClutAttr);
-
-	glBindAttribLocation(program, 5, "texture_depth");
-	glEnableVertexAttribArray(5);
-	glVertexAttribIPointer(5, 1, GL_UNSIGNED_BYTE, stride, (void*)offset);
-	offset += sizeof(TextureColourDepth);
-
-	glBindAttribLocation(program, 6, "texture_blend_mode");
-	glEnableVertexAttribArray(6);
-	glVertexAttribIPointer(6, 1, GL_UNSIGNED_BYTE, stride, (void*)offset);
-	offset += sizeof(GLubyte);
-
-	glGenTextures(1, &vramTexture);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, vramTexture);
-	glUniform1i(glGetUniformLocation(program, "vramTexture"), 0);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-	texWindowInfo = glGetUniformLocation(program, "texWindowInfo");
-
-	nVertices = 0;
+	pushAbsoluteTriangle(v1, v2, v3);
 }
 
-GLuint gpu::compileShader(const char* str, GLenum shaderType)
+// Vertices already in absolute VRAM coordinates
+void gpu::pushAbsoluteTriangle(Vertex v1, Vertex v2, Vertex v3)
 {
-	GLuint shader = glCreateShader(shaderType);
-
-	int length = (int)strlen(str);
-	glShaderSource(shader, 1, (const GLchar**)&str, &length);
-	glCompileShader(shader);
-
-	GLint status;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-	if (status == GL_FALSE)
-	{
-		logging::fatal("Shader compilation failed: " + std::string(str), logging::logSource::GPU);
-	}
-	return shader;
-}
+	int32_t minX = std::min({ v1.position.x, v2.position.x, v3.position.x });
+	int32_t maxX = std::max({ v1.position.x, v2.position.x, v3.position.x });
+	int32_t minY = std::min({ v1.position.y, v2.position.y, v3.position.y });
+	int32_t maxY = std::max({ v1.position.y, v2.position.y, v3.position.y });
+	int32_t area = ((v2.position.x - v1.position.x) * (v3.position.y - v1.position.y)) - ((v3.position.x - v1.position.x) * (v2.position.y - v1.position.y));
 
-GLuint gpu::linkProgram(std::list<GLuint> shaders)
-{
-	GLuint program = glCreateProgram();
-	for (GLuint shader : shaders)
+	// The real GPU skips polygons that are too big rather than clipping them
+	bool oversized = (maxX - minX) > 1023 || (maxY - minY) > 511;
+	bool offArea = maxX < drawingAreaLeft || minX > drawingAreaRight || maxY < drawingAreaTop || minY > drawingAreaBottom;
+	if (area == 0 || oversized || offArea)
 	{
-		glAttachShader(program, shader);
+		stats.culled++;
+		return;
 	}
-	glLinkProgram(program);
 
-	GLint status;
-	glGetProgramiv(program, GL_LINK_STATUS, &status);
-	if (status == GL_FALSE)
-	{
-		logging::fatal("OpenGL program linking failed", logging::logSource::GPU);
-	}
-	return program;
-}
+	// Bit 1 of the opcode is semi transparency, dithering only applies to shaded or texture blended polygons
+	uint8_t opcode = gp0commandBuffer[0] >> 24;
+	bool polygon = (opcode & 0xE0) == 0x20;
+	bool shadedOrBlended = (opcode & 0x10) || ((opcode & 0x04) && !(opcode & 0x01));
+	Renderer->setDrawState({ (opcode & 0x02) != 0, semiTransparency, dithering && polygon && shadedOrBlended, setMask, preserveMaskedPixels });
 
-void gpu::pushTriangle(Vertex v1, Vertex v2, Vertex v3)
-{
-	if (nVertices + 3 > VERTEX_BUFFER_LEN)
-	{
-		logging::warning("Vertex buffers full, forcing draw", logging::logSource::GPU);
-		draw();
-	}
-	vertices->set(nVertices, v1);
-	nVertices++;
-	vertices->set(nVertices, v2);
-	nVertices++;
-	vertices->set(nVertices, v3);
-	nVertices++;
+	stats.primitives++;
+	stats.pixels += std::abs(area) / 2;
+	Renderer->pushTriangle(v1, v2, v3);
 }
 
 void gpu::pushQuad(Vertex v1, Vertex v2, Vertex v3, Vertex v4)
@@ -958,58 +826,38 @@ void gpu::pushRect(Rectangle r)
 {
 	// for widths and heights greater that 255, textures should repeat
 	// right now, it's just being clamped
-	Vertex v1 = { r.position, r.colour, { texPageXBase, texPageYBase }, r.texCoord, r.clut, TextureColourDepth::fromValue(texPageColourDepth), r.blendMode };
-	Vertex v2 = { { r.position.x + r.widthHeight.width, r.position.y }, r.colour, { texPageXBase, texPageYBase }, { (GLubyte)(r.texCoord.x + (GLubyte)(r.widthHeight.width)), r.texCoord.y }, r.clut, TextureColourDepth::fromValue(texPageColourDepth), r.blendMode };
-	Vertex v3 = { { r.position.x, r.position.y + r.widthHeight.height }, r.colour, { texPageXBase, texPageYBase }, { r.texCoord.x, (GLubyte)(r.texCoord.y + (GLubyte)r.widthHeight.height) }, r.clut, TextureColourDepth::fromValue(texPageColourDepth), r.blendMode };
-	Vertex v4 = { { r.position.x + r.widthHeight.width, r.position.y + r.widthHeight.height }, r.colour, { texPageXBase, texPageYBase }, { (GLubyte)(r.texCoord.x + (GLubyte)r.widthHeight.width), (GLubyte)(r.texCoord.y + (GLubyte)r.widthHeight.height) }, r.clut, TextureColourDepth::fromValue(texPageColourDepth), r.blendMode };
-	pushQuad(v1, v2, v3, v4);
-}
-
-void gpu::draw()
-{
-	if (nVertices == 0) { return; }
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1024, 512, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, vram);
-	glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
-	glDrawArrays(GL_TRIANGLES, 0, nVertices);
-
-	// Wait for GPU (should probably change this later)
-	GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-	bool drawingDone = false;
-	while (!drawingDone)
+	// Sizes are 10 and 9 bits on the hardware, the rest of the command word is ignored
+	r.widthHeight.width &= 0x3FF;
+	r.widthHeight.height &= 0x1FF;
+	int32_t x = helpers::signExtend<int32_t>(r.position.x & 0x7FF, 11) + drawingXOffset;
+	int32_t y = helpers::signExtend<int32_t>(r.position.y & 0x7FF, 11) + drawingYOffset;
+	if (x > drawingAreaRight || y > drawingAreaBottom || x + r.widthHeight.width <= drawingAreaLeft || y + r.widthHeight.height <= drawingAreaTop)
 	{
-		GLenum wait = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 10000000);
-		if (wait == GL_ALREADY_SIGNALED || wait == GL_CONDITION_SATISFIED)
-		{
-			drawingDone = true;
-		}
+		stats.culled += 2;
+		return;
 	}
-	nVertices = 0;
+	// Only the origin is an 11 bit coordinate, the corners are built from it after the offset so they can't wrap
+	GLshort left = (GLshort)x;
+	GLshort top = (GLshort)y;
+	GLshort right = (GLshort)(x + r.widthHeight.width);
+	GLshort bottom = (GLshort)(y + r.widthHeight.height);
+	GLubyte texRight = (GLubyte)(r.texCoord.x + r.widthHeight.width);
+	GLubyte texBottom = (GLubyte)(r.texCoord.y + r.widthHeight.height);
+	TexPage texPage = { (GLushort)(texPageXBase * 64), (GLushort)(texPageYBase * 256) };
+	TextureColourDepth depth = TextureColourDepth::fromValue(texPageColourDepth);
+	Vertex v1 = { { left, top }, r.colour, texPage, r.texCoord, r.clut, depth, r.blendMode };
+	Vertex v2 = { { right, top }, r.colour, texPage, { texRight, r.texCoord.y }, r.clut, depth, r.blendMode };
+	Vertex v3 = { { left, bottom }, r.colour, texPage, { r.texCoord.x, texBottom }, r.clut, depth, r.blendMode };
+	Vertex v4 = { { right, bottom }, r.colour, texPage, { texRight, texBottom }, r.clut, depth, r.blendMode };
+	pushAbsoluteTriangle(v1, v2, v3);
+	pushAbsoluteTriangle(v2, v3, v4);
 }
 
 void gpu::display()
 {
-	draw();
-	//SDL_GL_SwapWindow(sdlWindow);
-	glReadPixels(0, 0, 1024, 512, GL_BGRA, GL_UNSIGNED_SHORT_1_5_5_5_REV, glBuffer);
-	for (int32_t i = 0; i < 2048 * 512; i += 2)
-	{
-		int32_t row = i / 2048;
-		int32_t col = i % 2048;
-		row = (512 - row) - 1;
-		if (glBuffer[i + 1] & 0x80)
-		{
-			int32_t yPos = row + drawingYOffset;
-			int32_t xPos = col + (drawingXOffset * 2);
-			if (xPos >= drawingAreaLeft * 2 && xPos <= drawingAreaRight * 2 && yPos >= drawingAreaTop && yPos <= drawingAreaBottom)
-			{
-				vram[(yPos * 2048) + xPos] = glBuffer[i];
-				vram[(yPos * 2048) + xPos + 1] = glBuffer[i + 1];
-			}
-		}
-	}
-	SDL_UpdateTexture(screenTexture, NULL, vram, 2048);
-	SDL_RenderCopy(sdlRenderer, screenTexture, NULL, NULL);
-	SDL_RenderPresent(sdlRenderer);
+	Renderer->display();
+	if (Capture) { Capture->frame(vram); }
+	if (VideoDump) { VideoDump->pushFrame(vram, getDisplayArea()); }
 
 	InterruptController->requestInterrupt(interruptType::VBLANK); // temporary
 }
\ No newline at end of file
@@ -2,160 +2,10 @@
 #include "helpers.hpp"
 #include "peripheral.hpp"
 #include "interrupt.hpp"
-
-enum class textureColourDepthValue : uint8_t
-{
-	texDepth4Bit = 0,
-	texDepth8Bit = 1,
-	texDepth15Bit = 2
-};
-
-enum class BlendMode : uint8_t
-{
-	NoTexture = 0,
-	RawTexture = 1,
-	BlendTexture = 2
-};
-
-#pragma pack(push, 1)
-struct Position
-{
-	GLshort x;
-	GLshort y;
-
-	static Position fromGP0(uint32_t value)
-	{
-		return { (GLshort)(value & 0xFFFF), (GLshort)(value >> 16) };
-	}
-};
-
-struct Colour
-{
-	GLubyte r;
-	GLubyte g;
-	GLubyte b;
-
-	static Colour fromGP0(uint32_t value)
-	{
-		return { (GLubyte)(value & 0xFF), (GLubyte)((value >> 8) & 0xFF), (GLubyte)((value >> 16) & 0xFF) };
-	}
-};
-
-struct TexPage
-{
-	GLushort xBase;
-	GLushort yBase;
-
-	static TexPage fromGP0(uint32_t value)
-	{
-		GLushort x = ((value >> 16) & 0xF) * 64;
-		GLushort y = (((value >> 16) >> 4) & 1) * 256;
-		return { x, y };
-	}
-};
-
-struct TexCoord
-{
-	GLubyte x;
-	GLubyte y;
-
-	static TexCoord fromGP0(uint32_t value)
-	{
-		return { value & 0xFF, (value >> 8) & 0xFF };
-	}
-};
-
-struct ClutAttr
-{
-	GLushort x;
-	GLushort y;
-
-	static ClutAttr fromGP0(uint32_t value)
-	{
-		return { ((value >> 16) & 0x3F) * 16, ((value >> 16) >> 6) & 0x1FF };
-	}
-};
-
-struct TextureColourDepth
-{
-	GLubyte depth;
-
-	static TextureColourDepth fromGP0(uint32_t value)
-	{
-		return { ((value >> 16) >> 7) & 0x3 };
-	}
-
-	static TextureColourDepth fromValue(textureColourDepthValue value)
-	{
-		return { (GLubyte)value };
-	}
-};
-
-struct Vertex
-{
-	Position position;
-	Colour colour;
-	TexPage texPage;
-	TexCoord texCoord;
-	ClutAttr clut;
-	TextureColourDepth texDepth;
-	GLubyte blendMode;
-
-	Vertex(Position p, Colour c, TexPage t = { 0, 0 }, TexCoord tc = { 0, 0 }, ClutAttr ca = { 0, 0 }, TextureColourDepth td = { 0 }, GLubyte bm = 0)
-	{
-		position = p;
-		colour = c;
-		texPage = t;
-		texCoord = tc;
-		clut = ca;
-		texDepth = td;
-		blendMode = bm;
-	}
-};
-#pragma pack(pop)
-
-struct RectWidthHeight
-{
-	GLshort width;
-	GLshort height;
-
-	static RectWidthHeight fromGP0(uint32_t value)
-	{
-		return { (GLshort)(value & 0xFFFF), (GLshort)(value >> 16) };
-	}
-};
-
-struct Rectangle
-{
-	Position position;
-	Colour colour;
-	RectWidthHeight widthHeight;
-	TexCoord texCoord;
-	ClutAttr clut;
-	GLubyte blendMode;
-
-	Rectangle(Position p, Colour c, RectWidthHeight wh, TexCoord tc = { 0, 0 }, ClutAttr ca = { 0, 0 }, GLubyte bm = 0)
-	{
-		position = p;
-		colour = c;
-		widthHeight = wh;
-		texCoord = tc;
-		clut = ca;
-		blendMode = bm;
-	}
-};
-
-// was 65536, increased based on it overflowing in amidog cpu test
-#define VERTEX_BUFFER_LEN 131072
-template <class T> struct Buffer
-{
-	GLuint bufObject;
-	T* map;
-
-	Buffer();
-	~Buffer();
-	void set(uint32_t index, T value);
-};
+#include "renderer.hpp"
+#include "gpuCapture.hpp"
+class videoDump; // forward declare instead of include to solve circular dependency
+enum class videoDumpPolicy;
 
 enum class horizontalRes
 {
@@ -207,10 +57,27 @@ struct gp0Instruction
 	void (gpu::* func)();
 };
 
+struct gpuStats
+{
+	uint64_t primitives; // triangles sent to the renderer
+	uint64_t pixels; // covered area of those triangles
+	uint64_t culled; // triangles rejected before reaching the renderer
+};
+
+// The part of VRAM that is being sent to the TV
+struct DisplayArea
+{
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+	bool is24Bit;
+};
+
 class gpu : public peripheral
 {
 	public:
-		gpu(SDL_Window* window, interruptController* i);
+		gpu(SDL_Window* window, interruptController* i, rendererType type);
 		~gpu();
 		void reset();
 		void display();
@@ -220,8 +87,17 @@ class gpu : public peripheral
 		uint16_t get16(uint32_t addr);
 		void set8(uint32_t addr, uint8_t value);
 		uint8_t get8(uint32_t addr);
+		void startCapture(std::string path, uint32_t snapshotInterval);
+		void startVideoDump(std::string path, uint32_t queueLength, videoDumpPolicy policy);
+		gpuStats getStats();
+		const uint8_t* getVRAM();
+		void loadVRAM(const uint8_t* data);
+		DisplayArea getDisplayArea();
 	private:
 		interruptController* InterruptController;
+		gpuCapture* Capture;
+		videoDump* VideoDump;
+		gpuStats stats;
 		void vramSet16(uint32_t addr, uint16_t value);
 		uint16_t vramGet16(uint32_t addr);
 		uint8_t* vram;
@@ -276,6 +152,7 @@ class gpu : public peripheral
 		uint16_t displayLineStart;
 		uint16_t displayLineEnd;
 
+		void getStateCommands(std::vector<uint32_t>& gp0Words, std::vector<uint32_t>& gp1Words);
 		horizontalRes hResFromFields(uint8_t fields);
 		uint8_t hResToFields(horizontalRes hr);
 
@@ -315,27 +192,11 @@ class gpu : public peripheral
 		void gp0_maskBitSetting();
 
 		void texWindowInfoUpdated();
+		void drawingAreaUpdated();
 
-		// Renderer Stuff
-		SDL_Renderer* sdlRenderer;
-		SDL_Texture* screenTexture;
-		uint8_t* glBuffer;
-
-		SDL_Window* sdlWindow;
-		SDL_GLContext glContext;
-		GLuint vertexArrayObject;
-		GLuint vertexShader;
-		GLuint fragmentShader;
-		GLuint program;
-		GLuint vramTexture;
-		GLint texWindowInfo;
-		Buffer<Vertex>* vertices;
-		uint32_t nVertices;
-		void initOpenGL();
-		GLuint compileShader(const char* str, GLenum shaderType);
-		GLuint linkProgram(std::list<GLuint> shaders);
+		renderer* Renderer;
 		void pushTriangle(Vertex v1, Vertex v2, Vertex v3);
+		void pushAbsoluteTriangle(Vertex v1, Vertex v2, Vertex v3);
 		void pushQuad(Vertex v1, Vertex v2, Vertex v3, Vertex v4);
 		void pushRect(Rectangle r);
-		void draw();
 };
\ No newline at end of file
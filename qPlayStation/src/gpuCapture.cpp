@@ -0,0 +1,285 @@
+#include "gpuCapture.hpp"
+#include "gpu.hpp"
+#include <chrono>
+#include <algorithm>
+
+#define VRAM_SIZE (2048 * 512)
+
+gpuCapture::gpuCapture(std::string path, uint32_t interval, const uint8_t* vram)
+{
+	file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		logging::fatal("unable to open GPU capture file: " + path, logging::logSource::GPU);
+	}
+	snapshotInterval = interval;
+	frameCount = 0;
+	gp0Run.reserve(0x10000);
+
+	file.write(captureMagic, sizeof(captureMagic));
+	writeVRAM(vram);
+	logging::info("Capturing GPU commands to " + path, logging::logSource::GPU);
+}
+
+gpuCapture::~gpuCapture()
+{
+	flushGP0();
+	file.close();
+}
+
+// Written straight after the starting VRAM snapshot, so a capture started after reset replays from the same state
+void gpuCapture::state(const std::vector<uint32_t>& gp0Words, const std::vector<uint32_t>& gp1Words)
+{
+	writeRecord(captureRecord::State);
+	write32((uint32_t)gp0Words.size());
+	for (uint32_t word : gp0Words)
+	{
+		write32(word);
+	}
+	write32((uint32_t)gp1Words.size());
+	for (uint32_t word : gp1Words)
+	{
+		write32(word);
+	}
+}
+
+void gpuCapture::gp0(uint32_t value)
+{
+	gp0Run.push_back(value);
+	if (gp0Run.size() >= 0x10000)
+	{
+		flushGP0();
+	}
+}
+
+void gpuCapture::gp1(uint32_t value)
+{
+	flushGP0();
+	writeRecord(captureRecord::GP1);
+	write32(value);
+}
+
+void gpuCapture::gpuRead()
+{
+	flushGP0();
+	writeRecord(captureRecord::GPURead);
+}
+
+void gpuCapture::frame(const uint8_t* vram)
+{
+	flushGP0();
+	writeRecord(captureRecord::Frame);
+	frameCount++;
+	if (snapshotInterval != 0 && (frameCount % snapshotInterval) == 0)
+	{
+		writeVRAM(vram);
+	}
+}
+
+void gpuCapture::flushGP0()
+{
+	if (gp0Run.empty()) { return; }
+	writeRecord(captureRecord::GP0);
+	write32((uint32_t)gp0Run.size());
+	for (uint32_t word : gp0Run)
+	{
+		write32(word);
+	}
+	gp0Run.clear();
+}
+
+void gpuCapture::writeRecord(captureRecord type)
+{
+	file.put((char)type);
+}
+
+void gpuCapture::write32(uint32_t value)
+{
+	char bytes[4] = { (char)(value & 0xFF), (char)((value >> 8) & 0xFF), (char)((value >> 16) & 0xFF), (char)(value >> 24) };
+	file.write(bytes, 4);
+}
+
+void gpuCapture::writeVRAM(const uint8_t* vram)
+{
+	writeRecord(captureRecord::VRAM);
+	file.write((const char*)vram, VRAM_SIZE);
+}
+
+gpuReplay::gpuReplay(std::string path, gpu* g)
+{
+	GPU = g;
+	readPos = 0;
+
+	std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		logging::fatal("unable to open GPU capture file: " + path, logging::logSource::GPU);
+	}
+	size_t size = (size_t)file.tellg();
+	data.resize(size);
+	file.seekg(0, std::ios::beg);
+	file.read((char*)data.data(), size);
+	file.close();
+
+	if (size < sizeof(captureMagic) || memcmp(data.data(), captureMagic, sizeof(captureMagic)) != 0)
+	{
+		logging::fatal("not a GPU capture file (or wrong version): " + path, logging::logSource::GPU);
+	}
+	readPos = sizeof(captureMagic);
+}
+
+uint8_t gpuReplay::read8()
+{
+	if (readPos + 1 > data.size())
+	{
+		logging::fatal("GPU capture file is truncated", logging::logSource::GPU);
+	}
+	return data[readPos++];
+}
+
+uint32_t gpuReplay::read32()
+{
+	if (readPos + 4 > data.size())
+	{
+		logging::fatal("GPU capture file is truncated", logging::logSource::GPU);
+	}
+	uint32_t ret = data[readPos] | (data[readPos + 1] << 8) | (data[readPos + 2] << 16) | (((uint32_t)data[readPos + 3]) << 24);
+	readPos += 4;
+	return ret;
+}
+
+replayResults gpuReplay::run()
+{
+	replayResults results = {};
+	bool firstSnapshot = true;
+
+	gpuStats statsBefore = GPU->getStats();
+	auto start = std::chrono::steady_clock::now();
+	auto frameStart = start;
+
+	while (readPos < data.size())
+	{
+		captureRecord type = (captureRecord)read8();
+		switch (type)
+		{
+			case captureRecord::GP0:
+			{
+				uint32_t count = read32();
+				for (uint32_t i = 0; i < count; i++)
+				{
+					GPU->set32(0, read32());
+				}
+				break;
+			}
+			case captureRecord::GP1: GPU->set32(4, read32()); break;
+			case captureRecord::State:
+			{
+				uint32_t gp0Count = read32();
+				for (uint32_t i = 0; i < gp0Count; i++)
+				{
+					GPU->set32(0, read32());
+				}
+				uint32_t gp1Count = read32();
+				for (uint32_t i = 0; i < gp1Count; i++)
+				{
+					GPU->set32(4, read32());
+				}
+				break;
+			}
+			case captureRecord::GPURead: GPU->get32(0); break;
+			case captureRecord::Frame:
+			{
+				GPU->display();
+				auto now = std::chrono::steady_clock::now();
+				results.frameTimes.push_back(std::chrono::duration<double, std::milli>(now - frameStart).count());
+				frameStart = now;
+				results.frames++;
+				break;
+			}
+			case captureRecord::VRAM:
+			{
+				if (readPos + VRAM_SIZE > data.size())
+				{
+					logging::fatal("GPU capture file is truncated", logging::logSource::GPU);
+				}
+				const uint8_t* snapshot = &data[readPos];
+				readPos += VRAM_SIZE;
+				if (firstSnapshot)
+				{
+					// The first snapshot is the starting state, later ones are just for checking the result
+					GPU->loadVRAM(snapshot);
+					firstSnapshot = false;
+				}
+				else
+				{
+					const uint8_t* vram = GPU->getVRAM();
+					for (uint32_t i = 0; i < VRAM_SIZE; i += 2)
+					{
+						if (vram[i] != snapshot[i] || vram[i + 1] != snapshot[i + 1])
+						{
+							results.snapshotPixelsDiffering++;
+						}
+					}
+					results.snapshotsChecked++;
+				}
+				break;
+			}
+			default: logging::fatal("Invalid record in GPU capture file: " + helpers::intToHex((uint8_t)type), logging::logSource::GPU); break;
+		}
+	}
+
+	auto end = std::chrono::steady_clock::now();
+	results.totalSeconds = std::chrono::duration<double>(end - start).count();
+	gpuStats statsAfter = GPU->getStats();
+	results.primitives = statsAfter.primitives - statsBefore.primitives;
+	results.pixels = statsAfter.pixels - statsBefore.pixels;
+	results.culled = statsAfter.culled - statsBefore.culled;
+	results.vramHash = hashVRAM(GPU->getVRAM());
+	return results;
+}
+
+void gpuReplay::report(replayResults results, bool showHash)
+{
+	double seconds = std::max(results.totalSeconds, 1e-9);
+	logging::important("Replayed " + std::to_string(results.frames) + " frames in " + std::to_string(results.totalSeconds) + "s", logging::logSource::GPU);
+	logging::important("Primitives: " + std::to_string(results.primitives) + " (" + std::to_string((uint64_t)(results.primitives / seconds)) + "/s)", logging::logSource::GPU);
+	logging::important("Pixels: " + std::to_string(results.pixels) + " (" + std::to_string((uint64_t)(results.pixels / seconds)) + "/s)", logging::logSource::GPU);
+	logging::important("Culled before rendering: " + std::to_string(results.culled), logging::logSource::GPU);
+
+	if (!results.frameTimes.empty())
+	{
+		std::vector<double> sorted = results.frameTimes;
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0;
+		for (double t : sorted) { total += t; }
+		logging::important("Frame times (ms): min " + std::to_string(sorted.front()) +
+			", avg " + std::to_string(total / sorted.size()) +
+			", p99 " + std::to_string(sorted[(sorted.size() * 99) / 100]) +
+			", max " + std::to_string(sorted.back()), logging::logSource::GPU);
+	}
+	if (results.snapshotsChecked > 0)
+	{
+		logging::important("Checked " + std::to_string(results.snapshotsChecked) + " VRAM snapshots, " + std::to_string(results.snapshotPixelsDiffering) + " pixels differ", logging::logSource::GPU);
+	}
+	if (showHash)
+	{
+		std::ostringstream stream;
+		stream << std::hex << std::uppercase;
+		stream.width(16);
+		stream.fill('0');
+		stream << results.vramHash;
+		logging::important("VRAM hash: " + stream.str(), logging::logSource::GPU);
+	}
+}
+
+// 64 bit FNV-1a
+uint64_t gpuReplay::hashVRAM(const uint8_t* vram)
+{
+	uint64_t hash = 0xCBF29CE484222325;
+	for (uint32_t i = 0; i < VRAM_SIZE; i++)
+	{
+		hash ^= vram[i];
+		hash *= 0x100000001B3;
+	}
+	return hash;
+}
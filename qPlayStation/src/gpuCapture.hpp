@@ -0,0 +1,68 @@
+#pragma once
+#include "helpers.hpp"
+class gpu; // forward declare instead of include to solve circular dependency
+
+// Capture files start with "QPSGCAP" + a version byte, then a stream of records.
+// All values are little endian.
+enum class captureRecord : uint8_t
+{
+	GP0 = 0,		// uint32_t word count, then that many GP0 words
+	GP1 = 1,		// one uint32_t GP1 word
+	GPURead = 2,	// a read from GPUREAD, replayed so VRAM to CPU copies stay in step
+	Frame = 3,		// gpu::display() was called
+	VRAM = 4,		// a full 1MB copy of VRAM
+	State = 5		// the GPU registers when the capture started, as the commands that set them: uint32_t count then GP0 words, uint32_t count then GP1 words
+};
+
+const char captureMagic[8] = { 'Q', 'P', 'S', 'G', 'C', 'A', 'P', 1 };
+
+// Records all traffic to the GPU registers so it can be replayed without the rest of the system
+class gpuCapture
+{
+	public:
+		gpuCapture(std::string path, uint32_t snapshotInterval, const uint8_t* vram);
+		~gpuCapture();
+		void state(const std::vector<uint32_t>& gp0Words, const std::vector<uint32_t>& gp1Words);
+		void gp0(uint32_t value);
+		void gp1(uint32_t value);
+		void gpuRead();
+		void frame(const uint8_t* vram);
+	private:
+		std::ofstream file;
+		std::vector<uint32_t> gp0Run; // consecutive GP0 writes are stored as one record
+		uint32_t snapshotInterval;
+		uint32_t frameCount;
+		void flushGP0();
+		void writeRecord(captureRecord type);
+		void write32(uint32_t value);
+		void writeVRAM(const uint8_t* vram);
+};
+
+struct replayResults
+{
+	uint64_t frames;
+	uint64_t primitives;
+	uint64_t pixels;
+	uint64_t culled;
+	double totalSeconds;
+	std::vector<double> frameTimes; // in milliseconds
+	uint32_t snapshotsChecked;
+	uint64_t snapshotPixelsDiffering;
+	uint64_t vramHash;
+};
+
+// Feeds a capture file into a gpu as fast as possible
+class gpuReplay
+{
+	public:
+		gpuReplay(std::string path, gpu* g);
+		replayResults run();
+		static void report(replayResults results, bool showHash);
+		static uint64_t hashVRAM(const uint8_t* vram);
+	private:
+		gpu* GPU;
+		std::vector<uint8_t> data;
+		size_t readPos;
+		uint8_t read8();
+		uint32_t read32();
+};
@@ -1,98 +1,13 @@
 #include "gte.hpp"
+#include <algorithm>
 
 // The GTE is mostly pulled straight from mednafen.
 
-typedef struct
-{
-    int16_t MX[3][3];
-    int16_t dummy;
-} gtematrix;
-
-typedef struct
-{
-    union
-    {
-        struct
-        {
-            uint8_t R;
-            uint8_t G;
-            uint8_t B;
-            uint8_t CD;
-        };
-        uint8_t Raw8[4];
-    };
-} gtergb;
-
-typedef struct
-{
-    int16_t X;
-    int16_t Y;
-} gtexy;
-
-static uint32_t CR[32];
-static uint32_t FLAGS;
-
-typedef union
-{
-    gtematrix All[4];
-    int32_t Raw[4][5];
-    int16_t Raw16[4][10];
-
-    struct
-    {
-        gtematrix Rot;
-        gtematrix Light;
-        gtematrix Color;
-        gtematrix AbbyNormal;
-    };
-} Matrices_t;
-
-static Matrices_t Matrices;
-
-static union
-{
-    int32_t All[4][4];	// Really only [4][3], but [4] to ease address calculation.
-
-    struct
-    {
-        int32_t T[4];
-        int32_t B[4];
-        int32_t FC[4];
-        int32_t Null[4];
-    };
-} CRVectors;
-
-static int32_t OFX;
-static int32_t OFY;
-static uint16_t H;
-static int16_t DQA;
-static int32_t DQB;
-
-static int16_t ZSF3;
-static int16_t ZSF4;
-
-// Begin DR
-static int16_t Vectors[3][4];
-static gtergb RGB;
-static uint16_t OTZ;
-
-static int16_t IR[4];
-
 #define IR0 IR[0]
 #define IR1 IR[1]
 #define IR2 IR[2]
 #define IR3 IR[3]
 
-static gtexy XY_FIFO[4];
-static uint16_t Z_FIFO[4];
-static gtergb RGB_FIFO[3];
-static int32_t MAC[4];
-static uint32_t LZCS;
-static uint32_t LZCR;
-
-static uint32_t Reg23;
-// end DR
-
 static uint8_t Sat5(int16_t cc)
 {
     if (cc < 0)
@@ -103,12 +18,34 @@ static uint8_t Sat5(int16_t cc)
 }
 
 //
-// Newton-Raphson division table.  (Initialized at startup; do NOT save in save states!)
+// Unsigned Newton-Raphson (UNR) reciprocal table, built by the compiler.
+// It never changes, so every instance shares it.
 //
-static uint8_t DivTable[0x100 + 1];
+struct DivTable_t
+{
+    uint8_t Table[0x100 + 1];
+
+    constexpr DivTable_t() : Table{}
+    {
+        for (uint32_t divisor = 0x8000; divisor < 0x10000; divisor += 0x80)
+        {
+            uint32_t xa = 512;
+            for (unsigned i = 1; i < 5; i++)
+            {
+                xa = (xa * (1024 * 512 - ((divisor >> 7)* xa))) >> 18;
+            }
+            Table[(divisor >> 7) & 0xFF] = (uint8_t)(((xa + 1) >> 1) - 0x101);
+        }
+        // To avoid a bounds limiting if statement in the emulation code:
+        Table[0x100] = Table[0xFF];
+    }
+};
+static constexpr DivTable_t DivTable;
+static_assert(DivTable.Table[0x00] == 0xFF && DivTable.Table[0x01] == 0xFD && DivTable.Table[0x100] == 0x00, "UNR table doesn't match the hardware");
+
 static uint32_t CalcRecip(uint16_t divisor)
 {
-    int32_t x = (0x101 + DivTable[(((divisor & 0x7FFF) + 0x40) >> 7)]);
+    int32_t x = (0x101 + DivTable.Table[(((divisor & 0x7FFF) + 0x40) >> 7)]);
     int32_t tmp = (((int32_t)divisor * -x) + 0x80) >> 8;
     int32_t tmp2 = ((x * (131072 + tmp)) + 0x80) >> 8;
 
@@ -140,11 +77,6 @@ static unsigned MDFN_lzcount32_0UD(uint32_t v)
 }
 static unsigned MDFN_lzcount32(uint32_t v) { return !v ? 32 : MDFN_lzcount32_0UD(v); }
 
-static uint32_t uint32min(uint32_t a, uint32_t b)
-{
-    return (b < a) ? a : b;
-}
-
 void gte::reset()
 {
     memset(CR, 0, sizeof(CR));
@@ -175,19 +107,7 @@ void gte::reset()
     LZCR = 0;
 
     Reg23 = 0;
-
-    // GTE_Init
-    for (uint32_t divisor = 0x8000; divisor < 0x10000; divisor += 0x80)
-    {
-        uint32_t xa = 512;
-        for (unsigned i = 1; i < 5; i++)
-        {
-            xa = (xa * (1024 * 512 - ((divisor >> 7)* xa))) >> 18;
-        }
-        DivTable[(divisor >> 7) & 0xFF] = ((xa + 1) >> 1) - 0x101;
-    }
-    // To avoid a bounds limiting if statement in the emulation code:
-    DivTable[0x100] = DivTable[0xFF];
+    FLAGS = 0;
 }
 
 void gte::writeCR(uint32_t which, uint32_t value)
@@ -559,7 +479,7 @@ uint32_t gte::readDR(uint32_t which)
 }
 
 #define sign_x_to_s64(_bits, _value) (((int64_t)((uint64_t)(_value) << (64 - _bits))) >> (64 - _bits))
-static int64_t A_MV(unsigned which, int64_t value)
+int64_t gte::A_MV(unsigned which, int64_t value)
 {
     if (value >= (1LL << 43))
         FLAGS |= 1 << (30 - which);
@@ -570,7 +490,7 @@ static int64_t A_MV(unsigned which, int64_t value)
     return sign_x_to_s64(44, value);
 }
 
-static int64_t F(int64_t value)
+int64_t gte::F(int64_t value)
 {
     if (value < -2147483648LL)
     {
@@ -587,7 +507,7 @@ static int64_t F(int64_t value)
 }
 
 
-static int16_t Lm_B(unsigned int which, int32_t value, int lm)
+int16_t gte::Lm_B(unsigned int which, int32_t value, int lm)
 {
     int32_t tmp = lm << 15;
 
@@ -609,7 +529,7 @@ static int16_t Lm_B(unsigned int which, int32_t value, int lm)
 }
 
 
-static int16_t Lm_B_PTZ(unsigned int which, int32_t value, int32_t ftv_value, int lm)
+int16_t gte::Lm_B_PTZ(unsigned int which, int32_t value, int32_t ftv_value, int lm)
 {
     int32_t tmp = lm << 15;
 
@@ -636,7 +556,7 @@ static int16_t Lm_B_PTZ(unsigned int which, int32_t value, int32_t ftv_value, in
     return(value);
 }
 
-static uint8_t Lm_C(unsigned int which, int32_t value)
+uint8_t gte::Lm_C(unsigned int which, int32_t value)
 {
     if (value & ~0xFF)
     {
@@ -653,7 +573,7 @@ static uint8_t Lm_C(unsigned int which, int32_t value)
     return(value);
 }
 
-static int32_t Lm_D(int32_t value, int unchained)
+int32_t gte::Lm_D(int32_t value, int unchained)
 {
     // Not sure if we should have it as int64, or just chain on to and special case when the F flags are set.
     if (!unchained)
@@ -687,7 +607,7 @@ static int32_t Lm_D(int32_t value, int unchained)
     return(value);
 }
 
-static int32_t Lm_G(unsigned int which, int32_t value)
+int32_t gte::Lm_G(unsigned int which, int32_t value)
 {
     if (value < -1024)
     {
@@ -707,7 +627,7 @@ static int32_t Lm_G(unsigned int which, int32_t value)
 }
 
 // limit to 4096, not 4095
-static int32_t Lm_H(int32_t value)
+int32_t gte::Lm_H(int32_t value)
 {
     if (value < 0)
     {
@@ -724,7 +644,7 @@ static int32_t Lm_H(int32_t value)
     return(value);
 }
 
-static void MAC_to_RGB_FIFO(void)
+void gte::MAC_to_RGB_FIFO(void)
 {
     RGB_FIFO[0] = RGB_FIFO[1];
     RGB_FIFO[1] = RGB_FIFO[2];
@@ -735,85 +655,89 @@ static void MAC_to_RGB_FIFO(void)
 }
 
 
-static void MAC_to_IR(int lm)
+void gte::MAC_to_IR(int lm)
 {
     IR1 = Lm_B(0, MAC[1], lm);
     IR2 = Lm_B(1, MAC[2], lm);
     IR3 = Lm_B(2, MAC[3], lm);
 }
 
-static void MultiplyMatrixByVector(const gtematrix* matrix, const int16_t* v, const int32_t* crv, uint32_t sf, int lm)
+// crv << 12 + coeff * v for all three rows, with the 44 bit overflow check after every term.
+// fc_bug is the hardware quirk where the far colour vector only affects the flags.
+void gte::MatrixRows(const int32_t coeff[3][3], const int16_t* v, const int32_t* crv, bool fc_bug, uint32_t sf, int64_t out[3])
 {
-    unsigned i;
-
-    for (i = 0; i < 3; i++)
+    for (unsigned i = 0; i < 3; i++)
     {
-        int64_t tmp;
-        int32_t mulr[3];
-
-        tmp = (uint64_t)(int64_t)crv[i] << 12;
-
-        if (matrix == &Matrices.AbbyNormal)
-        {
-            if (i == 0)
-            {
-                mulr[0] = -((RGB.R << 4) * v[0]);
-                mulr[1] = (RGB.R << 4) * v[1];
-                mulr[2] = IR0 * v[2];
-            }
-            else
-            {
-                mulr[0] = (int16_t)CR[i] * v[0];
-                mulr[1] = (int16_t)CR[i] * v[1];
-                mulr[2] = (int16_t)CR[i] * v[2];
-            }
-        }
-        else
-        {
-            mulr[0] = matrix->MX[i][0] * v[0];
-            mulr[1] = matrix->MX[i][1] * v[1];
-            mulr[2] = matrix->MX[i][2] * v[2];
-        }
+        int64_t tmp = (uint64_t)(int64_t)crv[i] << 12;
 
-        tmp = A_MV(i, tmp + mulr[0]);
-        if (crv == CRVectors.FC)
+        tmp = A_MV(i, tmp + (int32_t)(coeff[i][0] * v[0]));
+        if (fc_bug)
         {
             Lm_B(i, tmp >> sf, false);
             tmp = 0;
         }
 
-        tmp = A_MV(i, tmp + mulr[1]);
-        tmp = A_MV(i, tmp + mulr[2]);
+        tmp = A_MV(i, tmp + (int32_t)(coeff[i][1] * v[1]));
+        tmp = A_MV(i, tmp + (int32_t)(coeff[i][2] * v[2]));
+
+        out[i] = tmp;
+    }
+}
+
+void gte::MultiplyMatrixByVector(const gtematrix* matrix, const int16_t* v, const int32_t* crv, uint32_t sf, int lm)
+{
+    int32_t coeff[3][3];
+    int64_t tmp[3];
+    unsigned i;
 
-        MAC[1 + i] = tmp >> sf;
+    if (matrix == &Matrices.AbbyNormal)
+    {
+        coeff[0][0] = -(RGB.R << 4);
+        coeff[0][1] = RGB.R << 4;
+        coeff[0][2] = IR0;
+        for (i = 1; i < 3; i++)
+        {
+            coeff[i][0] = (int16_t)CR[i];
+            coeff[i][1] = (int16_t)CR[i];
+            coeff[i][2] = (int16_t)CR[i];
+        }
+    }
+    else
+    {
+        for (i = 0; i < 3; i++)
+        {
+            coeff[i][0] = matrix->MX[i][0];
+            coeff[i][1] = matrix->MX[i][1];
+            coeff[i][2] = matrix->MX[i][2];
+        }
     }
 
+    MatrixRows(coeff, v, crv, crv == CRVectors.FC, sf, tmp);
+
+    for (i = 0; i < 3; i++)
+        MAC[1 + i] = tmp[i] >> sf;
 
     MAC_to_IR(lm);
 }
 
 
-static void MultiplyMatrixByVector_PT(const gtematrix* matrix, const int16_t* v, const int32_t* crv, uint32_t sf, int lm)
+void gte::MultiplyMatrixByVector_PT(const gtematrix* matrix, const int16_t* v, const int32_t* crv, uint32_t sf, int lm)
 {
+    int32_t coeff[3][3];
     int64_t tmp[3];
     unsigned i;
 
     for (i = 0; i < 3; i++)
     {
-        int32_t mulr[3];
-
-        tmp[i] = (uint64_t)(int64_t)crv[i] << 12;
-
-        mulr[0] = matrix->MX[i][0] * v[0];
-        mulr[1] = matrix->MX[i][1] * v[1];
-        mulr[2] = matrix->MX[i][2] * v[2];
+        coeff[i][0] = matrix->MX[i][0];
+        coeff[i][1] = matrix->MX[i][1];
+        coeff[i][2] = matrix->MX[i][2];
+    }
 
-        tmp[i] = A_MV(i, tmp[i] + mulr[0]);
-        tmp[i] = A_MV(i, tmp[i] + mulr[1]);
-        tmp[i] = A_MV(i, tmp[i] + mulr[2]);
+    MatrixRows(coeff, v, crv, false, sf, tmp);
 
+    for (i = 0; i < 3; i++)
         MAC[1 + i] = tmp[i] >> sf;
-    }
 
     IR1 = Lm_B(0, MAC[1], lm);
     IR2 = Lm_B(1, MAC[2], lm);
@@ -848,7 +772,7 @@ static void MultiplyMatrixByVector_PT(const gtematrix* matrix, const int16_t* v,
     }
 
 
-static int32_t SQR(uint32_t instr)
+int32_t gte::SQR(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -861,7 +785,7 @@ static int32_t SQR(uint32_t instr)
     return(5);
 }
 
-static int32_t MVMVA(uint32_t instr)
+int32_t gte::MVMVA(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -870,30 +794,18 @@ static int32_t MVMVA(uint32_t instr)
     return(8);
 }
 
-static unsigned CountLeadingZeroU16(uint16_t val)
-{
-    unsigned ret = 0;
-
-    while (!(val & 0x8000) && ret < 16)
-    {
-        val <<= 1;
-        ret++;
-    }
-
-    return ret;
-}
-
-static uint32_t Divide(uint32_t dividend, uint32_t divisor)
+uint32_t gte::Divide(uint32_t dividend, uint32_t divisor)
 {
     //if((Z_FIFO[3] * 2) > H)
     if ((divisor * 2) > dividend)
     {
-        unsigned shift_bias = CountLeadingZeroU16(divisor);
+        // divisor can't be 0 here, and is at most 16 bits, so this normalises it to have bit 15 set
+        unsigned shift_bias = MDFN_lzcount32_0UD(divisor) - 16;
 
         dividend <<= shift_bias;
         divisor <<= shift_bias;
 
-        return uint32min(0x1FFFF, ((uint64_t)dividend * CalcRecip(divisor | 0x8000) + 32768) >> 16);
+        return std::min<uint32_t>(0x1FFFF, ((uint64_t)dividend * CalcRecip(divisor) + 32768) >> 16);
     }
     else
     {
@@ -902,7 +814,7 @@ static uint32_t Divide(uint32_t dividend, uint32_t divisor)
     }
 }
 
-static void TransformXY(int64_t h_div_sz)
+void gte::TransformXY(int64_t h_div_sz)
 {
     MAC[0] = F((int64_t)OFX + IR1 * h_div_sz) >> 16;
     XY_FIFO[3].X = Lm_G(0, MAC[0]);
@@ -915,13 +827,13 @@ static void TransformXY(int64_t h_div_sz)
     XY_FIFO[2] = XY_FIFO[3];
 }
 
-static void TransformDQ(int64_t h_div_sz)
+void gte::TransformDQ(int64_t h_div_sz)
 {
     MAC[0] = F((int64_t)DQB + DQA * h_div_sz);
     IR0 = Lm_H(((int64_t)DQB + DQA * h_div_sz) >> 12);
 }
 
-static int32_t RTPS(uint32_t instr)
+int32_t gte::RTPS(uint32_t instr)
 {
     DECODE_FIELDS;
     int64_t h_div_sz;
@@ -935,7 +847,7 @@ static int32_t RTPS(uint32_t instr)
     return(15);
 }
 
-static int32_t RTPT(uint32_t instr)
+int32_t gte::RTPT(uint32_t instr)
 {
     DECODE_FIELDS;
     int i;
@@ -956,7 +868,7 @@ static int32_t RTPT(uint32_t instr)
     return(23);
 }
 
-static void NormColor(uint32_t sf, int lm, uint32_t v)
+void gte::NormColor(uint32_t sf, int lm, uint32_t v)
 {
     int16_t tmp_vector[3];
 
@@ -968,7 +880,7 @@ static void NormColor(uint32_t sf, int lm, uint32_t v)
     MAC_to_RGB_FIFO();
 }
 
-static int32_t NCS(uint32_t instr)
+int32_t gte::NCS(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -977,7 +889,7 @@ static int32_t NCS(uint32_t instr)
     return(14);
 }
 
-static int32_t NCT(uint32_t instr)
+int32_t gte::NCT(uint32_t instr)
 {
     DECODE_FIELDS;
     int i;
@@ -988,7 +900,7 @@ static int32_t NCT(uint32_t instr)
     return(30);
 }
 
-static void NormColorColor(uint32_t v, uint32_t sf, int lm)
+void gte::NormColorColor(uint32_t v, uint32_t sf, int lm)
 {
     int16_t tmp_vector[3];
 
@@ -1006,7 +918,7 @@ static void NormColorColor(uint32_t v, uint32_t sf, int lm)
     MAC_to_RGB_FIFO();
 }
 
-static int32_t NCCS(uint32_t instr)
+int32_t gte::NCCS(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -1015,7 +927,7 @@ static int32_t NCCS(uint32_t instr)
 }
 
 
-static int32_t NCCT(uint32_t instr)
+int32_t gte::NCCT(uint32_t instr)
 {
     int i;
     DECODE_FIELDS;
@@ -1026,7 +938,7 @@ static int32_t NCCT(uint32_t instr)
     return(39);
 }
 
-static void DepthCue(int mult_IR123, int RGB_from_FIFO, uint32_t sf, int lm)
+void gte::DepthCue(int mult_IR123, int RGB_from_FIFO, uint32_t sf, int lm)
 {
     int32_t RGB_temp[3];
     int32_t IR_temp[3] = { IR1, IR2, IR3 };
@@ -1047,21 +959,20 @@ static void DepthCue(int mult_IR123, int RGB_from_FIFO, uint32_t sf, int lm)
         RGB_temp[2] = RGB.B << 4;
     }
 
-    if (mult_IR123)
+    // far = FC - x, MAC = x + IR0 * far, where x is either RGB * IR or just RGB
+    int64_t near_terms[3];
+    for (i = 0; i < 3; i++)
     {
-        for (i = 0; i < 3; i++)
-        {
-            MAC[1 + i] = A_MV(i, ((int64_t)((uint64_t)(int64_t)CRVectors.FC[i] << 12) - RGB_temp[i] * IR_temp[i])) >> sf;
-            MAC[1 + i] = A_MV(i, (RGB_temp[i] * IR_temp[i] + IR0 * Lm_B(i, MAC[1 + i], false))) >> sf;
-        }
+        if (mult_IR123)
+            near_terms[i] = RGB_temp[i] * IR_temp[i];
+        else
+            near_terms[i] = (int64_t)((uint64_t)(int64_t)RGB_temp[i] << 12);
     }
-    else
+
+    for (i = 0; i < 3; i++)
     {
-        for (i = 0; i < 3; i++)
-        {
-            MAC[1 + i] = A_MV(i, ((int64_t)((uint64_t)(int64_t)CRVectors.FC[i] << 12) - (int32_t)((uint32_t)RGB_temp[i] << 12))) >> sf;
-            MAC[1 + i] = A_MV(i, ((int64_t)((uint64_t)(int64_t)RGB_temp[i] << 12) + IR0 * Lm_B(i, MAC[1 + i], false))) >> sf;
-        }
+        MAC[1 + i] = A_MV(i, ((int64_t)((uint64_t)(int64_t)CRVectors.FC[i] << 12) - near_terms[i])) >> sf;
+        MAC[1 + i] = A_MV(i, (near_terms[i] + IR0 * Lm_B(i, MAC[1 + i], false))) >> sf;
     }
 
     MAC_to_IR(lm);
@@ -1070,7 +981,7 @@ static void DepthCue(int mult_IR123, int RGB_from_FIFO, uint32_t sf, int lm)
 }
 
 
-static int32_t DCPL(uint32_t instr)
+int32_t gte::DCPL(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -1080,7 +991,7 @@ static int32_t DCPL(uint32_t instr)
 }
 
 
-static int32_t DPCS(uint32_t instr)
+int32_t gte::DPCS(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -1089,7 +1000,7 @@ static int32_t DPCS(uint32_t instr)
     return(8);
 }
 
-static int32_t DPCT(uint32_t instr)
+int32_t gte::DPCT(uint32_t instr)
 {
     int i;
     DECODE_FIELDS;
@@ -1102,7 +1013,7 @@ static int32_t DPCT(uint32_t instr)
     return(17);
 }
 
-static int32_t INTPL(uint32_t instr)
+int32_t gte::INTPL(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -1122,7 +1033,7 @@ static int32_t INTPL(uint32_t instr)
 }
 
 
-static void NormColorDepthCue(uint32_t v, uint32_t sf, int lm)
+void gte::NormColorDepthCue(uint32_t v, uint32_t sf, int lm)
 {
     int16_t tmp_vector[3];
 
@@ -1134,7 +1045,7 @@ static void NormColorDepthCue(uint32_t v, uint32_t sf, int lm)
     DepthCue(true, false, sf, lm);
 }
 
-static int32_t NCDS(uint32_t instr)
+int32_t gte::NCDS(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -1143,7 +1054,7 @@ static int32_t NCDS(uint32_t instr)
     return(19);
 }
 
-static int32_t NCDT(uint32_t instr)
+int32_t gte::NCDT(uint32_t instr)
 {
     int i;
     DECODE_FIELDS;
@@ -1156,7 +1067,7 @@ static int32_t NCDT(uint32_t instr)
     return(44);
 }
 
-static int32_t CC(uint32_t instr)
+int32_t gte::CC(uint32_t instr)
 {
     DECODE_FIELDS;
     int16_t tmp_vector[3];
@@ -1175,7 +1086,7 @@ static int32_t CC(uint32_t instr)
     return(11);
 }
 
-static int32_t CDP(uint32_t instr)
+int32_t gte::CDP(uint32_t instr)
 {
     DECODE_FIELDS;
     int16_t tmp_vector[3];
@@ -1188,7 +1099,7 @@ static int32_t CDP(uint32_t instr)
     return(13);
 }
 
-static int32_t NCLIP(uint32_t instr)
+int32_t gte::NCLIP(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -1198,7 +1109,7 @@ static int32_t NCLIP(uint32_t instr)
     return(8);
 }
 
-static int32_t AVSZ3(uint32_t instr)
+int32_t gte::AVSZ3(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -1209,7 +1120,7 @@ static int32_t AVSZ3(uint32_t instr)
     return(5);
 }
 
-static int32_t AVSZ4(uint32_t instr)
+int32_t gte::AVSZ4(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -1223,7 +1134,7 @@ static int32_t AVSZ4(uint32_t instr)
 
 // -32768 * -32768 - 32767 * -32768 = 2147450880
 // (2 ^ 31) - 1 =		      2147483647
-static int32_t OP(uint32_t instr)
+int32_t gte::OP(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -1236,7 +1147,7 @@ static int32_t OP(uint32_t instr)
     return(6);
 }
 
-static int32_t GPF(uint32_t instr)
+int32_t gte::GPF(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -1251,7 +1162,7 @@ static int32_t GPF(uint32_t instr)
     return(5);
 }
 
-static int32_t GPL(uint32_t instr)
+int32_t gte::GPL(uint32_t instr)
 {
     DECODE_FIELDS;
 
@@ -1,6 +1,65 @@
 #pragma once
 #include "helpers.hpp"
 
+typedef struct
+{
+	int16_t MX[3][3];
+	int16_t dummy;
+} gtematrix;
+
+typedef struct
+{
+	union
+	{
+		struct
+		{
+			uint8_t R;
+			uint8_t G;
+			uint8_t B;
+			uint8_t CD;
+		};
+		uint8_t Raw8[4];
+	};
+} gtergb;
+
+typedef struct
+{
+	int16_t X;
+	int16_t Y;
+} gtexy;
+
+typedef union
+{
+	gtematrix All[4];
+	int32_t Raw[4][5];
+	int16_t Raw16[4][10];
+
+	struct
+	{
+		gtematrix Rot;
+		gtematrix Light;
+		gtematrix Color;
+		gtematrix AbbyNormal;
+	};
+} Matrices_t;
+
+typedef union
+{
+	int32_t All[4][4];	// Really only [4][3], but [4] to ease address calculation.
+
+	struct
+	{
+		int32_t T[4];
+		int32_t B[4];
+		int32_t FC[4];
+		int32_t Null[4];
+	};
+} CRVectors_t;
+
+// All state lives in the instance, so any number of GTEs can run at once on different threads.
+// Members are ordered by how often commands touch them: the data registers every command
+// reads and writes come first, then the matrices and constants, then registers that are only
+// used by MTC2/MFC2/CTC2/CFC2.
 class gte
 {
 	public:
@@ -10,4 +69,75 @@ class gte
 		uint32_t readCR(uint32_t which);
 		uint32_t readDR(uint32_t which);
 		int32_t instruction(uint32_t instr);
-};
\ No newline at end of file
+	private:
+		// Hot - touched by almost every command
+		uint32_t FLAGS;
+		int32_t MAC[4];
+		int16_t IR[4];
+		int16_t Vectors[3][4];
+		uint16_t Z_FIFO[4];
+		gtexy XY_FIFO[4];
+		gtergb RGB_FIFO[3];
+		gtergb RGB;
+		uint16_t OTZ;
+
+		// Matrices and constants
+		Matrices_t Matrices;
+		CRVectors_t CRVectors;
+		int32_t OFX;
+		int32_t OFY;
+		int32_t DQB;
+		uint16_t H;
+		int16_t DQA;
+		int16_t ZSF3;
+		int16_t ZSF4;
+
+		// Cold
+		uint32_t CR[32];
+		uint32_t LZCS;
+		uint32_t LZCR;
+		uint32_t Reg23;
+
+		int64_t A_MV(unsigned which, int64_t value);
+		int64_t F(int64_t value);
+		int16_t Lm_B(unsigned int which, int32_t value, int lm);
+		int16_t Lm_B_PTZ(unsigned int which, int32_t value, int32_t ftv_value, int lm);
+		uint8_t Lm_C(unsigned int which, int32_t value);
+		int32_t Lm_D(int32_t value, int unchained);
+		int32_t Lm_G(unsigned int which, int32_t value);
+		int32_t Lm_H(int32_t value);
+		void MAC_to_RGB_FIFO(void);
+		void MAC_to_IR(int lm);
+		void MatrixRows(const int32_t coeff[3][3], const int16_t* v, const int32_t* crv, bool fc_bug, uint32_t sf, int64_t out[3]);
+		void MultiplyMatrixByVector(const gtematrix* matrix, const int16_t* v, const int32_t* crv, uint32_t sf, int lm);
+		void MultiplyMatrixByVector_PT(const gtematrix* matrix, const int16_t* v, const int32_t* crv, uint32_t sf, int lm);
+		int32_t SQR(uint32_t instr);
+		int32_t MVMVA(uint32_t instr);
+		uint32_t Divide(uint32_t dividend, uint32_t divisor);
+		void TransformXY(int64_t h_div_sz);
+		void TransformDQ(int64_t h_div_sz);
+		int32_t RTPS(uint32_t instr);
+		int32_t RTPT(uint32_t instr);
+		void NormColor(uint32_t sf, int lm, uint32_t v);
+		int32_t NCS(uint32_t instr);
+		int32_t NCT(uint32_t instr);
+		void NormColorColor(uint32_t v, uint32_t sf, int lm);
+		int32_t NCCS(uint32_t instr);
+		int32_t NCCT(uint32_t instr);
+		void DepthCue(int mult_IR123, int RGB_from_FIFO, uint32_t sf, int lm);
+		int32_t DCPL(uint32_t instr);
+		int32_t DPCS(uint32_t instr);
+		int32_t DPCT(uint32_t instr);
+		int32_t INTPL(uint32_t instr);
+		void NormColorDepthCue(uint32_t v, uint32_t sf, int lm);
+		int32_t NCDS(uint32_t instr);
+		int32_t NCDT(uint32_t instr);
+		int32_t CC(uint32_t instr);
+		int32_t CDP(uint32_t instr);
+		int32_t NCLIP(uint32_t instr);
+		int32_t AVSZ3(uint32_t instr);
+		int32_t AVSZ4(uint32_t instr);
+		int32_t OP(uint32_t instr);
+		int32_t GPF(uint32_t instr);
+		int32_t GPL(uint32_t instr);
+};
@@ -0,0 +1,159 @@
+#include "gteBench.hpp"
+#include <chrono>
+
+#define GTE_BENCH_CASES 20000
+#define GTE_BENCH_EDGE_CASES 512
+
+struct gteBenchCommand
+{
+	uint8_t opcode;
+	const char* name;
+	uint64_t golden;
+};
+
+// Golden hashes were recorded from the original GTE, before any of the optimisations.
+// If a change to the GTE is meant to alter results, re-record them from the report output and say why in the commit.
+static const gteBenchCommand commands[] = {
+	{ 0x01, "RTPS", 0x0276CE3C7E3827BD },
+	{ 0x06, "NCLIP", 0xC92396CEB05A3D7E },
+	{ 0x0C, "OP", 0x90A1944AC8C3C22F },
+	{ 0x10, "DPCS", 0x8B2565FC0262BD70 },
+	{ 0x11, "INTPL", 0xD505EF9889F80CA8 },
+	{ 0x12, "MVMVA", 0x53294393299532F4 },
+	{ 0x13, "NCDS", 0x15040C5A665562E0 },
+	{ 0x14, "CDP", 0xE78FF40104C3E3B2 },
+	{ 0x16, "NCDT", 0x23916CFC65F1F0B7 },
+	{ 0x1B, "NCCS", 0x584A8CA0ABC2DE8C },
+	{ 0x1C, "CC", 0xF055EC6D9971D49D },
+	{ 0x1E, "NCS", 0xFBC73BA206837C54 },
+	{ 0x20, "NCT", 0xFA6499B570B8C7A1 },
+	{ 0x28, "SQR", 0xFF133A570BF09E77 },
+	{ 0x29, "DCPL", 0x38CA072B0B163C4E },
+	{ 0x2A, "DPCT", 0x50369E85ED1ACDE4 },
+	{ 0x2D, "AVSZ3", 0xDAFB6BC5D41EC842 },
+	{ 0x2E, "AVSZ4", 0x6BE1789E547DD1D2 },
+	{ 0x30, "RTPT", 0xEEAABD9B04A0FAB3 },
+	{ 0x3D, "GPF", 0x3F6B56C62F00B41E },
+	{ 0x3E, "GPL", 0xFF00277A182D1A0C },
+	{ 0x3F, "NCCT", 0xA3C04B820EF14FA5 }
+};
+
+// Values at the edges of the 16 and 32 bit ranges, where saturation and flags happen
+static const uint32_t edgeValues[] = {
+	0x00000000, 0x00000001, 0xFFFFFFFF, 0x00007FFF, 0x00008000, 0x0000FFFF,
+	0x7FFF7FFF, 0x80008000, 0x7FFFFFFF, 0x80000000, 0x00010000, 0x7FFF8000
+};
+
+// mt19937's raw output is fully defined by the standard, so the test cases are the same everywhere
+void gteBench::loadRegisters(gte* g, std::mt19937& rng, uint32_t testCase)
+{
+	g->reset();
+	for (uint32_t i = 0; i < 32; i++)
+	{
+		uint32_t value = rng();
+		if (testCase < GTE_BENCH_EDGE_CASES || (value & 3) == 0)
+		{
+			value = edgeValues[rng() % (sizeof(edgeValues) / sizeof(edgeValues[0]))];
+		}
+		g->writeCR(i, value);
+	}
+	for (uint32_t i = 0; i < 32; i++)
+	{
+		uint32_t value = rng();
+		if (testCase < GTE_BENCH_EDGE_CASES || (value & 3) == 0)
+		{
+			value = edgeValues[rng() % (sizeof(edgeValues) / sizeof(edgeValues[0]))];
+		}
+		g->writeDR(i, value);
+	}
+}
+
+// 64 bit FNV-1a over every register
+uint64_t gteBench::hashRegisters(gte* g, uint64_t hash)
+{
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		uint32_t value = (i < 32) ? g->readDR(i) : g->readCR(i - 32);
+		for (int b = 0; b < 4; b++)
+		{
+			hash ^= (value >> (b * 8)) & 0xFF;
+			hash *= 0x100000001B3;
+		}
+	}
+	return hash;
+}
+
+std::vector<gteBenchResult> gteBench::run(uint32_t timingIterations)
+{
+	std::vector<gteBenchResult> results;
+	gte* g = new gte();
+
+	for (const gteBenchCommand& command : commands)
+	{
+		gteBenchResult result;
+		result.opcode = command.opcode;
+		result.name = command.name;
+
+		// Conformance - the seed depends on the opcode so every command gets its own cases
+		std::mt19937 rng(command.opcode);
+		uint64_t hash = 0xCBF29CE484222325;
+		for (uint32_t testCase = 0; testCase < GTE_BENCH_CASES; testCase++)
+		{
+			loadRegisters(g, rng, testCase);
+			// Random sf, lm, mx, v and cv fields
+			uint32_t instr = (rng() & 0x01FFFFC0) | command.opcode;
+			int32_t cycles = g->instruction(instr);
+			hash = hashRegisters(g, hash ^ (uint32_t)cycles);
+		}
+		result.hash = hash;
+		result.matchesGolden = hash == command.golden;
+
+		// Speed - run the command back to back on one set of registers, like a game transforming a model
+		loadRegisters(g, rng, GTE_BENCH_EDGE_CASES);
+		uint32_t instr = (1 << 19) | command.opcode; // sf = 1, like almost all real code
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < timingIterations; i++)
+		{
+			g->instruction(instr);
+		}
+		auto end = std::chrono::steady_clock::now();
+		result.nsPerCommand = std::chrono::duration<double, std::nano>(end - start).count() / std::max(timingIterations, 1u);
+
+		results.push_back(result);
+	}
+
+	delete(g);
+	return results;
+}
+
+bool gteBench::report(const std::vector<gteBenchResult>& results)
+{
+	bool allMatch = true;
+	for (const gteBenchResult& result : results)
+	{
+		std::ostringstream line;
+		line << std::left;
+		line.width(6);
+		line << result.name << " (" << helpers::intToHex(result.opcode) << ") ";
+		line << std::hex << std::uppercase;
+		line.width(16);
+		line.fill('0');
+		line << std::right << result.hash;
+		line << std::dec << (result.matchesGolden ? "  ok   " : "  FAIL ");
+		line << result.nsPerCommand << " ns/command";
+		if (result.matchesGolden)
+		{
+			logging::important(line.str(), logging::logSource::GTE);
+		}
+		else
+		{
+			logging::error(line.str(), logging::logSource::GTE);
+			allMatch = false;
+		}
+	}
+	if (allMatch)
+	{
+		logging::important("All GTE commands match the golden results", logging::logSource::GTE);
+	}
+	return allMatch;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "helpers.hpp"
+#include "gte.hpp"
+#include <random>
+
+struct gteBenchResult
+{
+	uint8_t opcode;
+	std::string name;
+	uint64_t hash;			// of every register after each test case
+	bool matchesGolden;
+	double nsPerCommand;
+};
+
+// Runs every implemented GTE command over a fixed set of edge case and random register values,
+// checks the results against hashes recorded from a known good build, and times each command.
+// Any change to the GTE should leave every hash matching.
+class gteBench
+{
+	public:
+		static std::vector<gteBenchResult> run(uint32_t timingIterations);
+		// Returns true if everything matched
+		static bool report(const std::vector<gteBenchResult>& results);
+	private:
+		//private constructor means no instances of this object can be created
+		gteBench() {}
+		static void loadRegisters(gte* g, std::mt19937& rng, uint32_t testCase);
+		static uint64_t hashRegisters(gte* g, uint64_t hash);
+};
@@ -4,6 +4,7 @@
 #include <sstream>
 #include <list>
 #include <map>
+#include <vector>
 #include <SDL.h>
 #include <GL\glew.h>
 #include <SDL_opengl.h>
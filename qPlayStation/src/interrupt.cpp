@@ -3,6 +3,7 @@
 
 interruptController::interruptController()
 {
+	CPU = nullptr;
 	InterruptStatus = 0;
 	InterruptMask = 0;
 }
@@ -20,6 +21,7 @@ void interruptController::requestInterrupt(interruptType type)
 
 void interruptController::checkForInterrupts()
 {
+	if (CPU == nullptr) { return; } // no CPU when replaying GPU captures
 	CPU->updateInterruptRequest((InterruptStatus & InterruptMask) != 0);
 }
 
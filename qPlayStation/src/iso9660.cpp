@@ -0,0 +1,170 @@
+#include "iso9660.hpp"
+#include "exe.hpp"
+#include <cerrno>
+#include <cstdlib>
+
+static uint32_t read32(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static std::string trim(std::string text)
+{
+	size_t first = text.find_first_not_of(" \t\r");
+	size_t last = text.find_last_not_of(" \t\r");
+	return (first == std::string::npos) ? "" : text.substr(first, last - first + 1);
+}
+
+iso9660::iso9660(discImage* d)
+{
+	Disc = d;
+	const discTrack& firstTrack = d->getTracks().front();
+	if (firstTrack.type == trackType::Audio)
+	{
+		logging::fatal("Disc has no data track", logging::logSource::CDROM);
+	}
+	trackStart = firstTrack.indexOneLBA;
+
+	const uint8_t* descriptor = Disc->getUserData(trackStart + ISO_VOLUME_DESCRIPTOR_SECTOR);
+	if (descriptor[0] != 1 || memcmp(descriptor + 1, "CD001", 5) != 0)
+	{
+		logging::fatal("Disc doesn't have an ISO9660 filesystem", logging::logSource::CDROM);
+	}
+	// The root directory record is at 156 in the primary volume descriptor
+	isoFile root = { trackStart + read32(descriptor + 156 + 2), read32(descriptor + 156 + 10), true };
+	files["/"] = root;
+	readDirectory("", root, 0);
+	logging::info("Indexed " + std::to_string(files.size() - 1) + " files on the disc", logging::logSource::CDROM);
+}
+
+void iso9660::readDirectory(std::string path, const isoFile& directory, uint32_t depth)
+{
+	if (depth >= ISO_MAX_DIRECTORY_DEPTH)
+	{
+		logging::warning("Skipping directory nested too deep: " + path, logging::logSource::CDROM);
+		return;
+	}
+	std::vector<std::pair<std::string, isoFile>> subdirectories;
+	uint32_t sectors = (directory.size + SECTOR_USER_DATA_SIZE - 1) / SECTOR_USER_DATA_SIZE;
+	for (uint32_t sector = 0; sector < sectors; sector++)
+	{
+		const uint8_t* data = Disc->getUserData(directory.lba + sector);
+		uint32_t offset = 0;
+		// Records never cross a sector, a zero length means the rest of the sector is padding
+		while (offset + 33 < SECTOR_USER_DATA_SIZE && data[offset] != 0)
+		{
+			const uint8_t* record = data + offset;
+			uint8_t recordLength = record[0];
+			uint8_t nameLength = record[32];
+			offset += recordLength;
+			if (recordLength < 33 + nameLength || offset > SECTOR_USER_DATA_SIZE)
+			{
+				logging::warning("Broken directory record in " + path + "/", logging::logSource::CDROM);
+				break;
+			}
+			// Names 0 and 1 are the . and .. entries
+			if (nameLength == 1 && record[33] <= 1)
+			{
+				continue;
+			}
+			std::string name((const char*)record + 33, nameLength);
+			isoFile file = { trackStart + read32(record + 2), read32(record + 10), (record[25] & 0x2) != 0 };
+			std::string filePath = normalisePath(path + "/" + name);
+			files[filePath] = file;
+			if (file.directory)
+			{
+				subdirectories.push_back({ filePath, file });
+			}
+		}
+	}
+	for (auto& subdirectory : subdirectories)
+	{
+		readDirectory(subdirectory.first, subdirectory.second, depth + 1);
+	}
+}
+
+std::string iso9660::normalisePath(std::string path)
+{
+	if (path.compare(0, 6, "cdrom:") == 0 || path.compare(0, 6, "CDROM:") == 0)
+	{
+		path = path.substr(6);
+	}
+	size_t version = path.find(';');
+	if (version != std::string::npos)
+	{
+		path = path.substr(0, version);
+	}
+	std::string normalised = "/";
+	for (char c : path)
+	{
+		if (c == '\\') { c = '/'; }
+		if (c == '/' && normalised.back() == '/') { continue; }
+		normalised += (char)toupper((unsigned char)c);
+	}
+	// Files without an extension are stored with a trailing dot
+	if (normalised.size() > 1 && (normalised.back() == '.' || normalised.back() == '/'))
+	{
+		normalised.pop_back();
+	}
+	return normalised;
+}
+
+const isoFile* iso9660::find(std::string path)
+{
+	auto file = files.find(normalisePath(path));
+	return (file != files.end()) ? &file->second : nullptr;
+}
+
+std::vector<uint8_t> iso9660::readFile(const isoFile* file)
+{
+	std::vector<uint8_t> data(file->size);
+	for (uint32_t offset = 0; offset < file->size; offset += SECTOR_USER_DATA_SIZE)
+	{
+		uint32_t length = std::min<uint32_t>(SECTOR_USER_DATA_SIZE, file->size - offset);
+		memcpy(data.data() + offset, Disc->getUserData(file->lba + (offset / SECTOR_USER_DATA_SIZE)), length);
+	}
+	return data;
+}
+
+std::string iso9660::getBootPath(uint32_t& stack)
+{
+	stack = EXE_DEFAULT_STACK;
+	const isoFile* config = find("SYSTEM.CNF");
+	if (config == nullptr)
+	{
+		return "PSX.EXE";
+	}
+	std::string bootPath;
+	std::istringstream lines(std::string((const char*)readFile(config).data(), config->size));
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		// Lines look like "BOOT = cdrom:\SLUS_000.05;1" with spacing varying between games
+		size_t equals = line.find('=');
+		if (equals == std::string::npos) { continue; }
+		std::string key = trim(line.substr(0, equals));
+		std::string value = trim(line.substr(equals + 1));
+		value = value.substr(0, value.find_first_of(" \t")); // anything after the path is arguments
+		if (key == "BOOT")
+		{
+			bootPath = value;
+		}
+		else if (key == "STACK")
+		{
+			// e.g. "STACK = 801FFF00", hex with or without 0x
+			char* end = nullptr;
+			errno = 0;
+			unsigned long parsed = strtoul(value.c_str(), &end, 16);
+			if (value.empty() || value[0] == '-' || *end != '\0' || errno == ERANGE || parsed > 0xFFFFFFFF)
+			{
+				logging::fatal("SYSTEM.CNF has an invalid STACK value: " + value, logging::logSource::CDROM);
+			}
+			stack = (uint32_t)parsed;
+		}
+	}
+	if (bootPath.empty())
+	{
+		logging::fatal("SYSTEM.CNF has no BOOT line", logging::logSource::CDROM);
+	}
+	return bootPath;
+}
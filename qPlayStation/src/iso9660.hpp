@@ -0,0 +1,34 @@
+#pragma once
+#include "helpers.hpp"
+#include "disc.hpp"
+#include <unordered_map>
+
+#define ISO_VOLUME_DESCRIPTOR_SECTOR 16
+#define ISO_MAX_DIRECTORY_DEPTH 8 // ISO9660 only allows 8 levels, also stops broken images looping forever
+
+struct isoFile
+{
+	uint32_t lba; // absolute, ready for discImage
+	uint32_t size;
+	bool directory;
+};
+
+// Reads the filesystem on the first track of a disc. Everything is indexed up front, so lookups never touch the disc.
+// Only use this before the disc is inserted into the CDROM, after that the read ahead thread owns the disc image.
+class iso9660
+{
+	public:
+		iso9660(discImage* d);
+		// Paths are case insensitive, can use / or \, and can have a cdrom: prefix or ;1 version, like SYSTEM.CNF uses
+		const isoFile* find(std::string path);
+		std::vector<uint8_t> readFile(const isoFile* file);
+		const std::unordered_map<std::string, isoFile>& getFiles() { return files; }
+		// Finds the EXE the BIOS would boot from SYSTEM.CNF (or PSX.EXE without one), along with the stack it asks for
+		std::string getBootPath(uint32_t& stack);
+		static std::string normalisePath(std::string path);
+	private:
+		discImage* Disc;
+		uint32_t trackStart; // ISO sector numbers are relative to this
+		std::unordered_map<std::string, isoFile> files; // keyed by normalised path, e.g. /DATA/MOVIE.STR
+		void readDirectory(std::string path, const isoFile& directory, uint32_t depth);
+};
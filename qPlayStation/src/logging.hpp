@@ -1,7 +1,7 @@
 #pragma once
 #include <string>
 
-const std::string sourceNames[] = { "qPlayStation", "CPU", "Memory", "BIOS", "DMA", "GPU", "CDROM", "GTE", "Joypad", "TTY", "?" };
+const std::string sourceNames[] = { "qPlayStation", "CPU", "Memory", "BIOS", "DMA", "GPU", "CDROM", "GTE", "Joypad", "TTY", "SPU", "MDEC", "?" };
 
 class logging
 {
@@ -18,6 +18,8 @@ class logging
             GTE,
             Joypad,
             TTY,
+            SPU,
+            MDEC,
             unknown
         };
         static void info(std::string toLog, logSource source = logSource::unknown);
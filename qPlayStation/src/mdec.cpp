@@ -0,0 +1,318 @@
+#include "mdec.hpp"
+#include <algorithm>
+
+// Coefficients arrive lowest frequency first, zig-zagging across the block
+static const uint8_t zigzag[MDEC_BLOCK_SIZE] = {
+	 0,  1,  8, 16,  9,  2,  3, 10,
+	17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34,
+	27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36,
+	29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46,
+	53, 60, 61, 54, 47, 55, 62, 63
+};
+
+mdec::mdec()
+{
+	memset(luminanceQuant, 0, sizeof(luminanceQuant));
+	memset(colourQuant, 0, sizeof(colourQuant));
+	int16_t scaleTable[MDEC_BLOCK_SIZE] = {};
+	mdecKernels::setMatrix(idctTables, scaleTable);
+	memset(blocks, 0, sizeof(blocks));
+	dataInRequest = false;
+	dataOutRequest = false;
+	reset();
+}
+
+void mdec::reset()
+{
+	command = 0;
+	paramsRemaining = 0;
+	params.clear();
+	decodePosition = 0;
+	output.clear();
+	outputPosition = 0;
+}
+
+void mdec::set32(uint32_t addr, uint32_t value)
+{
+	switch (addr)
+	{
+		case 0: writeWord(value); break; // Command / parameters
+		case 4: // Control
+		{
+			if (value & (1u << 31))
+			{
+				reset();
+			}
+			dataInRequest = value & (1 << 30);
+			dataOutRequest = value & (1 << 29);
+			break;
+		}
+		default: logging::fatal("unimplemented MDEC write " + helpers::intToHex(addr), logging::logSource::MDEC); break;
+	}
+}
+
+uint32_t mdec::get32(uint32_t addr)
+{
+	switch (addr)
+	{
+		case 0: // Data
+		{
+			uint32_t value = 0;
+			if (getOutputWords() > 0)
+			{
+				dmaRead((uint8_t*)&value, 4);
+			}
+			return value;
+		}
+		case 4: // Status
+		{
+			uint32_t status = 0;
+			if (getOutputWords() == 0) { status |= 1u << 31; }
+			if (paramsRemaining > 0 || getOutputWords() > 0) { status |= 1 << 29; }
+			if (dataInRequest) { status |= 1 << 28; } // the input is never full
+			if (dataOutRequest && getOutputWords() > 0) { status |= 1 << 27; }
+			status |= ((command >> 25) & 0xF) << 23; // depth, signed and bit 15 from the command
+			status |= 4 << 16; // current block, always Cr (or the only block in monochrome) as whole macroblocks are decoded at once
+			status |= (paramsRemaining - 1) & 0xFFFF;
+			return status;
+		}
+		default: logging::fatal("unimplemented MDEC read " + helpers::intToHex(addr), logging::logSource::MDEC); return 0;
+	}
+}
+
+void mdec::set16(uint32_t addr, uint16_t value) { logging::fatal("unimplemented 16 bit MDEC write " + helpers::intToHex(addr), logging::logSource::MDEC); }
+uint16_t mdec::get16(uint32_t addr) { logging::fatal("unimplemented 16 bit MDEC read " + helpers::intToHex(addr), logging::logSource::MDEC); return 0; }
+void mdec::set8(uint32_t addr, uint8_t value) { logging::fatal("unimplemented 8 bit MDEC write " + helpers::intToHex(addr), logging::logSource::MDEC); }
+uint8_t mdec::get8(uint32_t addr) { logging::fatal("unimplemented 8 bit MDEC read " + helpers::intToHex(addr), logging::logSource::MDEC); return 0; }
+
+void mdec::dmaWrite(const uint8_t* src, uint32_t length)
+{
+	uint32_t words = length / 4;
+	while (words > 0)
+	{
+		if (paramsRemaining == 0)
+		{
+			uint32_t value;
+			memcpy(&value, src, 4);
+			startCommand(value);
+			src += 4;
+			words--;
+			continue;
+		}
+		uint32_t count = std::min(words, paramsRemaining);
+		receiveParams(src, count);
+		src += count * 4;
+		words -= count;
+	}
+}
+
+void mdec::dmaRead(uint8_t* dst, uint32_t length)
+{
+	uint32_t count = std::min<uint32_t>(length, (uint32_t)(output.size() - outputPosition));
+	memcpy(dst, output.data() + outputPosition, count);
+	memset(dst + count, 0, length - count); // reading past the end of the output doesn't happen with DMA, it waits for data
+	outputPosition += count;
+	if (outputPosition == output.size())
+	{
+		output.clear();
+		outputPosition = 0;
+	}
+}
+
+void mdec::writeWord(uint32_t value)
+{
+	if (paramsRemaining == 0)
+	{
+		startCommand(value);
+	}
+	else
+	{
+		receiveParams((const uint8_t*)&value, 1);
+	}
+}
+
+void mdec::startCommand(uint32_t value)
+{
+	command = value;
+	params.clear();
+	decodePosition = 0;
+	switch (value >> 29)
+	{
+		case 1: paramsRemaining = value & 0xFFFF; break; // Decode macroblocks
+		case 2: paramsRemaining = (value & 1) ? 32 : 16; break; // Set quant tables, luminance then optionally colour
+		case 3: paramsRemaining = 32; break; // Set IDCT matrix
+		default: paramsRemaining = value & 0xFFFF; break; // No function, but the parameters are still taken
+	}
+	if (paramsRemaining == 0)
+	{
+		finishCommand();
+	}
+}
+
+void mdec::receiveParams(const uint8_t* src, uint32_t words)
+{
+	size_t start = params.size();
+	params.insert(params.end(), src, src + (words * 4));
+	paramsRemaining -= words;
+	if ((command >> 29) == 1)
+	{
+		// Every block finishes with an end of block code, so there can only be a new macroblock to decode if one just arrived.
+		// This saves decoding the same partial macroblock over and over when the CPU writes a word at a time.
+		for (size_t i = start; i < params.size(); i += 2)
+		{
+			if ((params[i] | (params[i + 1] << 8)) == MDEC_END_OF_BLOCK)
+			{
+				decodeAvailable();
+				break;
+			}
+		}
+	}
+	if (paramsRemaining == 0)
+	{
+		finishCommand();
+	}
+}
+
+void mdec::finishCommand()
+{
+	switch (command >> 29)
+	{
+		case 2:
+		{
+			memcpy(luminanceQuant, params.data(), MDEC_BLOCK_SIZE);
+			if (command & 1)
+			{
+				memcpy(colourQuant, params.data() + MDEC_BLOCK_SIZE, MDEC_BLOCK_SIZE);
+			}
+			break;
+		}
+		case 3:
+		{
+			int16_t scaleTable[MDEC_BLOCK_SIZE];
+			memcpy(scaleTable, params.data(), sizeof(scaleTable));
+			mdecKernels::setMatrix(idctTables, scaleTable);
+			break;
+		}
+	}
+	// Anything left of a decode is padding, or a macroblock that was cut off
+	params.clear();
+	decodePosition = 0;
+}
+
+void mdec::decodeAvailable()
+{
+	bool colour = depth() == mdecDepth::Bit15 || depth() == mdecDepth::Bit24;
+	while (true)
+	{
+		uint32_t position = decodePosition;
+		if (colour)
+		{
+			for (uint32_t b = 0; b < MDEC_COLOUR_BLOCKS; b++)
+			{
+				if (!decodeBlock(position, blocks[b], (b < 2) ? colourQuant : luminanceQuant))
+				{
+					return; // the rest of the macroblock hasn't arrived yet, it's decoded again from the start next time
+				}
+			}
+			decodePosition = position;
+			outputColour();
+		}
+		else
+		{
+			if (!decodeBlock(position, blocks[0], luminanceQuant))
+			{
+				return;
+			}
+			decodePosition = position;
+			outputMonochrome();
+		}
+	}
+}
+
+static inline int32_t signed10(uint16_t value)
+{
+	return helpers::signExtend<int32_t>(value & 0x3FF, 10);
+}
+
+// Run length decodes and dequantises one block, then turns it into pixels.
+// Returns false if the data ran out before the end of the block.
+bool mdec::decodeBlock(uint32_t& position, int16_t* out, const uint8_t* quant)
+{
+	const uint32_t end = (uint32_t)params.size() & ~1u;
+	uint16_t value;
+	do // skip padding between blocks
+	{
+		if (position >= end) { return false; }
+		value = params[position] | (params[position + 1] << 8);
+		position += 2;
+	} while (value == MDEC_END_OF_BLOCK);
+
+	alignas(16) int16_t coefficients[MDEC_BLOCK_SIZE] = {};
+	uint32_t rows = 0; // the IDCT can skip rows past the last non zero one
+	uint32_t scale = value >> 10;
+	int32_t coefficient = signed10(value) * quant[0];
+	uint32_t k = 0;
+	while (true)
+	{
+		// A scale of 0 stores the values as they are, without the zig-zag
+		if (scale == 0) { coefficient = signed10(value) * 2; }
+		coefficient = std::max(-0x400, std::min(0x3FF, coefficient));
+		uint32_t index = (scale > 0) ? zigzag[k] : k;
+		coefficients[index] = (int16_t)coefficient;
+		if (coefficient != 0) { rows = std::max(rows, (index / 8) + 1); }
+
+		if (position >= end) { return false; }
+		value = params[position] | (params[position + 1] << 8);
+		position += 2;
+		k += (value >> 10) + 1; // the top 6 bits are how many zeros to skip, so the end of block code goes past 63
+		if (k >= MDEC_BLOCK_SIZE) { break; }
+		coefficient = ((signed10(value) * quant[k] * (int32_t)scale) + 4) >> 3;
+	}
+	mdecKernels::idct(idctTables, coefficients, out, rows);
+	return true;
+}
+
+void mdec::outputColour()
+{
+	// blocks[0] and [1] are Cr and Cb for the whole 16x16 macroblock, [2]-[5] are the luminance of each 8x8 quarter
+	size_t start = output.size();
+	output.resize(start + (16 * 16 * ((depth() == mdecDepth::Bit15) ? 2 : 3)));
+	for (uint32_t quarter = 0; quarter < 4; quarter++)
+	{
+		uint32_t x = (quarter & 1) * 8;
+		uint32_t y = (quarter >> 1) * 8;
+		uint32_t chromaOffset = ((y / 2) * 8) + (x / 2);
+		if (depth() == mdecDepth::Bit15)
+		{
+			uint16_t* pixels = (uint16_t*)(output.data() + start);
+			mdecKernels::yuvToRGB15(blocks[2 + quarter], blocks[0], blocks[1], chromaOffset, &pixels[(y * 16) + x], 16, outputSigned(), outputBit15());
+		}
+		else
+		{
+			mdecKernels::yuvToRGB24(blocks[2 + quarter], blocks[0], blocks[1], chromaOffset, output.data() + start + (((y * 16) + x) * 3), 16, outputSigned());
+		}
+	}
+}
+
+void mdec::outputMonochrome()
+{
+	uint8_t pixels[MDEC_BLOCK_SIZE];
+	for (uint32_t i = 0; i < MDEC_BLOCK_SIZE; i++)
+	{
+		pixels[i] = (uint8_t)(outputSigned() ? blocks[0][i] : (blocks[0][i] + 128));
+	}
+	if (depth() == mdecDepth::Bit8)
+	{
+		output.insert(output.end(), pixels, pixels + MDEC_BLOCK_SIZE);
+	}
+	else // 4 bit, two pixels to a byte with the first in the low nibble
+	{
+		for (uint32_t i = 0; i < MDEC_BLOCK_SIZE; i += 2)
+		{
+			output.push_back((pixels[i] >> 4) | (pixels[i + 1] & 0xF0));
+		}
+	}
+}
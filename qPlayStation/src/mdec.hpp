@@ -0,0 +1,61 @@
+#pragma once
+#include "helpers.hpp"
+#include "peripheral.hpp"
+#include "mdecKernels.hpp"
+
+#define MDEC_COLOUR_BLOCKS 6 // Cr, Cb then the 4 luminance blocks of a 16x16 macroblock
+#define MDEC_END_OF_BLOCK 0xFE00
+
+enum class mdecDepth : uint8_t
+{
+	Bit4 = 0,
+	Bit8 = 1,
+	Bit24 = 2,
+	Bit15 = 3
+};
+
+// The macroblock decoder, used for FMVs. Run length coded coefficients come in through 0x1F801820 or DMA channel 0,
+// and 16x16 blocks of 15/24 bit colour (or 8x8 blocks of 4/8 bit monochrome) go out through the same register or DMA channel 1.
+// Everything is decoded as soon as the data for a whole macroblock has arrived, so the output is ready before DMA asks for it.
+class mdec : public peripheral
+{
+	public:
+		mdec();
+		// DMA channel 0 and 1, whole spans rather than a word at a time
+		void dmaWrite(const uint8_t* src, uint32_t length);
+		void dmaRead(uint8_t* dst, uint32_t length);
+		uint32_t getOutputWords() { return (uint32_t)((output.size() - outputPosition) / 4); }
+		void set32(uint32_t addr, uint32_t value);
+		uint32_t get32(uint32_t addr);
+		void set16(uint32_t addr, uint16_t value);
+		uint16_t get16(uint32_t addr);
+		void set8(uint32_t addr, uint8_t value);
+		uint8_t get8(uint32_t addr);
+	private:
+		uint32_t command; // the last command word, bits 31-29 are the command and the rest its settings
+		uint32_t paramsRemaining; // words still to come for the current command
+		std::vector<uint8_t> params; // what's arrived of them
+		uint32_t decodePosition; // byte offset in params of the first macroblock that hasn't been decoded yet
+		std::vector<uint8_t> output;
+		uint32_t outputPosition; // bytes already read out
+		bool dataInRequest; // DMA channel 0 is allowed to send
+		bool dataOutRequest; // DMA channel 1 is allowed to receive
+
+		uint8_t luminanceQuant[MDEC_BLOCK_SIZE];
+		uint8_t colourQuant[MDEC_BLOCK_SIZE];
+		mdecIDCTTables idctTables;
+		alignas(16) int16_t blocks[MDEC_COLOUR_BLOCKS][MDEC_BLOCK_SIZE];
+
+		mdecDepth depth() { return (mdecDepth)((command >> 27) & 0x3); }
+		bool outputSigned() { return command & (1 << 26); }
+		bool outputBit15() { return command & (1 << 25); }
+		void reset();
+		void writeWord(uint32_t value);
+		void startCommand(uint32_t value);
+		void receiveParams(const uint8_t* src, uint32_t words);
+		void finishCommand();
+		void decodeAvailable();
+		bool decodeBlock(uint32_t& position, int16_t* out, const uint8_t* quant);
+		void outputColour();
+		void outputMonochrome();
+};
@@ -0,0 +1,248 @@
+#include "mdecKernels.hpp"
+#include <algorithm>
+
+#if !defined(MDEC_KERNELS_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define MDEC_KERNELS_SSE2
+#endif
+
+#define IDCT_SHIFT 13 // the matrix is 2^13 times the real basis functions, so each pass shifts that back out
+#define IDCT_ROUND (1 << (IDCT_SHIFT - 1))
+
+void mdecKernels::setMatrix(mdecIDCTTables& tables, const int16_t* scaleTable)
+{
+	for (uint32_t i = 0; i < MDEC_BLOCK_SIZE; i++)
+	{
+		tables.matrix[i] = scaleTable[i] >> 3;
+	}
+	for (uint32_t p = 0; p < 4; p++)
+	{
+		for (uint32_t x = 0; x < 8; x++)
+		{
+			tables.rowPairs[p][x / 4][((x % 4) * 2)] = tables.matrix[(p * 16) + x];
+			tables.rowPairs[p][x / 4][((x % 4) * 2) + 1] = tables.matrix[(p * 16) + 8 + x];
+			tables.columnPairs[x][p] = (uint16_t)tables.matrix[(p * 16) + x] | ((uint32_t)(uint16_t)tables.matrix[(p * 16) + 8 + x] << 16);
+		}
+	}
+}
+
+static inline int16_t saturate16(int32_t value)
+{
+	return (int16_t)std::max(-0x8000, std::min(0x7FFF, value));
+}
+
+static inline int16_t clampPixel(int32_t value)
+{
+	return (int16_t)std::max(-128, std::min(127, value));
+}
+
+#ifdef MDEC_KERNELS_SSE2
+// Sums rows 2p and 2p+1 of the matrix weighted by the pair of coefficients in 32 bit lane p of row
+#define IDCT_ROW_PAIR(p, shuffle) \
+	{ \
+		__m128i pair = _mm_shuffle_epi32(row, shuffle); \
+		low = _mm_add_epi32(low, _mm_madd_epi16(pair, _mm_load_si128((const __m128i*)tables.rowPairs[p][0]))); \
+		high = _mm_add_epi32(high, _mm_madd_epi16(pair, _mm_load_si128((const __m128i*)tables.rowPairs[p][1]))); \
+	}
+
+void mdecKernels::idct(const mdecIDCTTables& tables, const int16_t* in, int16_t* out, uint32_t rows)
+{
+	const __m128i round = _mm_set1_epi32(IDCT_ROUND);
+
+	// Rows: temp[v][x] = sum over u of in[v][u] * matrix[u][x]
+	__m128i temp[8];
+	for (uint32_t v = 0; v < 8; v++)
+	{
+		if (v >= rows)
+		{
+			temp[v] = _mm_setzero_si128();
+			continue;
+		}
+		__m128i row = _mm_loadu_si128((const __m128i*)&in[v * 8]);
+		__m128i low = _mm_setzero_si128();
+		__m128i high = _mm_setzero_si128();
+		IDCT_ROW_PAIR(0, 0x00);
+		IDCT_ROW_PAIR(1, 0x55);
+		IDCT_ROW_PAIR(2, 0xAA);
+		IDCT_ROW_PAIR(3, 0xFF);
+		temp[v] = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(low, round), IDCT_SHIFT), _mm_srai_epi32(_mm_add_epi32(high, round), IDCT_SHIFT));
+	}
+
+	// Columns: out[y][x] = sum over v of matrix[v][y] * temp[v][x], with rows v and v+1 of temp interleaved so one madd does both
+	uint32_t pairs = (rows + 1) / 2;
+	__m128i interleaved[4][2];
+	for (uint32_t p = 0; p < pairs; p++)
+	{
+		interleaved[p][0] = _mm_unpacklo_epi16(temp[p * 2], temp[(p * 2) + 1]);
+		interleaved[p][1] = _mm_unpackhi_epi16(temp[p * 2], temp[(p * 2) + 1]);
+	}
+	const __m128i pixelMin = _mm_set1_epi16(-128);
+	const __m128i pixelMax = _mm_set1_epi16(127);
+	for (uint32_t y = 0; y < 8; y++)
+	{
+		__m128i low = _mm_setzero_si128();
+		__m128i high = _mm_setzero_si128();
+		for (uint32_t p = 0; p < pairs; p++)
+		{
+			__m128i weights = _mm_set1_epi32(tables.columnPairs[y][p]);
+			low = _mm_add_epi32(low, _mm_madd_epi16(interleaved[p][0], weights));
+			high = _mm_add_epi32(high, _mm_madd_epi16(interleaved[p][1], weights));
+		}
+		__m128i pixels = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(low, round), IDCT_SHIFT), _mm_srai_epi32(_mm_add_epi32(high, round), IDCT_SHIFT));
+		_mm_storeu_si128((__m128i*)&out[y * 8], _mm_min_epi16(_mm_max_epi16(pixels, pixelMin), pixelMax));
+	}
+}
+
+// The chroma maths is done in 16 bit lanes. The big multipliers (359 and 454) would overflow,
+// so they're split into 256 (a plain add after the shift) plus the rest.
+struct rgbVectors
+{
+	__m128i r;
+	__m128i g;
+	__m128i b;
+};
+
+static inline rgbVectors convertRow(const int16_t* y, const int16_t* cr, const int16_t* cb, bool isSigned)
+{
+	const __m128i round = _mm_set1_epi16(0x80);
+	const __m128i pixelMin = _mm_set1_epi16(-128);
+	const __m128i pixelMax = _mm_set1_epi16(127);
+	__m128i luma = _mm_loadu_si128((const __m128i*)y);
+	// Each chroma sample covers 2 pixels across
+	__m128i red = _mm_loadl_epi64((const __m128i*)cr);
+	red = _mm_unpacklo_epi16(red, red);
+	__m128i blue = _mm_loadl_epi64((const __m128i*)cb);
+	blue = _mm_unpacklo_epi16(blue, blue);
+
+	__m128i rOffset = _mm_add_epi16(red, _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(red, _mm_set1_epi16(103)), round), 8));
+	__m128i bOffset = _mm_add_epi16(blue, _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(blue, _mm_set1_epi16(198)), round), 8));
+	__m128i gFromB = _mm_srai_epi16(_mm_and_si128(_mm_mullo_epi16(blue, _mm_set1_epi16(-88)), _mm_set1_epi16(~0x1F)), 3);
+	__m128i gFromR = _mm_srai_epi16(_mm_and_si128(_mm_mullo_epi16(red, _mm_set1_epi16(-183)), _mm_set1_epi16(~0x07)), 3);
+	__m128i gOffset = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(gFromB, gFromR), _mm_set1_epi16(0x10)), 5);
+
+	rgbVectors out;
+	out.r = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(luma, rOffset), pixelMin), pixelMax);
+	out.g = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(luma, gOffset), pixelMin), pixelMax);
+	out.b = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(luma, bOffset), pixelMin), pixelMax);
+	if (!isSigned)
+	{
+		const __m128i bias = _mm_set1_epi16(128);
+		out.r = _mm_add_epi16(out.r, bias);
+		out.g = _mm_add_epi16(out.g, bias);
+		out.b = _mm_add_epi16(out.b, bias);
+	}
+	return out;
+}
+
+void mdecKernels::yuvToRGB15(const int16_t* y, const int16_t* cr, const int16_t* cb, uint32_t chromaOffset, uint16_t* out, uint32_t stride, bool isSigned, bool setBit15)
+{
+	const __m128i mask5 = _mm_set1_epi16(0x1F);
+	const __m128i bit15 = _mm_set1_epi16(setBit15 ? (int16_t)0x8000 : 0);
+	for (uint32_t row = 0; row < 8; row++)
+	{
+		uint32_t chroma = chromaOffset + ((row / 2) * 8);
+		rgbVectors rgb = convertRow(&y[row * 8], &cr[chroma], &cb[chroma], isSigned);
+		// Signed output keeps the two's complement bits, so mask after shifting
+		__m128i pixels = _mm_and_si128(_mm_srai_epi16(rgb.r, 3), mask5);
+		pixels = _mm_or_si128(pixels, _mm_slli_epi16(_mm_and_si128(_mm_srai_epi16(rgb.g, 3), mask5), 5));
+		pixels = _mm_or_si128(pixels, _mm_slli_epi16(_mm_and_si128(_mm_srai_epi16(rgb.b, 3), mask5), 10));
+		_mm_storeu_si128((__m128i*)&out[row * stride], _mm_or_si128(pixels, bit15));
+	}
+}
+
+void mdecKernels::yuvToRGB24(const int16_t* y, const int16_t* cr, const int16_t* cb, uint32_t chromaOffset, uint8_t* out, uint32_t stride, bool isSigned)
+{
+	for (uint32_t row = 0; row < 8; row++)
+	{
+		uint32_t chroma = chromaOffset + ((row / 2) * 8);
+		rgbVectors rgb = convertRow(&y[row * 8], &cr[chroma], &cb[chroma], isSigned);
+		// SSE2 has no byte shuffle, so the packed bytes are spread out to RGB triples one pixel at a time
+		alignas(16) uint8_t rg[16];
+		alignas(16) uint8_t b[16];
+		const __m128i lowByte = _mm_set1_epi16(0xFF);
+		_mm_store_si128((__m128i*)rg, _mm_packus_epi16(_mm_and_si128(rgb.r, lowByte), _mm_and_si128(rgb.g, lowByte)));
+		_mm_store_si128((__m128i*)b, _mm_packus_epi16(_mm_and_si128(rgb.b, lowByte), _mm_setzero_si128()));
+		uint8_t* dst = &out[row * stride * 3];
+		for (uint32_t x = 0; x < 8; x++)
+		{
+			dst[(x * 3)] = rg[x];
+			dst[(x * 3) + 1] = rg[8 + x];
+			dst[(x * 3) + 2] = b[x];
+		}
+	}
+}
+#else
+void mdecKernels::idct(const mdecIDCTTables& tables, const int16_t* in, int16_t* out, uint32_t rows)
+{
+	const int16_t* matrix = tables.matrix;
+	int16_t temp[MDEC_BLOCK_SIZE] = {};
+	for (uint32_t v = 0; v < rows; v++)
+	{
+		for (uint32_t x = 0; x < 8; x++)
+		{
+			int32_t sum = 0;
+			for (uint32_t u = 0; u < 8; u++)
+			{
+				sum += in[(v * 8) + u] * matrix[(u * 8) + x];
+			}
+			temp[(v * 8) + x] = saturate16((sum + IDCT_ROUND) >> IDCT_SHIFT);
+		}
+	}
+	for (uint32_t y = 0; y < 8; y++)
+	{
+		for (uint32_t x = 0; x < 8; x++)
+		{
+			int32_t sum = 0;
+			for (uint32_t v = 0; v < rows; v++)
+			{
+				sum += matrix[(v * 8) + y] * temp[(v * 8) + x];
+			}
+			out[(y * 8) + x] = clampPixel(saturate16((sum + IDCT_ROUND) >> IDCT_SHIFT));
+		}
+	}
+}
+
+static inline void convertPixel(int32_t y, int32_t cr, int32_t cb, bool isSigned, int32_t& r, int32_t& g, int32_t& b)
+{
+	r = clampPixel(y + cr + (((103 * cr) + 0x80) >> 8));
+	g = clampPixel(y + (((((-88 * cb) & ~0x1F) >> 3) + (((-183 * cr) & ~0x07) >> 3) + 0x10) >> 5));
+	b = clampPixel(y + cb + (((198 * cb) + 0x80) >> 8));
+	if (!isSigned)
+	{
+		r += 128;
+		g += 128;
+		b += 128;
+	}
+}
+
+void mdecKernels::yuvToRGB15(const int16_t* y, const int16_t* cr, const int16_t* cb, uint32_t chromaOffset, uint16_t* out, uint32_t stride, bool isSigned, bool setBit15)
+{
+	for (uint32_t row = 0; row < 8; row++)
+	{
+		for (uint32_t x = 0; x < 8; x++)
+		{
+			uint32_t chroma = chromaOffset + ((row / 2) * 8) + (x / 2);
+			int32_t r, g, b;
+			convertPixel(y[(row * 8) + x], cr[chroma], cb[chroma], isSigned, r, g, b);
+			out[(row * stride) + x] = ((r >> 3) & 0x1F) | (((g >> 3) & 0x1F) << 5) | (((b >> 3) & 0x1F) << 10) | (setBit15 ? 0x8000 : 0);
+		}
+	}
+}
+
+void mdecKernels::yuvToRGB24(const int16_t* y, const int16_t* cr, const int16_t* cb, uint32_t chromaOffset, uint8_t* out, uint32_t stride, bool isSigned)
+{
+	for (uint32_t row = 0; row < 8; row++)
+	{
+		for (uint32_t x = 0; x < 8; x++)
+		{
+			uint32_t chroma = chromaOffset + ((row / 2) * 8) + (x / 2);
+			int32_t r, g, b;
+			convertPixel(y[(row * 8) + x], cr[chroma], cb[chroma], isSigned, r, g, b);
+			uint8_t* dst = &out[((row * stride) + x) * 3];
+			dst[0] = (uint8_t)r;
+			dst[1] = (uint8_t)g;
+			dst[2] = (uint8_t)b;
+		}
+	}
+}
+#endif
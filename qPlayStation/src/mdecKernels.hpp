@@ -0,0 +1,31 @@
+#pragma once
+#include "helpers.hpp"
+
+#define MDEC_BLOCK_SIZE 64 // coefficients or pixels in an 8x8 block
+
+// The game's IDCT matrix, rearranged so each pass of the IDCT is a handful of multiply-adds
+struct mdecIDCTTables
+{
+	int16_t matrix[MDEC_BLOCK_SIZE]; // [frequency][position], already divided by 8 like the hardware
+	alignas(16) int16_t rowPairs[4][2][8]; // rows 2p and 2p+1 interleaved, positions 0-3 then 4-7
+	int32_t columnPairs[8][4]; // matrix[2p][position] in the low half and matrix[2p + 1][position] in the high half
+};
+
+// The per block inner loops of the MDEC. SSE2 when the build targets it, with a scalar version
+// that gives exactly the same results for everything else (define MDEC_KERNELS_SCALAR to force it).
+class mdecKernels
+{
+	public:
+		static void setMatrix(mdecIDCTTables& tables, const int16_t* scaleTable);
+		// Turns dequantised coefficients into pixels between -128 and 127. Only the first rows rows of in can be non zero,
+		// the rest are skipped as they'd add nothing.
+		static void idct(const mdecIDCTTables& tables, const int16_t* in, int16_t* out, uint32_t rows);
+		// Converts an 8x8 luminance block and the matching quarter of the chroma blocks to 15 bit colour,
+		// writing 8 rows of 8 pixels stride pixels apart. chromaOffset is where the quarter starts in Cr and Cb.
+		static void yuvToRGB15(const int16_t* y, const int16_t* cr, const int16_t* cb, uint32_t chromaOffset, uint16_t* out, uint32_t stride, bool isSigned, bool setBit15);
+		// The same to 24 bit RGB, 3 bytes per pixel
+		static void yuvToRGB24(const int16_t* y, const int16_t* cr, const int16_t* cb, uint32_t chromaOffset, uint8_t* out, uint32_t stride, bool isSigned);
+	private:
+		//private constructor means no instances of this object can be created
+		mdecKernels() {}
+};
@@ -1,28 +1,41 @@
 #include "memory.hpp"
 
-memory::memory(bios* b, gpu* g, interruptController* i, cdrom* c, joypad* j)
+memory::memory(bios* b, gpu* g, interruptController* i, cdrom* c, joypad* j, spu* s)
 {
 	BIOS = b;
 	GPU = g;
 	CDROM = c;
 	RAM = new ram();
 	Scratchpad = new scratchpad();
-	DMA = new dma(RAM, GPU);
+	MDEC = new mdec();
+	DMA = new dma(RAM, GPU, CDROM, s, MDEC);
 	TTY = new tty();
 	InterruptController = i;
 	Joypad = j;
+	SPU = s;
 	pStub = new peripheralStub();
 }
 
 memory::~memory()
 {
 	delete(DMA);
+	delete(MDEC);
 	delete(RAM);
 	delete(Scratchpad);
 	delete(TTY);
 	delete(pStub);
 }
 
+void memory::setTTYExitPattern(std::string pattern)
+{
+	TTY->setExitPattern(pattern);
+}
+
+bool memory::ttyExitPatternSeen()
+{
+	return TTY->exitPatternSeen();
+}
+
 void memory::set32(uint32_t addr, uint32_t value)
 {
 	if (!helpers::is32BitAligned(addr))
@@ -79,6 +92,16 @@ uint8_t memory::get8(uint32_t addr)
 	return p.periph->get8(p.adjustedAddress);
 }
 
+void memory::writeBlock(uint32_t addr, const uint8_t* src, uint32_t length)
+{
+	uint32_t adjAddr = addr & 0x1FFFFFFF;
+	if (adjAddr >= 0x800000 || (adjAddr % RAM_SIZE) + length > RAM_SIZE)
+	{
+		logging::fatal("Block write outside of RAM: " + helpers::intToHex(addr), logging::logSource::memory);
+	}
+	RAM->writeBlock(adjAddr, src, length);
+}
+
 PeriphRequestInfo memory::getPeriphAtAddress(uint32_t addr)
 {
 	uint8_t segment = addr >> 29; //000 = KUSEG, 100 = KSEG0, 101 = KSEG1, 111 = KSEG2
@@ -129,8 +152,11 @@ PeriphRequestInfo memory::getPeriphAtAddress(uint32_t addr)
 		}
 		else if (adjAddr >= 0x1F801820 && adjAddr < 0x1F801828) // MDEC Registers
 		{
-			logging::info("MDEC Access: " + helpers::intToHex(addr), logging::logSource::memory);
-			return {pStub, 0};
+			return {MDEC, adjAddr - 0x1F801820};
+		}
+		else if (adjAddr >= 0x1F801C00 && adjAddr < 0x1F802000) // SPU Registers
+		{
+			return {SPU, adjAddr - 0x1F801C00};
 		}
 		else if (adjAddr >= 0x1F802020 && adjAddr < 0x1F802030) // DUART
 		{
@@ -174,6 +200,12 @@ void tty::set8(uint32_t addr, uint8_t value)
 		else
 		{
 			buffer.append(1, (char)value);
+			// Checked per character so prompts that don't end in a newline still match
+			if (!exitPattern.empty() && buffer.size() >= exitPattern.size() &&
+				buffer.compare(buffer.size() - exitPattern.size(), exitPattern.size(), exitPattern) == 0)
+			{
+				patternSeen = true;
+			}
 		}
 	}
 }
@@ -7,6 +7,7 @@
 #include "interrupt.hpp"
 #include "cdrom.hpp"
 #include "joypad.hpp"
+#include "spu.hpp"
 
 struct PeriphRequestInfo
 {
@@ -18,7 +19,11 @@ class tty : public peripheral
 {
 	private:
 		std::string buffer = "";
+		std::string exitPattern = "";
+		bool patternSeen = false;
 	public:
+		void setExitPattern(std::string pattern) { exitPattern = pattern; }
+		bool exitPatternSeen() { return patternSeen; }
 		void set32(uint32_t addr, uint32_t value);
 		uint32_t get32(uint32_t addr);
 		void set16(uint32_t addr, uint16_t value);
@@ -30,7 +35,7 @@ class tty : public peripheral
 class memory
 {
 	public:
-		memory(bios* b, gpu* g, interruptController* i, cdrom* c, joypad* j);
+		memory(bios* b, gpu* g, interruptController* i, cdrom* c, joypad* j, spu* s);
 		~memory();
 		void set32(uint32_t addr, uint32_t value);
 		uint32_t get32(uint32_t addr);
@@ -38,6 +43,9 @@ class memory
 		uint16_t get16(uint32_t addr);
 		void set8(uint32_t addr, uint8_t value);
 		uint8_t get8(uint32_t addr);
+		void writeBlock(uint32_t addr, const uint8_t* src, uint32_t length); // bulk copy into main RAM
+		void setTTYExitPattern(std::string pattern);
+		bool ttyExitPatternSeen();
 	private:
 		bios* BIOS;
 		ram* RAM;
@@ -47,6 +55,8 @@ class memory
 		tty* TTY;
 		cdrom* CDROM;
 		joypad* Joypad;
+		spu* SPU;
+		mdec* MDEC;
 		interruptController* InterruptController;
 		peripheralStub* pStub;
 		PeriphRequestInfo getPeriphAtAddress(uint32_t addr);
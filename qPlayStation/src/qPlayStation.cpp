@@ -17,75 +17,425 @@ void initSDL()
     }
 }
 
-// Arg 1 = BIOS path, Arg 2 = Game Path
-int main(int argc, char* args[])
+// Accepts "all", or a comma separated list of frame numbers and ranges, e.g. "60,120-130"
+std::vector<std::pair<uint64_t, uint64_t>> parseFrameList(std::string value)
 {
-    EXEInfo exeInfo = { true, 0, 0, 0 };
-    if (argc < 2)
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    if (value == "all")
     {
-        logging::fatal("need BIOS path", logging::logSource::qPS);
+        ranges.push_back({ 0, UINT64_MAX });
+        return ranges;
     }
-    if (argc < 3)
+
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ','))
     {
-        exeInfo.present = false;
+        size_t dash = item.find('-');
+        try
+        {
+            if (dash == std::string::npos)
+            {
+                uint64_t frame = std::stoull(item);
+                ranges.push_back({ frame, frame });
+            }
+            else
+            {
+                ranges.push_back({ std::stoull(item.substr(0, dash)), std::stoull(item.substr(dash + 1)) });
+            }
+        }
+        catch (std::exception&)
+        {
+            logging::fatal("invalid frame list: " + value, logging::logSource::qPS);
+        }
     }
-    //exeInfo.present = false; // uncomment to force BIOS
-
-    initSDL();
+    return ranges;
+}
 
-    bios* BIOS = new bios(args[1]);
-    interruptController* InterruptController = new interruptController();
-    joypad* Joypad = new joypad(InterruptController);
-    cdrom* CDROM = new cdrom(InterruptController);
-    gpu* GPU = new gpu(window, InterruptController);
-    memory* Memory = new memory(BIOS, GPU, InterruptController, CDROM, Joypad);
+launchOptions parseArgs(int argc, char* args[])
+{
+    launchOptions options;
+    options.renderer = rendererType::OpenGL;
+    options.captureSnapshotInterval = 60;
+    options.hashVRAM = false;
+    options.headless = false;
+    options.frameLimit = 0;
+    options.dumpDir = ".";
+    options.dumpRaw = false;
+    options.dumpVRAM = false;
+    options.recordQueueLength = 8;
+    options.recordPolicy = videoDumpPolicy::Drop;
+    options.gteBench = false;
+    options.reverbBench = false;
+    options.chdCacheMiB = 64;
+    options.cdSpeedUp = 1;
+    options.fastBoot = false;
+    options.audioSink = audioSinkType::SDL;
+    options.audioLatencyMs = AUDIO_DEFAULT_LATENCY_MS;
 
-    if (exeInfo.present)
+    for (int i = 1; i < argc; i++)
     {
-        //Load EXE file
-        std::ifstream exeFile(args[2], std::ios::in | std::ios::binary | std::ios::ate);
-        if (exeFile.is_open())
+        std::string arg = args[i];
+        if (arg.rfind("--", 0) != 0)
         {
-            int size = (int)exeFile.tellg();
-            uint8_t* exeData = new uint8_t[size];
-            exeFile.seekg(0, std::ios::beg);
-            exeFile.read((char*)exeData, size);
-            exeFile.close();
-            logging::info("Loaded EXE successfully", logging::logSource::qPS);
+            options.positional.push_back(args[i]);
+            continue;
+        }
 
-            const char correctHeader[] = "PS-X EXE";
-            for (int i = 0; i < sizeof(correctHeader); i++)
+        // Options that don't take a value
+        if (arg == "--hash")
+        {
+            options.hashVRAM = true;
+            continue;
+        }
+        if (arg == "--headless")
+        {
+            options.headless = true;
+            continue;
+        }
+        if (arg == "--dump-vram")
+        {
+            options.dumpVRAM = true;
+            continue;
+        }
+        if (arg == "--fast-boot")
+        {
+            options.fastBoot = true;
+            continue;
+        }
+        if (arg == "--gte-bench")
+        {
+            options.gteBench = true;
+            continue;
+        }
+        if (arg == "--reverb-bench")
+        {
+            options.reverbBench = true;
+            continue;
+        }
+        if (arg == "--no-audio")
+        {
+            options.audioSink = audioSinkType::None;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            logging::fatal("missing value for option " + arg, logging::logSource::qPS);
+        }
+        std::string value = args[++i];
+        if (arg == "--renderer")
+        {
+            options.renderer = rendererTypeFromName(value);
+        }
+        else if (arg == "--capture")
+        {
+            options.capturePath = value;
+        }
+        else if (arg == "--capture-snapshots")
+        {
+            options.captureSnapshotInterval = std::stoul(value);
+        }
+        else if (arg == "--replay")
+        {
+            options.replayPath = value;
+        }
+        else if (arg == "--frames")
+        {
+            options.frameLimit = std::stoull(value);
+        }
+        else if (arg == "--tty-exit")
+        {
+            options.ttyExitPattern = value;
+        }
+        else if (arg == "--dump-frames")
+        {
+            options.dumpFrames = parseFrameList(value);
+        }
+        else if (arg == "--dump-dir")
+        {
+            options.dumpDir = value;
+        }
+        else if (arg == "--dump-format")
+        {
+            if (value != "png" && value != "raw")
             {
-                if (exeData[i] != correctHeader[i])
-                {
-                    logging::fatal("EXE has incorrect header", logging::logSource::qPS);
-                }
+                logging::fatal("unknown dump format " + value, logging::logSource::qPS);
             }
-
-            exeInfo.initialPC = exeData[0x10] | (((uint32_t)exeData[0x11]) << 8) | (((uint32_t)exeData[0x12]) << 16) | (((uint32_t)exeData[0x13]) << 24);
-            exeInfo.initialR28 = exeData[0x14] | (((uint32_t)exeData[0x15]) << 8) | (((uint32_t)exeData[0x16]) << 16) | (((uint32_t)exeData[0x17]) << 24);
-            uint32_t initialR29R30 = exeData[0x30] | (((uint32_t)exeData[0x31]) << 8) | (((uint32_t)exeData[0x32]) << 16) | (((uint32_t)exeData[0x33]) << 24);
-            uint32_t offsetR29R30 = exeData[0x34] | (((uint32_t)exeData[0x35]) << 8) | (((uint32_t)exeData[0x36]) << 16) | (((uint32_t)exeData[0x37]) << 24);
-            exeInfo.initialR29R30 = initialR29R30 + offsetR29R30;
-
-            uint32_t destAddress = exeData[0x18] | (((uint32_t)exeData[0x19]) << 8) | (((uint32_t)exeData[0x1A]) << 16) | (((uint32_t)exeData[0x1B]) << 24);
-            uint32_t fileSize = exeData[0x1C] | (((uint32_t)exeData[0x1D]) << 8) | (((uint32_t)exeData[0x1E]) << 16) | (((uint32_t)exeData[0x1F]) << 24);
-
-            for (uint32_t i = 0; i < fileSize; i++)
+            options.dumpRaw = value == "raw";
+        }
+        else if (arg == "--disc")
+        {
+            options.discPath = value;
+        }
+        else if (arg == "--chd-cache")
+        {
+            options.chdCacheMiB = std::stoul(value);
+        }
+        else if (arg == "--cd-speed")
+        {
+            options.cdSpeedUp = (value == "instant") ? 0 : std::stoul(value);
+            if (value != "instant" && (options.cdSpeedUp < 1 || options.cdSpeedUp > CD_MAX_SPEED_UP))
             {
-                // this should probably be a memset, but whatever
-                Memory->set8(destAddress + i, exeData[0x800 + i]);
+                logging::fatal("CD speed has to be 1-" + std::to_string(CD_MAX_SPEED_UP) + " or instant", logging::logSource::qPS);
             }
-            delete[] exeData;
+        }
+        else if (arg == "--record")
+        {
+            options.recordPath = value;
+        }
+        else if (arg == "--record-queue")
+        {
+            options.recordQueueLength = std::stoul(value);
+        }
+        else if (arg == "--record-policy")
+        {
+            if (value != "drop" && value != "block")
+            {
+                logging::fatal("unknown record policy " + value, logging::logSource::qPS);
+            }
+            options.recordPolicy = value == "drop" ? videoDumpPolicy::Drop : videoDumpPolicy::Block;
+        }
+        else if (arg == "--audio-wav")
+        {
+            options.audioSink = audioSinkType::WAV;
+            options.audioWavPath = value;
+        }
+        else if (arg == "--audio-latency")
+        {
+            options.audioLatencyMs = std::max(std::stoul(value), 1ul);
         }
         else
         {
-            logging::fatal("unable to load EXE file", logging::logSource::qPS);
+            logging::fatal("unknown option " + arg, logging::logSource::qPS);
         }
     }
+    if (options.headless && options.renderer == rendererType::OpenGL)
+    {
+        logging::warning("OpenGL renderer needs a window, using the software renderer instead", logging::logSource::qPS);
+        options.renderer = rendererType::Software;
+    }
+    if (options.headless && options.audioSink == audioSinkType::SDL)
+    {
+        options.audioSink = audioSinkType::None; // no audio device either, but --audio-wav still works
+    }
+    return options;
+}
+
+bool shouldDumpFrame(const launchOptions& options, uint64_t frame)
+{
+    for (const std::pair<uint64_t, uint64_t>& range : options.dumpFrames)
+    {
+        if (frame >= range.first && frame <= range.second) { return true; }
+    }
+    return false;
+}
+
+void dumpFrame(const launchOptions& options, gpu* GPU, uint64_t frame)
+{
+    std::string name = options.dumpDir + "/" + (options.dumpVRAM ? "vram_" : "frame_") + std::to_string(frame);
+    if (options.dumpVRAM && options.dumpRaw)
+    {
+        // Raw VRAM dumps keep the original 16 bit pixels so they can be loaded back in
+        frameDump::writeRaw(name + ".raw", GPU->getVRAM(), 1024 * 1024);
+        return;
+    }
+
+    std::vector<uint8_t> rgb;
+    uint32_t width = 1024;
+    uint32_t height = 512;
+    if (options.dumpVRAM)
+    {
+        frameDump::vramToRGB(GPU->getVRAM(), rgb);
+    }
+    else
+    {
+        DisplayArea area = GPU->getDisplayArea();
+        frameDump::displayToRGB(GPU->getVRAM(), area, rgb);
+        width = area.width;
+        height = area.height;
+    }
+
+    if (options.dumpRaw)
+    {
+        frameDump::writeRaw(name + ".raw", rgb.data(), rgb.size());
+    }
+    else
+    {
+        frameDump::writePNG(name + ".png", width, height, rgb);
+    }
+}
+
+// Plays back a GPU capture on its own, without a BIOS or CPU
+int runReplay(launchOptions options)
+{
+    if (options.renderer != rendererType::Null && !options.headless)
+    {
+        initSDL();
+    }
+
+    interruptController* InterruptController = new interruptController();
+    gpu* GPU = new gpu(window, InterruptController, options.renderer);
+
+    int exitCode = 0;
+    try
+    {
+        gpuReplay replay(options.replayPath, GPU);
+        gpuReplay::report(replay.run(), options.hashVRAM);
+    }
+    catch (int e)
+    {
+        exitCode = 1;
+    }
+
+    delete(GPU);
+    delete(InterruptController);
+    if (window != NULL)
+    {
+        SDL_DestroyWindow(window);
+    }
+    SDL_Quit();
+    return exitCode;
+}
+
+// Checks every GTE command against recorded results and times them, without a BIOS
+int runGTEBench()
+{
+    int exitCode = 0;
+    try
+    {
+        exitCode = gteBench::report(gteBench::run(1000000)) ? 0 : 1;
+    }
+    catch (int e)
+    {
+        exitCode = 1;
+    }
+    return exitCode;
+}
+
+// Checks the batched SPU reverb against the tick at a time version and times both, without a BIOS
+int runReverbBench()
+{
+    int exitCode = 0;
+    try
+    {
+        exitCode = reverbBench::report(reverbBench::run(1)) ? 0 : 1;
+    }
+    catch (int e)
+    {
+        exitCode = 1;
+    }
+    return exitCode;
+}
+
+// Finds the game's EXE through SYSTEM.CNF so the BIOS can go straight to it, skipping the logo and shell
+EXEInfo loadDiscEXE(discImage* disc)
+{
+    iso9660 filesystem(disc);
+    uint32_t stack;
+    std::string bootPath = filesystem.getBootPath(stack);
+    const isoFile* bootFile = filesystem.find(bootPath);
+    if (bootFile == nullptr || bootFile->directory)
+    {
+        logging::fatal("Boot EXE " + bootPath + " isn't on the disc", logging::logSource::qPS);
+    }
+    return exeLoader::fromData(filesystem.readFile(bootFile), bootPath, stack);
+}
+
+// Arg 1 = BIOS path, Arg 2 = Game Path
+// Options:
+//   --renderer <gl|software|null>
+//   --capture <file>              record all GPU commands to a file
+//   --capture-snapshots <frames>  how often to store VRAM in the capture (0 = only at the start)
+//   --replay <file>               play back a GPU capture as fast as possible, then exit
+//   --hash                        print a hash of VRAM after a replay
+//   --headless                    run without a window (uses the software renderer unless null is asked for)
+//   --frames <n>                  exit after n frames
+//   --tty-exit <text>             exit once the TTY prints text
+//   --dump-frames <list|all>      frames to save, e.g. "60,120-130"
+//   --dump-dir <dir>              where dumped frames go (default: current directory)
+//   --dump-format <png|raw>       raw is 24 bit RGB, or the untouched 16 bit VRAM with --dump-vram
+//   --dump-vram                   dump all of VRAM instead of just the display area
+//   --record <file.y4m>           write every displayed frame to a Y4M video on a background thread
+//   --record-queue <frames>       how many frames can wait for the writer (default 8)
+//   --record-policy <drop|block>  what to do when the queue is full (default drop)
+//   --disc <file.cue|file.bin|file.iso|file.chd>  insert a disc image
+//   --chd-cache <MiB>             memory for decompressed CHD hunks (default 64)
+//   --cd-speed <1-16|instant>     speed up disc seeks and reads (default 1, real speed)
+//   --fast-boot                   boot the disc's EXE directly instead of going through the BIOS shell
+//   --no-audio                    don't play audio (headless never does)
+//   --audio-wav <file.wav>        write audio to a WAV file instead of playing it
+//   --audio-latency <ms>          how much audio to keep queued for the audio device (default 60)
+//   --gte-bench                   check every GTE command against known good results, time them, then exit
+//   --reverb-bench                check the batched SPU reverb against the reference, time it, then exit
+int main(int argc, char* args[])
+{
+    EXEInfo exeInfo = {};
+    launchOptions options = parseArgs(argc, args);
+    if (!options.replayPath.empty())
+    {
+        return runReplay(options);
+    }
+    if (options.gteBench)
+    {
+        return runGTEBench();
+    }
+    if (options.reverbBench)
+    {
+        return runReverbBench();
+    }
+    if (options.positional.size() < 1)
+    {
+        logging::fatal("need BIOS path", logging::logSource::qPS);
+    }
+    if (options.positional.size() >= 2)
+    {
+        exeInfo = exeLoader::fromFile(options.positional[1]);
+    }
+    //exeInfo.present = false; // uncomment to force BIOS
+
+    if (!options.headless)
+    {
+        initSDL();
+    }
+
+    bios* BIOS = new bios(options.positional[0]);
+    interruptController* InterruptController = new interruptController();
+    joypad* Joypad = new joypad(InterruptController);
+    cdrom* CDROM = new cdrom(InterruptController);
+    CDROM->setSpeedUp(options.cdSpeedUp);
+    spu* SPU = new spu(InterruptController, CDROM);
+    discImage* Disc = nullptr;
+    if (!options.discPath.empty())
+    {
+        Disc = discImage::open(options.discPath, options.chdCacheMiB);
+        if (options.fastBoot && !exeInfo.present)
+        {
+            exeInfo = loadDiscEXE(Disc);
+        }
+        CDROM->insertDisc(Disc);
+    }
+    gpu* GPU = new gpu(window, InterruptController, options.renderer);
+    if (!options.capturePath.empty())
+    {
+        GPU->startCapture(options.capturePath, options.captureSnapshotInterval);
+    }
+    if (!options.recordPath.empty())
+    {
+        GPU->startVideoDump(options.recordPath, options.recordQueueLength, options.recordPolicy);
+    }
+    memory* Memory = new memory(BIOS, GPU, InterruptController, CDROM, Joypad, SPU);
+    if (!options.ttyExitPattern.empty())
+    {
+        Memory->setTTYExitPattern(options.ttyExitPattern);
+    }
 
     cpu* CPU = new cpu(Memory, exeInfo);
     InterruptController->giveCpuRef(CPU);
+    CDROM->giveCpuRef(CPU);
+    SPU->giveCpuRef(CPU);
+    audioOutput* Audio = new audioOutput(options.audioSink, options.audioWavPath, options.audioLatencyMs);
+    stereoSample samples[1024];
 
     int exitCode = 0;
 
@@ -93,9 +443,10 @@ int main(int argc, char* args[])
     {
         SDL_Event event;
         bool running = true;
+        uint64_t frame = 0;
         while (running)
         {
-            while (SDL_PollEvent(&event))
+            while (!options.headless && SDL_PollEvent(&event))
             {
                 switch (event.type)
                 {
@@ -113,15 +464,51 @@ int main(int argc, char* args[])
                 }
             }
 
-            // This loop is 60FPS, and the PS CPU runs at approx 30 MIPS
-            // So it should run 0.5 Million Instructions per frame (500,000)
-            for (uint32_t i = 0; i < 500000; i++)
+            // This loop is 60FPS, and the PS CPU runs at approx 30 MHz
+            // So it should run 0.5 Million cycles per frame (500,000)
+            // Budgeting by cycles rather than instructions means GTE stalls use up frame time like they should
+            uint64_t frameEnd = CPU->getCycles() + 500000;
+            while (CPU->getCycles() < frameEnd)
             {
                 CPU->step();
+                if (CPU->getCycles() >= CDROM->getNextEventCycle())
+                {
+                    CDROM->runEvents(CPU->getCycles());
+                }
+                if (CPU->getCycles() >= SPU->getNextEventCycle())
+                {
+                    SPU->catchUp();
+                }
+            }
+
+            SPU->catchUp();
+            uint32_t sampleCount;
+            while ((sampleCount = SPU->readSamples(samples, 1024)) > 0)
+            {
+                Audio->pushSamples(samples, sampleCount);
             }
 
             GPU->display();
-            //SDL_Delay(13);
+            if (shouldDumpFrame(options, frame))
+            {
+                dumpFrame(options, GPU, frame);
+            }
+            frame++;
+            if (options.frameLimit != 0 && frame >= options.frameLimit)
+            {
+                logging::info("Reached frame limit", logging::logSource::qPS);
+                running = false;
+            }
+            if (Memory->ttyExitPatternSeen())
+            {
+                logging::info("TTY exit pattern seen after " + std::to_string(frame) + " frames", logging::logSource::qPS);
+                running = false;
+            }
+            // With an audio device, run only as fast as it plays. Without one there's nothing to pace against, so run flat out.
+            while (running && Audio->shouldWait())
+            {
+                SDL_Delay(1);
+            }
         }
     }
     catch (int e)
@@ -130,13 +517,19 @@ int main(int argc, char* args[])
         exitCode = 1;
     }
 
+    delete(Audio);
     delete(BIOS);
     delete(Joypad);
+    delete(SPU);
     delete(CDROM);
+    delete(Disc);
     delete(GPU);
     delete(Memory);
     delete(CPU);
-    SDL_DestroyWindow(window);
+    if (window != NULL)
+    {
+        SDL_DestroyWindow(window);
+    }
     SDL_Quit();
     return exitCode;
 }
\ No newline at end of file
@@ -6,4 +6,40 @@
 #include "gpu.hpp"
 #include "interrupt.hpp"
 #include "cdrom.hpp"
-#include "joypad.hpp"
\ No newline at end of file
+#include "disc.hpp"
+#include "iso9660.hpp"
+#include "joypad.hpp"
+#include "frameDump.hpp"
+#include "videoDump.hpp"
+#include "audioOutput.hpp"
+#include "gteBench.hpp"
+#include "reverbBench.hpp"
+
+struct launchOptions
+{
+    std::vector<char*> positional;
+    rendererType renderer;
+    std::string capturePath;
+    uint32_t captureSnapshotInterval;
+    std::string replayPath;
+    bool hashVRAM;
+    bool headless;
+    uint64_t frameLimit;                                     // 0 = run until closed
+    std::string ttyExitPattern;
+    std::vector<std::pair<uint64_t, uint64_t>> dumpFrames;  // inclusive ranges
+    std::string dumpDir;
+    bool dumpRaw;
+    bool dumpVRAM;
+    std::string recordPath;
+    uint32_t recordQueueLength;
+    videoDumpPolicy recordPolicy;
+    bool gteBench;
+    bool reverbBench;
+    std::string discPath;
+    uint32_t chdCacheMiB;
+    uint32_t cdSpeedUp;                                      // 0 = instant
+    bool fastBoot;
+    audioSinkType audioSink;
+    std::string audioWavPath;
+    uint32_t audioLatencyMs;
+};
\ No newline at end of file
@@ -2,8 +2,8 @@
 
 ram::ram()
 {
-    ramData = new uint8_t[2 * 1024 * 1024];
-    std::memset(ramData, 0, 2 * 1024 * 1024);
+    ramData = new uint8_t[RAM_SIZE];
+    std::memset(ramData, 0, RAM_SIZE);
 }
 
 ram::~ram()
@@ -45,6 +45,32 @@ uint8_t ram::get8(uint32_t addr)
     return ramData[addr];
 }
 
+void ram::writeBlock(uint32_t addr, const uint8_t* src, uint32_t length)
+{
+    while (length > 0)
+    {
+        addr &= RAM_SIZE - 1;
+        uint32_t chunk = std::min(length, RAM_SIZE - addr);
+        std::memcpy(ramData + addr, src, chunk);
+        src += chunk;
+        addr += chunk;
+        length -= chunk;
+    }
+}
+
+void ram::readBlock(uint32_t addr, uint8_t* dst, uint32_t length)
+{
+    while (length > 0)
+    {
+        addr &= RAM_SIZE - 1;
+        uint32_t chunk = std::min(length, RAM_SIZE - addr);
+        std::memcpy(dst, ramData + addr, chunk);
+        dst += chunk;
+        addr += chunk;
+        length -= chunk;
+    }
+}
+
 scratchpad::scratchpad()
 {
     scratchpadData = new uint8_t[1024];
@@ -2,6 +2,8 @@
 #include "helpers.hpp"
 #include "peripheral.hpp"
 
+#define RAM_SIZE (2u * 1024 * 1024)
+
 class ram : public peripheral
 {
 	public:
@@ -13,6 +15,9 @@ class ram : public peripheral
 		uint16_t get16(uint32_t addr);
 		void set8(uint32_t addr, uint8_t value);
 		uint8_t get8(uint32_t addr);
+		// Bulk copies for DMA, the address wraps at the end of RAM
+		void writeBlock(uint32_t addr, const uint8_t* src, uint32_t length);
+		void readBlock(uint32_t addr, uint8_t* dst, uint32_t length);
 	private:
 		uint8_t* ramData = nullptr;
 };
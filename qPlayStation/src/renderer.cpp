@@ -0,0 +1,31 @@
+#include "renderer.hpp"
+#include "glRenderer.hpp"
+#include "softwareRenderer.hpp"
+
+rendererType rendererTypeFromName(std::string name)
+{
+	if (name == "gl" || name == "opengl")
+	{
+		return rendererType::OpenGL;
+	}
+	else if (name == "software" || name == "soft")
+	{
+		return rendererType::Software;
+	}
+	else if (name == "null" || name == "none")
+	{
+		return rendererType::Null;
+	}
+	logging::fatal("Unknown renderer: " + name, logging::logSource::GPU);
+	return rendererType::OpenGL;
+}
+
+renderer* createRenderer(rendererType type, SDL_Window* window, uint8_t* vram)
+{
+	switch (type)
+	{
+		case rendererType::Software: return new softwareRenderer(window, vram);
+		case rendererType::Null: return new nullRenderer();
+		default: return new glRenderer(window, vram);
+	}
+}
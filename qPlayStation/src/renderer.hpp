@@ -0,0 +1,201 @@
+#pragma once
+#include "helpers.hpp"
+#include "spanKernels.hpp"
+
+enum class textureColourDepthValue : uint8_t
+{
+	texDepth4Bit = 0,
+	texDepth8Bit = 1,
+	texDepth15Bit = 2
+};
+
+enum class BlendMode : uint8_t
+{
+	NoTexture = 0,
+	RawTexture = 1,
+	BlendTexture = 2
+};
+
+#pragma pack(push, 1)
+struct Position
+{
+	GLshort x;
+	GLshort y;
+
+	static Position fromGP0(uint32_t value)
+	{
+		return { (GLshort)(value & 0xFFFF), (GLshort)(value >> 16) };
+	}
+};
+
+struct Colour
+{
+	GLubyte r;
+	GLubyte g;
+	GLubyte b;
+
+	static Colour fromGP0(uint32_t value)
+	{
+		return { (GLubyte)(value & 0xFF), (GLubyte)((value >> 8) & 0xFF), (GLubyte)((value >> 16) & 0xFF) };
+	}
+};
+
+struct TexPage
+{
+	GLushort xBase;
+	GLushort yBase;
+
+	static TexPage fromGP0(uint32_t value)
+	{
+		GLushort x = ((value >> 16) & 0xF) * 64;
+		GLushort y = (((value >> 16) >> 4) & 1) * 256;
+		return { x, y };
+	}
+};
+
+struct TexCoord
+{
+	GLubyte x;
+	GLubyte y;
+
+	static TexCoord fromGP0(uint32_t value)
+	{
+		return { value & 0xFF, (value >> 8) & 0xFF };
+	}
+};
+
+struct ClutAttr
+{
+	GLushort x;
+	GLushort y;
+
+	static ClutAttr fromGP0(uint32_t value)
+	{
+		return { ((value >> 16) & 0x3F) * 16, ((value >> 16) >> 6) & 0x1FF };
+	}
+};
+
+struct TextureColourDepth
+{
+	GLubyte depth;
+
+	static TextureColourDepth fromGP0(uint32_t value)
+	{
+		return { ((value >> 16) >> 7) & 0x3 };
+	}
+
+	static TextureColourDepth fromValue(textureColourDepthValue value)
+	{
+		return { (GLubyte)value };
+	}
+};
+
+struct Vertex
+{
+	Position position;
+	Colour colour;
+	TexPage texPage;
+	TexCoord texCoord;
+	ClutAttr clut;
+	TextureColourDepth texDepth;
+	GLubyte blendMode;
+
+	Vertex(Position p, Colour c, TexPage t = { 0, 0 }, TexCoord tc = { 0, 0 }, ClutAttr ca = { 0, 0 }, TextureColourDepth td = { 0 }, GLubyte bm = 0)
+	{
+		position = p;
+		colour = c;
+		texPage = t;
+		texCoord = tc;
+		clut = ca;
+		texDepth = td;
+		blendMode = bm;
+	}
+};
+#pragma pack(pop)
+
+struct RectWidthHeight
+{
+	GLshort width;
+	GLshort height;
+
+	static RectWidthHeight fromGP0(uint32_t value)
+	{
+		return { (GLshort)(value & 0xFFFF), (GLshort)(value >> 16) };
+	}
+};
+
+struct Rectangle
+{
+	Position position;
+	Colour colour;
+	RectWidthHeight widthHeight;
+	TexCoord texCoord;
+	ClutAttr clut;
+	GLubyte blendMode;
+
+	Rectangle(Position p, Colour c, RectWidthHeight wh, TexCoord tc = { 0, 0 }, ClutAttr ca = { 0, 0 }, GLubyte bm = 0)
+	{
+		position = p;
+		colour = c;
+		widthHeight = wh;
+		texCoord = tc;
+		clut = ca;
+		blendMode = bm;
+	}
+};
+
+enum class rendererType
+{
+	OpenGL,
+	Software,
+	Null
+};
+
+struct DrawingArea
+{
+	uint16_t left;
+	uint16_t top;
+	uint16_t right;
+	uint16_t bottom;
+	int16_t xOffset;
+	int16_t yOffset;
+};
+
+struct TextureWindow
+{
+	uint8_t xMask;
+	uint8_t yMask;
+	uint8_t xOffset;
+	uint8_t yOffset;
+};
+
+// Backend that turns the primitives decoded by the gpu into pixels.
+// The gpu owns VRAM and handles all transfers itself; renderers only draw into it.
+class renderer
+{
+	public:
+		virtual ~renderer() {}
+		virtual void pushTriangle(Vertex v1, Vertex v2, Vertex v3) = 0;
+		virtual void setDrawingArea(DrawingArea area) = 0;
+		virtual void setTextureWindow(TextureWindow window) = 0;
+		// Applies to the triangles pushed after it
+		virtual void setDrawState(DrawState state) = 0;
+		// Flush any queued primitives so they are visible in VRAM
+		virtual void draw() = 0;
+		virtual void display() = 0;
+};
+
+// Parses everything but draws nothing, used to measure the cost of the rest of the system
+class nullRenderer : public renderer
+{
+	public:
+		void pushTriangle(Vertex v1, Vertex v2, Vertex v3) {}
+		void setDrawingArea(DrawingArea area) {}
+		void setTextureWindow(TextureWindow window) {}
+		void setDrawState(DrawState state) {}
+		void draw() {}
+		void display() {}
+};
+
+rendererType rendererTypeFromName(std::string name);
+renderer* createRenderer(rendererType type, SDL_Window* window, uint8_t* vram);
@@ -0,0 +1,145 @@
+#include "reverbBench.hpp"
+#include "cdAudio.hpp"
+#include <chrono>
+#include <random>
+
+#define REVERB_BENCH_REFERENCE 0
+#define REVERB_BENCH_PROCESS 1
+#define REVERB_BENCH_OFF 2
+
+struct reverbBenchPreset
+{
+	const char* name;
+	uint16_t mBASE;
+	uint16_t config[32]; // registers 0x1F801DC0 - 0x1F801DFF
+};
+
+static const reverbBenchPreset presets[] = {
+	// A small room, only using the first two combs
+	{ "room", 0xFB28, {
+		0x007D, 0x005B, 0x6D80, 0x54B8, 0xBED0, 0x0000, 0x0000, 0xBA80, 0x5800, 0x5300,
+		0x04D6, 0x0333, 0x03F0, 0x0227, 0x0374, 0x01EF, 0x0334, 0x01B5,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x01B4, 0x0136, 0x00B8, 0x005C, 0x8000, 0x8000 } },
+	// A larger space using every reflection and comb
+	{ "hall", 0xF6F8, {
+		0x00E3, 0x00A9, 0x6F60, 0x4FA8, 0xBCE0, 0x4510, 0xBEF0, 0xB4C0, 0x5280, 0x4EC0,
+		0x0904, 0x076B, 0x0824, 0x065F, 0x07A2, 0x0616, 0x076C, 0x05ED,
+		0x05EC, 0x042E, 0x050F, 0x0305, 0x0462, 0x02B7, 0x042F, 0x0265,
+		0x0264, 0x01B2, 0x0100, 0x0080, 0x8000, 0x8000 } },
+	// A long echo, whose all pass filters are only a tick long so it can't be batched
+	{ "echo", 0xCFF8, {
+		0x0001, 0x0001, 0x7FFF, 0x7FFF, 0x0000, 0x0000, 0x0000, 0x8100, 0x0000, 0x0000,
+		0x1FFF, 0x0FFF, 0x1005, 0x0005, 0x0000, 0x0000, 0x1005, 0x0005,
+		0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+		0x1004, 0x1002, 0x0004, 0x0002, 0x8000, 0x8000 } }
+};
+
+static uint64_t fnv(uint64_t hash, const uint8_t* data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001B3;
+	}
+	return hash;
+}
+
+double reverbBench::timeRun(const uint16_t* config, uint16_t mBASE, const std::vector<int16_t>& input, int mode, uint64_t& hash)
+{
+	std::vector<uint8_t> soundRAM(512 * 1024);
+	spuReverb* reverb = new spuReverb(soundRAM.data());
+	reverb->setBase(mBASE);
+	uint32_t batches = (uint32_t)(input.size() / (REVERB_BATCH_SAMPLES * 2));
+	std::vector<int16_t> output(input.size());
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t batch = 0; batch < batches; batch++)
+	{
+		const int16_t* in = &input[batch * REVERB_BATCH_SAMPLES * 2];
+		int16_t* out = &output[batch * REVERB_BATCH_SAMPLES * 2];
+		if (mode == REVERB_BENCH_REFERENCE)
+		{
+			reverb->processReference(in, &in[REVERB_BATCH_SAMPLES], out, &out[REVERB_BATCH_SAMPLES], config);
+		}
+		else
+		{
+			reverb->process(in, &in[REVERB_BATCH_SAMPLES], out, &out[REVERB_BATCH_SAMPLES], config, mode == REVERB_BENCH_PROCESS);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	hash = fnv(0xCBF29CE484222325, (const uint8_t*)output.data(), output.size() * sizeof(int16_t));
+	hash = fnv(hash, soundRAM.data(), soundRAM.size());
+	delete(reverb);
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+std::vector<reverbBenchResult> reverbBench::run(uint32_t seconds)
+{
+	// Half a second of noise bursts then silence, so the tail is all feedback. mt19937's output is fully defined, so this is the same everywhere.
+	uint32_t batches = (seconds * CD_AUDIO_RATE) / REVERB_BATCH_SAMPLES;
+	std::vector<int16_t> input(batches * REVERB_BATCH_SAMPLES * 2);
+	std::mt19937 rng(46);
+	for (uint32_t batch = 0; batch < batches; batch++)
+	{
+		bool loud = ((batch * REVERB_BATCH_SAMPLES) % CD_AUDIO_RATE) < (CD_AUDIO_RATE / 2) && (batch % 64) < 8;
+		for (uint32_t i = 0; i < REVERB_BATCH_SAMPLES * 2; i++)
+		{
+			input[(batch * REVERB_BATCH_SAMPLES * 2) + i] = loud ? (int16_t)((rng() % 0x8000) - 0x4000) : 0;
+		}
+	}
+
+	std::vector<reverbBenchResult> results;
+	for (const reverbBenchPreset& preset : presets)
+	{
+		reverbBenchResult result;
+		result.name = preset.name;
+		std::vector<uint8_t> scratch(512 * 1024);
+		spuReverb probe(scratch.data());
+		probe.setBase(preset.mBASE);
+		int16_t silence[REVERB_BATCH_SAMPLES] = {};
+		int16_t discard[REVERB_BATCH_SAMPLES];
+		probe.process(silence, silence, discard, discard, preset.config, true);
+		result.batched = probe.isBatched();
+
+		uint64_t referenceHash;
+		uint64_t processHash;
+		uint64_t offHash;
+		result.msReference = timeRun(preset.config, preset.mBASE, input, REVERB_BENCH_REFERENCE, referenceHash) / seconds;
+		result.msProcess = timeRun(preset.config, preset.mBASE, input, REVERB_BENCH_PROCESS, processHash) / seconds;
+		result.msOff = timeRun(preset.config, preset.mBASE, input, REVERB_BENCH_OFF, offHash) / seconds;
+		result.matchesReference = referenceHash == processHash;
+		results.push_back(result);
+	}
+	return results;
+}
+
+bool reverbBench::report(const std::vector<reverbBenchResult>& results)
+{
+	bool allMatch = true;
+	for (const reverbBenchResult& result : results)
+	{
+		std::ostringstream line;
+		line << std::left;
+		line.width(6);
+		line << result.name << (result.batched ? " batched " : " per tick ");
+		line << (result.matchesReference ? " ok   " : " FAIL ");
+		line.precision(3);
+		line << std::fixed << "reference " << result.msReference << " ms, pipeline " << result.msProcess << " ms, off " << result.msOff << " ms per second of audio";
+		if (result.matchesReference)
+		{
+			logging::important(line.str(), logging::logSource::SPU);
+		}
+		else
+		{
+			logging::error(line.str(), logging::logSource::SPU);
+			allMatch = false;
+		}
+	}
+	if (allMatch)
+	{
+		logging::important("Reverb pipeline matches the reference for every preset", logging::logSource::SPU);
+	}
+	return allMatch;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "helpers.hpp"
+#include "spuReverb.hpp"
+
+struct reverbBenchResult
+{
+	std::string name;
+	bool batched;			// whether the preset's offsets let it take the batched path
+	bool matchesReference;	// output and sound RAM identical to the scalar reference
+	double msReference;		// per second of audio
+	double msProcess;
+	double msOff;
+};
+
+// Runs a second of noise through the reverb with a few presets, checks the batched pipeline gives exactly the same output
+// and sound RAM as the tick at a time reference, and times both along with reverb switched off.
+class reverbBench
+{
+	public:
+		static std::vector<reverbBenchResult> run(uint32_t seconds);
+		// Returns true if everything matched
+		static bool report(const std::vector<reverbBenchResult>& results);
+	private:
+		//private constructor means no instances of this object can be created
+		reverbBench() {}
+		// Returns how long the batches took in ms, and hashes the output and sound RAM
+		static double timeRun(const uint16_t* config, uint16_t mBASE, const std::vector<int16_t>& input, int mode, uint64_t& hash);
+};
@@ -0,0 +1,265 @@
+#include "softwareRenderer.hpp"
+#include <algorithm>
+
+softwareRenderer::softwareRenderer(SDL_Window* window, uint8_t* v)
+{
+	vram = (uint16_t*)v;
+	drawingArea = { 0, 0, 0, 0, 0, 0 };
+	textureWindow = { 0, 0, 0, 0 };
+	drawState = { false, 0, false, false, false };
+	sdlRenderer = NULL;
+	screenTexture = NULL;
+
+	if (window != NULL)
+	{
+		sdlRenderer = SDL_CreateRenderer(window, -1, 0);
+		if (sdlRenderer == NULL)
+		{
+			logging::fatal("Renderer could not be created! SDL_Error: " + std::string(SDL_GetError()), logging::logSource::GPU);
+		}
+		// VRAM is stored as 1555 with red in the low bits, which is what ABGR1555 means to SDL
+		screenTexture = SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_ABGR1555, SDL_TEXTUREACCESS_STREAMING, 1024, 512);
+	}
+}
+
+softwareRenderer::~softwareRenderer()
+{
+	if (sdlRenderer != NULL)
+	{
+		SDL_DestroyTexture(screenTexture);
+		SDL_DestroyRenderer(sdlRenderer);
+	}
+}
+
+void softwareRenderer::setDrawingArea(DrawingArea area)
+{
+	drawingArea = area;
+}
+
+void softwareRenderer::setTextureWindow(TextureWindow window)
+{
+	textureWindow = window;
+}
+
+void softwareRenderer::setDrawState(DrawState state)
+{
+	drawState = state;
+}
+
+void softwareRenderer::draw()
+{
+	// Primitives are rasterised as soon as they're pushed, so there's nothing to flush
+}
+
+void softwareRenderer::display()
+{
+	if (sdlRenderer == NULL) { return; }
+	SDL_UpdateTexture(screenTexture, NULL, vram, 2048);
+	SDL_RenderCopy(sdlRenderer, screenTexture, NULL, NULL);
+	SDL_RenderPresent(sdlRenderer);
+}
+
+uint16_t softwareRenderer::vramGet(uint32_t x, uint32_t y)
+{
+	return vram[((y & 0x1FF) * 1024) + (x & 0x3FF)];
+}
+
+uint16_t softwareRenderer::sampleTexture(const Vertex& v, uint32_t u, uint32_t t)
+{
+	u &= 0xFF;
+	t &= 0xFF;
+	u = (u & ~(textureWindow.xMask << 3)) | ((textureWindow.xOffset & textureWindow.xMask) << 3);
+	t = (t & ~(textureWindow.yMask << 3)) | ((textureWindow.yOffset & textureWindow.yMask) << 3);
+
+	switch ((textureColourDepthValue)v.texDepth.depth)
+	{
+		case textureColourDepthValue::texDepth4Bit:
+		{
+			uint16_t indices = vramGet(v.texPage.xBase + (u >> 2), v.texPage.yBase + t);
+			uint16_t index = (indices >> ((u & 3) * 4)) & 0xF;
+			return vramGet(v.clut.x + index, v.clut.y);
+		}
+		case textureColourDepthValue::texDepth8Bit:
+		{
+			uint16_t indices = vramGet(v.texPage.xBase + (u >> 1), v.texPage.yBase + t);
+			uint16_t index = (indices >> ((u & 1) * 8)) & 0xFF;
+			return vramGet(v.clut.x + index, v.clut.y);
+		}
+		default: return vramGet(v.texPage.xBase + u, v.texPage.yBase + t);
+	}
+}
+
+AttribPlane softwareRenderer::makePlane(int32_t a0, int32_t a1, int32_t a2, int32_t dx1, int32_t dy1, int32_t dx2, int32_t dy2, int64_t area)
+{
+	AttribPlane p;
+	p.base = (((int64_t)a0) << 16) + 0x8000; // + 0.5 so the shift at the end rounds
+	p.dx = ((((int64_t)(a1 - a0) * dy2) - ((int64_t)(a2 - a0) * dy1)) << 16) / area;
+	p.dy = ((((int64_t)(a2 - a0) * dx1) - ((int64_t)(a1 - a0) * dx2)) << 16) / area;
+	return p;
+}
+
+static int64_t floorDiv(int64_t n, int64_t d)
+{
+	return (n >= 0) ? (n / d) : -((-n + d - 1) / d);
+}
+
+static uint8_t clampColour(int64_t fixed)
+{
+	int64_t value = fixed >> 16;
+	if (value < 0) { return 0; }
+	if (value > 0xFF) { return 0xFF; }
+	return (uint8_t)value;
+}
+
+void softwareRenderer::pushTriangle(Vertex v1, Vertex v2, Vertex v3)
+{
+	const Vertex* v[3] = { &v1, &v2, &v3 };
+	int32_t x[3];
+	int32_t y[3];
+	for (int i = 0; i < 3; i++)
+	{
+		x[i] = v[i]->position.x;
+		y[i] = v[i]->position.y;
+	}
+
+	int64_t area = ((int64_t)(x[1] - x[0]) * (y[2] - y[0])) - ((int64_t)(x[2] - x[0]) * (y[1] - y[0]));
+	if (area == 0) { return; }
+	if (area < 0)
+	{
+		// Make the winding consistent so "inside" is always the positive side of every edge
+		helpers::swap(&v[1], &v[2]);
+		helpers::swap(&x[1], &x[2]);
+		helpers::swap(&y[1], &y[2]);
+		area = -area;
+	}
+
+	// Edge functions: E(x, y) = a*x + b*y + c, which is >= 0 inside the triangle.
+	// Pixels exactly on right or bottom edges are not drawn, like the real GPU.
+	int64_t edgeA[3];
+	int64_t edgeB[3];
+	int64_t edgeC[3];
+	for (int i = 0; i < 3; i++)
+	{
+		int j = (i + 1) % 3;
+		edgeA[i] = y[i] - y[j];
+		edgeB[i] = x[j] - x[i];
+		edgeC[i] = -(edgeB[i] * y[i]) - (edgeA[i] * x[i]);
+		bool topLeft = (edgeA[i] > 0) || (edgeA[i] == 0 && edgeB[i] > 0);
+		if (!topLeft)
+		{
+			edgeC[i] -= 1;
+		}
+	}
+
+	int32_t dx1 = x[1] - x[0];
+	int32_t dy1 = y[1] - y[0];
+	int32_t dx2 = x[2] - x[0];
+	int32_t dy2 = y[2] - y[0];
+	AttribPlane planes[5] = {
+		makePlane(v[0]->colour.r, v[1]->colour.r, v[2]->colour.r, dx1, dy1, dx2, dy2, area),
+		makePlane(v[0]->colour.g, v[1]->colour.g, v[2]->colour.g, dx1, dy1, dx2, dy2, area),
+		makePlane(v[0]->colour.b, v[1]->colour.b, v[2]->colour.b, dx1, dy1, dx2, dy2, area),
+		makePlane(v[0]->texCoord.x, v[1]->texCoord.x, v[2]->texCoord.x, dx1, dy1, dx2, dy2, area),
+		makePlane(v[0]->texCoord.y, v[1]->texCoord.y, v[2]->texCoord.y, dx1, dy1, dx2, dy2, area)
+	};
+
+	int32_t minY = std::max(std::min({ y[0], y[1], y[2] }), (int32_t)drawingArea.top);
+	int32_t maxY = std::min(std::max({ y[0], y[1], y[2] }), (int32_t)drawingArea.bottom);
+	int32_t minX = std::max(std::min({ x[0], x[1], x[2] }), (int32_t)drawingArea.left);
+	int32_t maxX = std::min(std::max({ x[0], x[1], x[2] }), (int32_t)drawingArea.right);
+	minY = std::max(minY, 0);
+	maxY = std::min(maxY, 511);
+	minX = std::max(minX, 0);
+	maxX = std::min(maxX, 1023);
+
+	for (int32_t row = minY; row <= maxY; row++)
+	{
+		int64_t spanStart = minX;
+		int64_t spanEnd = maxX;
+		for (int i = 0; i < 3; i++)
+		{
+			int64_t k = (edgeB[i] * row) + edgeC[i];
+			if (edgeA[i] > 0)
+			{
+				spanStart = std::max(spanStart, -floorDiv(k, edgeA[i]));
+			}
+			else if (edgeA[i] < 0)
+			{
+				spanEnd = std::min(spanEnd, floorDiv(k, -edgeA[i]));
+			}
+			else if (k < 0)
+			{
+				spanEnd = -1;
+			}
+		}
+		if (spanStart <= spanEnd)
+		{
+			drawSpan(*v[0], row, (int32_t)spanStart, (int32_t)spanEnd, (int32_t)spanStart - x[0], row - y[0], planes);
+		}
+	}
+}
+
+void softwareRenderer::drawSpan(const Vertex& v, int32_t y, int32_t xStart, int32_t xEnd, int32_t relX, int32_t relY, const AttribPlane* planes)
+{
+	int64_t values[5];
+	for (int i = 0; i < 5; i++)
+	{
+		values[i] = planes[i].base + (planes[i].dx * relX) + (planes[i].dy * relY);
+	}
+
+	uint32_t count = (xEnd - xStart) + 1;
+	bool textured = v.blendMode != (GLubyte)BlendMode::NoTexture;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint8_t r = clampColour(values[0]);
+		uint8_t g = clampColour(values[1]);
+		uint8_t b = clampColour(values[2]);
+		uint8_t u = clampColour(values[3]);
+		uint8_t t = clampColour(values[4]);
+		for (int p = 0; p < 5; p++)
+		{
+			values[p] += planes[p].dx;
+		}
+
+		spanHigh[i] = 0;
+		spanDrawn[i] = 0xFFFF;
+		if (!textured)
+		{
+			spanR[i] = r;
+			spanG[i] = g;
+			spanB[i] = b;
+			continue;
+		}
+
+		uint16_t texel = sampleTexture(v, u, t);
+		if (texel == 0)
+		{
+			// fully transparent
+			spanDrawn[i] = 0;
+			spanR[i] = spanG[i] = spanB[i] = 0;
+			continue;
+		}
+
+		spanHigh[i] = texel & 0x8000;
+		uint32_t tr = texel & 0x1F;
+		uint32_t tg = (texel >> 5) & 0x1F;
+		uint32_t tb = (texel >> 10) & 0x1F;
+		if (v.blendMode == (GLubyte)BlendMode::BlendTexture)
+		{
+			// Vertex colour of 0x80 leaves the texel unchanged
+			spanR[i] = (uint8_t)std::min((tr * r) >> 4, 0xFFu);
+			spanG[i] = (uint8_t)std::min((tg * g) >> 4, 0xFFu);
+			spanB[i] = (uint8_t)std::min((tb * b) >> 4, 0xFFu);
+		}
+		else
+		{
+			spanR[i] = tr << 3;
+			spanG[i] = tg << 3;
+			spanB[i] = tb << 3;
+		}
+	}
+
+	spanKernels::quantise(spanR, spanG, spanB, spanHigh, spanPixels, count, xStart, y, drawState.dither);
+	// Untextured primitives are semi transparent everywhere, textured ones only where the texel has bit 15 set
+	spanKernels::blendAndStore(spanPixels, spanDrawn, &vram[(y * 1024) + xStart], count, drawState, !textured);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "helpers.hpp"
+#include "renderer.hpp"
+#include "spanKernels.hpp"
+
+// Plane equation for one vertex attribute, in 16.16 fixed point
+struct AttribPlane
+{
+	int64_t base; // value at the first vertex
+	int64_t dx;
+	int64_t dy;
+};
+
+class softwareRenderer : public renderer
+{
+	public:
+		softwareRenderer(SDL_Window* window, uint8_t* v);
+		~softwareRenderer();
+		void pushTriangle(Vertex v1, Vertex v2, Vertex v3);
+		void setDrawingArea(DrawingArea area);
+		void setTextureWindow(TextureWindow window);
+		void setDrawState(DrawState state);
+		void draw();
+		void display();
+	private:
+		uint16_t* vram;
+		DrawingArea drawingArea;
+		TextureWindow textureWindow;
+		DrawState drawState;
+
+		// Scratch space for one span, filled per pixel and then handed to spanKernels
+		uint8_t spanR[1024];
+		uint8_t spanG[1024];
+		uint8_t spanB[1024];
+		uint16_t spanHigh[1024];
+		uint16_t spanDrawn[1024];
+		uint16_t spanPixels[1024];
+
+		SDL_Renderer* sdlRenderer;
+		SDL_Texture* screenTexture;
+
+		uint16_t vramGet(uint32_t x, uint32_t y);
+		uint16_t sampleTexture(const Vertex& v, uint32_t u, uint32_t t);
+		AttribPlane makePlane(int32_t a0, int32_t a1, int32_t a2, int32_t dx1, int32_t dy1, int32_t dx2, int32_t dy2, int64_t area);
+		void drawSpan(const Vertex& v, int32_t y, int32_t xStart, int32_t xEnd, int32_t relX, int32_t relY, const AttribPlane* planes);
+};
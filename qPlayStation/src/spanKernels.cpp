@@ -0,0 +1,207 @@
+#include "spanKernels.hpp"
+
+#if !defined(SPAN_KERNELS_SCALAR)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SPAN_KERNELS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPAN_KERNELS_SSE2
+#endif
+#endif
+
+// 4x4 matrix added to 8 bit colours before they are cut down to 5 bits
+static const int16_t ditherTable[4][4] = {
+	{ -4,  0, -3,  1 },
+	{  2, -2,  3, -1 },
+	{ -3,  1, -4,  0 },
+	{  3, -1,  2, -2 }
+};
+
+static inline uint16_t quantiseChannel(int32_t value, int32_t offset)
+{
+	value += offset;
+	if (value < 0) { value = 0; }
+	if (value > 0xFF) { value = 0xFF; }
+	return (uint16_t)(value >> 3);
+}
+
+static inline uint16_t blendChannel(uint16_t back, uint16_t front, uint8_t equation)
+{
+	int32_t value;
+	switch (equation)
+	{
+		case 0: value = (back + front) >> 1; break;		// B/2 + F/2
+		case 1: value = back + front; break;			// B + F
+		case 2: value = back - front; break;			// B - F
+		default: value = back + (front >> 2); break;	// B + F/4
+	}
+	if (value < 0) { value = 0; }
+	if (value > 0x1F) { value = 0x1F; }
+	return (uint16_t)value;
+}
+
+static inline void blendAndStorePixel(uint16_t src, uint16_t drawn, uint16_t* dest, DrawState state, bool allSemiTransparent)
+{
+	uint16_t back = *dest;
+	if (drawn == 0 || (state.checkMask && (back & 0x8000))) { return; }
+	uint16_t out = src;
+	if (state.semiTransparent && (allSemiTransparent || (src & 0x8000)))
+	{
+		out = (src & 0x8000)
+			| blendChannel(back & 0x1F, src & 0x1F, state.semiTransparency)
+			| (blendChannel((back >> 5) & 0x1F, (src >> 5) & 0x1F, state.semiTransparency) << 5)
+			| (blendChannel((back >> 10) & 0x1F, (src >> 10) & 0x1F, state.semiTransparency) << 10);
+	}
+	*dest = out | (state.setMask ? 0x8000 : 0);
+}
+
+#if defined(SPAN_KERNELS_AVX2) || defined(SPAN_KERNELS_SSE2)
+// Thin wrappers so the kernels below can be written once for both vector widths
+#ifdef SPAN_KERNELS_AVX2
+struct vecOps
+{
+	typedef __m256i vec;
+	static const uint32_t width = 16;
+	static vec load(const uint16_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+	static vec loadBytes(const uint8_t* p) { return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p)); }
+	static void store(uint16_t* p, vec v) { _mm256_storeu_si256((__m256i*)p, v); }
+	static vec set1(int16_t v) { return _mm256_set1_epi16(v); }
+	static vec zero() { return _mm256_setzero_si256(); }
+	static vec and_(vec a, vec b) { return _mm256_and_si256(a, b); }
+	static vec or_(vec a, vec b) { return _mm256_or_si256(a, b); }
+	static vec andnot(vec a, vec b) { return _mm256_andnot_si256(a, b); } // ~a & b
+	static vec add(vec a, vec b) { return _mm256_add_epi16(a, b); }
+	static vec subsU(vec a, vec b) { return _mm256_subs_epu16(a, b); }
+	static vec min(vec a, vec b) { return _mm256_min_epi16(a, b); }
+	static vec max(vec a, vec b) { return _mm256_max_epi16(a, b); }
+	static vec cmpeq(vec a, vec b) { return _mm256_cmpeq_epi16(a, b); }
+	template<int n> static vec srli(vec a) { return _mm256_srli_epi16(a, n); }
+	template<int n> static vec slli(vec a) { return _mm256_slli_epi16(a, n); }
+};
+#else
+struct vecOps
+{
+	typedef __m128i vec;
+	static const uint32_t width = 8;
+	static vec load(const uint16_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+	static vec loadBytes(const uint8_t* p) { return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128()); }
+	static void store(uint16_t* p, vec v) { _mm_storeu_si128((__m128i*)p, v); }
+	static vec set1(int16_t v) { return _mm_set1_epi16(v); }
+	static vec zero() { return _mm_setzero_si128(); }
+	static vec and_(vec a, vec b) { return _mm_and_si128(a, b); }
+	static vec or_(vec a, vec b) { return _mm_or_si128(a, b); }
+	static vec andnot(vec a, vec b) { return _mm_andnot_si128(a, b); } // ~a & b
+	static vec add(vec a, vec b) { return _mm_add_epi16(a, b); }
+	static vec subsU(vec a, vec b) { return _mm_subs_epu16(a, b); }
+	static vec min(vec a, vec b) { return _mm_min_epi16(a, b); }
+	static vec max(vec a, vec b) { return _mm_max_epi16(a, b); }
+	static vec cmpeq(vec a, vec b) { return _mm_cmpeq_epi16(a, b); }
+	template<int n> static vec srli(vec a) { return _mm_srli_epi16(a, n); }
+	template<int n> static vec slli(vec a) { return _mm_slli_epi16(a, n); }
+};
+#endif
+
+typedef vecOps V;
+
+template<int equation>
+static inline V::vec blendChannels(V::vec back, V::vec front)
+{
+	const V::vec max5 = V::set1(0x1F);
+	switch (equation)
+	{
+		case 0: return V::srli<1>(V::add(back, front));
+		case 1: return V::min(V::add(back, front), max5);
+		case 2: return V::subsU(back, front);
+		default: return V::min(V::add(back, V::srli<2>(front)), max5);
+	}
+}
+
+template<int equation>
+static uint32_t blendAndStoreVector(const uint16_t* src, const uint16_t* drawn, uint16_t* dest, uint32_t count, DrawState state, bool allSemiTransparent)
+{
+	const V::vec mask5 = V::set1(0x1F);
+	const V::vec bit15 = V::set1((int16_t)0x8000);
+	const V::vec setMask = state.setMask ? bit15 : V::zero();
+	const V::vec checkMask = state.checkMask ? bit15 : V::zero();
+	const V::vec allSemi = (state.semiTransparent && allSemiTransparent) ? V::set1(-1) : V::zero();
+	const V::vec semiFromTexel = (state.semiTransparent && !allSemiTransparent) ? bit15 : V::zero();
+
+	uint32_t i = 0;
+	for (; i + V::width <= count; i += V::width)
+	{
+		V::vec front = V::load(&src[i]);
+		V::vec back = V::load(&dest[i]);
+
+		V::vec blended = blendChannels<equation>(V::and_(back, mask5), V::and_(front, mask5));
+		blended = V::or_(blended, V::slli<5>(blendChannels<equation>(V::and_(V::srli<5>(back), mask5), V::and_(V::srli<5>(front), mask5))));
+		blended = V::or_(blended, V::slli<10>(blendChannels<equation>(V::and_(V::srli<10>(back), mask5), V::and_(V::srli<10>(front), mask5))));
+
+		// Pick the blended colour where semi transparency applies
+		V::vec semi = V::or_(allSemi, V::cmpeq(V::and_(front, semiFromTexel), bit15));
+		V::vec colour = V::or_(V::and_(semi, blended), V::andnot(semi, V::andnot(bit15, front)));
+		V::vec out = V::or_(colour, V::or_(V::and_(front, bit15), setMask));
+
+		// Keep the old pixel where nothing is drawn or the mask bit protects it
+		V::vec keep = V::or_(V::cmpeq(V::load(&drawn[i]), V::zero()), V::cmpeq(V::and_(back, checkMask), bit15));
+		V::store(&dest[i], V::or_(V::and_(keep, back), V::andnot(keep, out)));
+	}
+	return i;
+}
+
+static uint32_t quantiseVector(const uint8_t* r, const uint8_t* g, const uint8_t* b, const uint16_t* high, uint16_t* out, uint32_t count, int32_t x, int32_t y, bool dither)
+{
+	// The pattern repeats every 4 pixels, and vectors are a multiple of 4 wide,
+	// so the same offsets work for every iteration
+	int16_t pattern[V::width];
+	for (uint32_t i = 0; i < V::width; i++)
+	{
+		pattern[i] = dither ? ditherTable[y & 3][(x + i) & 3] : 0;
+	}
+	const V::vec offset = V::load((const uint16_t*)pattern);
+	const V::vec max8 = V::set1(0xFF);
+	const V::vec zero = V::zero();
+
+	uint32_t i = 0;
+	for (; i + V::width <= count; i += V::width)
+	{
+		V::vec rv = V::srli<3>(V::min(V::max(V::add(V::loadBytes(&r[i]), offset), zero), max8));
+		V::vec gv = V::srli<3>(V::min(V::max(V::add(V::loadBytes(&g[i]), offset), zero), max8));
+		V::vec bv = V::srli<3>(V::min(V::max(V::add(V::loadBytes(&b[i]), offset), zero), max8));
+		V::vec pixel = V::or_(V::or_(rv, V::slli<5>(gv)), V::or_(V::slli<10>(bv), V::load(&high[i])));
+		V::store(&out[i], pixel);
+	}
+	return i;
+}
+#endif
+
+void spanKernels::quantise(const uint8_t* r, const uint8_t* g, const uint8_t* b, const uint16_t* high, uint16_t* out, uint32_t count, int32_t x, int32_t y, bool dither)
+{
+	uint32_t i = 0;
+#if defined(SPAN_KERNELS_AVX2) || defined(SPAN_KERNELS_SSE2)
+	i = quantiseVector(r, g, b, high, out, count, x, y, dither);
+#endif
+	for (; i < count; i++)
+	{
+		int32_t offset = dither ? ditherTable[y & 3][(x + i) & 3] : 0;
+		out[i] = quantiseChannel(r[i], offset) | (quantiseChannel(g[i], offset) << 5) | (quantiseChannel(b[i], offset) << 10) | high[i];
+	}
+}
+
+void spanKernels::blendAndStore(const uint16_t* src, const uint16_t* drawn, uint16_t* dest, uint32_t count, DrawState state, bool allSemiTransparent)
+{
+	uint32_t i = 0;
+#if defined(SPAN_KERNELS_AVX2) || defined(SPAN_KERNELS_SSE2)
+	switch (state.semiTransparency & 3)
+	{
+		case 0: i = blendAndStoreVector<0>(src, drawn, dest, count, state, allSemiTransparent); break;
+		case 1: i = blendAndStoreVector<1>(src, drawn, dest, count, state, allSemiTransparent); break;
+		case 2: i = blendAndStoreVector<2>(src, drawn, dest, count, state, allSemiTransparent); break;
+		case 3: i = blendAndStoreVector<3>(src, drawn, dest, count, state, allSemiTransparent); break;
+	}
+#endif
+	for (; i < count; i++)
+	{
+		blendAndStorePixel(src[i], drawn[i], &dest[i], state, allSemiTransparent);
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "helpers.hpp"
+
+// Per primitive settings that aren't part of the vertices
+struct DrawState
+{
+	bool semiTransparent;
+	uint8_t semiTransparency;	// which of the 4 blend equations to use
+	bool dither;
+	bool setMask;				// force bit 15 on for every pixel written
+	bool checkMask;				// don't draw over pixels with bit 15 set
+};
+
+// The per pixel inner loops of the software renderer. They work on a whole span
+// at once so they can be vectorised - AVX2 or SSE2 depending on what the build
+// targets, with a scalar version for everything else (define SPAN_KERNELS_SCALAR to force it).
+class spanKernels
+{
+	public:
+		// Converts 8 bit colour to 15 bit, dithering first if asked. high is OR'd in as bit 15.
+		// x and y are the VRAM position of the first pixel, which picks the dither pattern.
+		static void quantise(const uint8_t* r, const uint8_t* g, const uint8_t* b, const uint16_t* high, uint16_t* out, uint32_t count, int32_t x, int32_t y, bool dither);
+		// Blends src with dest and writes it, handling the mask bit.
+		// drawn is 0xFFFF for pixels to write and 0 for ones to skip (e.g. transparent texels).
+		// If allSemiTransparent is false, only pixels with bit 15 set in src are blended.
+		static void blendAndStore(const uint16_t* src, const uint16_t* drawn, uint16_t* dest, uint32_t count, DrawState state, bool allSemiTransparent);
+	private:
+		//private constructor means no instances of this object can be created
+		spanKernels() {}
+};
@@ -0,0 +1,625 @@
+#include "spu.hpp"
+#include "cpu.hpp" // solve circular dependency
+#include "spuMath.hpp"
+#include <cmath>
+
+// The SPU has all 5 ADPCM filters, XA only uses the first 4
+static const int32_t filterPositive[5] = { 0, 60, 115, 98, 122 };
+static const int32_t filterNegative[5] = { 0, 0, -52, -55, -60 };
+
+// The hardware's interpolation weights. Each output mixes 4 samples, with weights [0xFF - i], [0x1FF - i], [0x100 + i] and [i]
+// for the top 8 bits of the pitch counter's fraction, oldest sample first.
+static const int16_t gaussianTable[512] = {
+	-0x0001, -0x0001, -0x0001, -0x0001, -0x0001, -0x0001, -0x0001, -0x0001,
+	-0x0001, -0x0001, -0x0001, -0x0001, -0x0001, -0x0001, -0x0001, -0x0001,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0001,
+	0x0001, 0x0001, 0x0001, 0x0002, 0x0002, 0x0002, 0x0003, 0x0003,
+	0x0003, 0x0004, 0x0004, 0x0005, 0x0005, 0x0006, 0x0007, 0x0007,
+	0x0008, 0x0009, 0x0009, 0x000A, 0x000B, 0x000C, 0x000D, 0x000E,
+	0x000F, 0x0010, 0x0011, 0x0012, 0x0013, 0x0015, 0x0016, 0x0018,
+	0x0019, 0x001B, 0x001C, 0x001E, 0x0020, 0x0021, 0x0023, 0x0025,
+	0x0027, 0x0029, 0x002C, 0x002E, 0x0030, 0x0033, 0x0035, 0x0038,
+	0x003A, 0x003D, 0x0040, 0x0043, 0x0046, 0x0049, 0x004D, 0x0050,
+	0x0054, 0x0057, 0x005B, 0x005F, 0x0063, 0x0067, 0x006B, 0x006F,
+	0x0074, 0x0078, 0x007D, 0x0082, 0x0087, 0x008C, 0x0091, 0x0096,
+	0x009C, 0x00A1, 0x00A7, 0x00AD, 0x00B3, 0x00BA, 0x00C0, 0x00C7,
+	0x00CD, 0x00D4, 0x00DB, 0x00E3, 0x00EA, 0x00F2, 0x00FA, 0x0101,
+	0x010A, 0x0112, 0x011B, 0x0123, 0x012C, 0x0135, 0x013F, 0x0148,
+	0x0152, 0x015C, 0x0166, 0x0171, 0x017B, 0x0186, 0x0191, 0x019C,
+	0x01A8, 0x01B4, 0x01C0, 0x01CC, 0x01D9, 0x01E5, 0x01F2, 0x0200,
+	0x020D, 0x021B, 0x0229, 0x0237, 0x0246, 0x0255, 0x0264, 0x0273,
+	0x0283, 0x0293, 0x02A3, 0x02B4, 0x02C4, 0x02D6, 0x02E7, 0x02F9,
+	0x030B, 0x031D, 0x0330, 0x0343, 0x0356, 0x036A, 0x037E, 0x0392,
+	0x03A7, 0x03BC, 0x03D1, 0x03E7, 0x03FC, 0x0413, 0x042A, 0x0441,
+	0x0458, 0x0470, 0x0488, 0x04A0, 0x04B9, 0x04D2, 0x04EC, 0x0506,
+	0x0520, 0x053B, 0x0556, 0x0572, 0x058E, 0x05AA, 0x05C7, 0x05E4,
+	0x0601, 0x061F, 0x063E, 0x065C, 0x067C, 0x069B, 0x06BB, 0x06DC,
+	0x06FD, 0x071E, 0x0740, 0x0762, 0x0784, 0x07A7, 0x07CB, 0x07EF,
+	0x0813, 0x0838, 0x085D, 0x0883, 0x08A9, 0x08D0, 0x08F7, 0x091E,
+	0x0946, 0x096F, 0x0998, 0x09C1, 0x09EB, 0x0A16, 0x0A40, 0x0A6C,
+	0x0A98, 0x0AC4, 0x0AF1, 0x0B1E, 0x0B4C, 0x0B7A, 0x0BA9, 0x0BD8,
+	0x0C07, 0x0C38, 0x0C68, 0x0C99, 0x0CCB, 0x0CFD, 0x0D30, 0x0D63,
+	0x0D97, 0x0DCB, 0x0E00, 0x0E35, 0x0E6B, 0x0EA1, 0x0ED7, 0x0F0F,
+	0x0F46, 0x0F7F, 0x0FB7, 0x0FF1, 0x102A, 0x1065, 0x109F, 0x10DB,
+	0x1116, 0x1153, 0x118F, 0x11CD, 0x120B, 0x1249, 0x1288, 0x12C7,
+	0x1307, 0x1347, 0x1388, 0x13C9, 0x140B, 0x144D, 0x1490, 0x14D4,
+	0x1517, 0x155C, 0x15A0, 0x15E6, 0x162C, 0x1672, 0x16B9, 0x1700,
+	0x1747, 0x1790, 0x17D8, 0x1821, 0x186B, 0x18B5, 0x1900, 0x194B,
+	0x1996, 0x19E2, 0x1A2E, 0x1A7B, 0x1AC8, 0x1B16, 0x1B64, 0x1BB3,
+	0x1C02, 0x1C51, 0x1CA1, 0x1CF1, 0x1D42, 0x1D93, 0x1DE5, 0x1E37,
+	0x1E89, 0x1EDC, 0x1F2F, 0x1F82, 0x1FD6, 0x202A, 0x207F, 0x20D4,
+	0x2129, 0x217F, 0x21D5, 0x222C, 0x2282, 0x22DA, 0x2331, 0x2389,
+	0x23E1, 0x2439, 0x2492, 0x24EB, 0x2545, 0x259E, 0x25F8, 0x2653,
+	0x26AD, 0x2708, 0x2763, 0x27BE, 0x281A, 0x2876, 0x28D2, 0x292E,
+	0x298B, 0x29E7, 0x2A44, 0x2AA1, 0x2AFF, 0x2B5C, 0x2BBA, 0x2C18,
+	0x2C76, 0x2CD4, 0x2D33, 0x2D91, 0x2DF0, 0x2E4F, 0x2EAE, 0x2F0D,
+	0x2F6C, 0x2FCC, 0x302B, 0x308B, 0x30EA, 0x314A, 0x31AA, 0x3209,
+	0x3269, 0x32C9, 0x3329, 0x3389, 0x33E9, 0x3449, 0x34A9, 0x3509,
+	0x3569, 0x35C9, 0x3629, 0x3689, 0x36E8, 0x3748, 0x37A8, 0x3807,
+	0x3867, 0x38C6, 0x3926, 0x3985, 0x39E4, 0x3A43, 0x3AA2, 0x3B00,
+	0x3B5F, 0x3BBD, 0x3C1B, 0x3C79, 0x3CD7, 0x3D35, 0x3D92, 0x3DEF,
+	0x3E4C, 0x3EA9, 0x3F05, 0x3F62, 0x3FBD, 0x4019, 0x4074, 0x40D0,
+	0x412A, 0x4185, 0x41DF, 0x4239, 0x4292, 0x42EB, 0x4344, 0x439C,
+	0x43F4, 0x444C, 0x44A3, 0x44FA, 0x4550, 0x45A6, 0x45FC, 0x4651,
+	0x46A6, 0x46FA, 0x474E, 0x47A1, 0x47F4, 0x4846, 0x4898, 0x48E9,
+	0x493A, 0x498A, 0x49D9, 0x4A29, 0x4A77, 0x4AC5, 0x4B13, 0x4B5F,
+	0x4BAC, 0x4BF7, 0x4C42, 0x4C8D, 0x4CD7, 0x4D20, 0x4D68, 0x4DB0,
+	0x4DF7, 0x4E3E, 0x4E84, 0x4EC9, 0x4F0E, 0x4F52, 0x4F95, 0x4FD7,
+	0x5019, 0x505A, 0x509A, 0x50DA, 0x5118, 0x5156, 0x5194, 0x51D0,
+	0x520C, 0x5247, 0x5281, 0x52BA, 0x52F3, 0x532A, 0x5361, 0x5397,
+	0x53CC, 0x5401, 0x5434, 0x5467, 0x5499, 0x54CA, 0x54FA, 0x5529,
+	0x5558, 0x5585, 0x55B2, 0x55DE, 0x5609, 0x5632, 0x565B, 0x5684,
+	0x56AB, 0x56D1, 0x56F6, 0x571B, 0x573E, 0x5761, 0x5782, 0x57A3,
+	0x57C3, 0x57E2, 0x57FF, 0x581C, 0x5838, 0x5853, 0x586D, 0x5886,
+	0x589E, 0x58B5, 0x58CB, 0x58E0, 0x58F4, 0x5907, 0x5919, 0x592A,
+	0x593A, 0x5949, 0x5958, 0x5965, 0x5971, 0x597C, 0x5986, 0x598F,
+	0x5997, 0x599E, 0x59A4, 0x59A9, 0x59AD, 0x59B0, 0x59B2, 0x59B3
+};
+
+// One step of the envelope shared by ADSR and volume sweeps. Shift slows it down, step is how far it moves (negative to decrease).
+static void envelopeStep(int32_t& level, int32_t& wait, bool exponential, bool decrease, uint32_t shift, int32_t step)
+{
+	if (wait > 0)
+	{
+		wait--;
+		return;
+	}
+	int32_t cycles = 1 << std::max(0, (int32_t)shift - 11);
+	int32_t delta = step * (1 << std::max(0, 11 - (int32_t)shift));
+	if (exponential && !decrease && level > 0x6000)
+	{
+		cycles *= 4;
+	}
+	if (exponential && decrease)
+	{
+		delta = (delta * level) >> 15;
+	}
+	level = std::min(std::max(level + delta, 0), SPU_ENVELOPE_MAX);
+	wait = cycles - 1;
+}
+
+spu::spu(interruptController* i, cdrom* c)
+{
+	InterruptController = i;
+	CDROM = c;
+	CPU = nullptr;
+	soundRAM.resize(SPU_RAM_SIZE);
+	memset(registers, 0, sizeof(registers));
+	memset(voices, 0, sizeof(voices));
+	for (int v = 0; v < SPU_VOICES; v++)
+	{
+		voices[v].phase = adsrPhase::Off;
+	}
+	memset(&lanes, 0, sizeof(lanes));
+	mainVolumeLeft = { 0, 0 };
+	mainVolumeRight = { 0, 0 };
+	endFlags = 0;
+	transferAddress = 0;
+	irqFlag = false;
+	noiseTimer = 0;
+	noiseLevel = 1;
+	lastSampleCycle = 0;
+	output.resize(SPU_OUTPUT_BUFFER_FRAMES);
+	outputHead = 0;
+	outputTail = 0;
+	droppedFrames = 0;
+	Reverb = new spuReverb(soundRAM.data());
+	memset(reverbInput, 0, sizeof(reverbInput));
+	memset(reverbOutput, 0, sizeof(reverbOutput));
+	reverbIndex = 0;
+}
+
+spu::~spu()
+{
+	delete(Reverb);
+}
+
+void spu::giveCpuRef(cpu* c)
+{
+	CPU = c;
+}
+
+uint64_t spu::now()
+{
+	return (CPU != nullptr) ? CPU->getCycles() : 0;
+}
+
+void spu::catchUp()
+{
+	uint64_t cycles = now();
+	while (cycles - lastSampleCycle >= SPU_CYCLES_PER_SAMPLE)
+	{
+		generateSample();
+		lastSampleCycle += SPU_CYCLES_PER_SAMPLE;
+	}
+}
+
+uint32_t spu::readSamples(stereoSample* out, uint32_t max)
+{
+	uint32_t count = std::min(max, outputHead - outputTail);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		out[i] = output[(outputTail + i) % SPU_OUTPUT_BUFFER_FRAMES];
+	}
+	outputTail += count;
+	return count;
+}
+
+void spu::pushOutput(int16_t left, int16_t right)
+{
+	if (outputHead - outputTail >= SPU_OUTPUT_BUFFER_FRAMES)
+	{
+		droppedFrames++; // nothing is taking samples, or not fast enough
+		return;
+	}
+	output[outputHead % SPU_OUTPUT_BUFFER_FRAMES] = { left, right };
+	outputHead++;
+}
+
+void spu::generateSample()
+{
+	stepNoise();
+	// Each voice's control flow is different, so that part is done one voice at a time, then the volumes are applied to all of them at once
+	for (uint32_t v = 0; v < SPU_VOICES; v++)
+	{
+		stepVoice(v);
+	}
+	int32_t left;
+	int32_t right;
+	int32_t reverbLeft;
+	int32_t reverbRight;
+	mixVoices(left, right, reverbLeft, reverbRight);
+
+	// Always take the CD sample, so the CD audio buffer keeps moving even when the CD input is off
+	stereoSample cd = CDROM->popAudioSample();
+	if (control() & 0x0001)
+	{
+		int16_t cdLeft = mulQ15(cd.left, (int16_t)registers[0x1B0 / 2]);
+		int16_t cdRight = mulQ15(cd.right, (int16_t)registers[0x1B2 / 2]);
+		left += cdLeft;
+		right += cdRight;
+		if (control() & 0x0004) // CD reverb
+		{
+			reverbLeft += cdLeft;
+			reverbRight += cdRight;
+		}
+	}
+
+	stepSweep(mainVolumeLeft, registers[0x180 / 2]);
+	stepSweep(mainVolumeRight, registers[0x182 / 2]);
+	left = mulQ15(clamp16(left), mainVolumeLeft.level);
+	right = mulQ15(clamp16(right), mainVolumeRight.level);
+
+	reverbInput[0][reverbIndex] = (int16_t)clamp16(reverbLeft);
+	reverbInput[1][reverbIndex] = (int16_t)clamp16(reverbRight);
+	left = clamp16(left + mulQ15(reverbOutput[0][reverbIndex], (int16_t)registers[0x184 / 2]));
+	right = clamp16(right + mulQ15(reverbOutput[1][reverbIndex], (int16_t)registers[0x186 / 2]));
+	reverbIndex++;
+	if (reverbIndex == REVERB_BATCH_SAMPLES)
+	{
+		Reverb->process(reverbInput[0], reverbInput[1], reverbOutput[0], reverbOutput[1], &registers[0x1C0 / 2], control() & 0x0080);
+		reverbIndex = 0;
+	}
+	if ((control() & 0xC000) != 0xC000) // disabled or muted
+	{
+		left = 0;
+		right = 0;
+	}
+	pushOutput((int16_t)left, (int16_t)right);
+}
+
+void spu::mixVoices(int32_t& left, int32_t& right, int32_t& reverbLeft, int32_t& reverbRight)
+{
+#ifdef SPU_SSE2
+	const __m128i ones = _mm_set1_epi16(1);
+	__m128i sumLeft = _mm_setzero_si128();
+	__m128i sumRight = _mm_setzero_si128();
+	__m128i sumReverbLeft = _mm_setzero_si128();
+	__m128i sumReverbRight = _mm_setzero_si128();
+	for (uint32_t v = 0; v < SPU_VOICES; v += 8)
+	{
+		__m128i voiced = mulQ15(_mm_load_si128((const __m128i*)&lanes.sample[v]), _mm_load_si128((const __m128i*)&lanes.envelope[v]));
+		_mm_store_si128((__m128i*)&lanes.output[v], voiced);
+		__m128i voiceLeft = mulQ15(voiced, _mm_load_si128((const __m128i*)&lanes.volumeLeft[v]));
+		__m128i voiceRight = mulQ15(voiced, _mm_load_si128((const __m128i*)&lanes.volumeRight[v]));
+		__m128i mask = _mm_load_si128((const __m128i*)&lanes.reverbMask[v]);
+		// madd against 1 widens pairs of voices to 32 bits so 24 of them can't overflow
+		sumLeft = _mm_add_epi32(sumLeft, _mm_madd_epi16(voiceLeft, ones));
+		sumRight = _mm_add_epi32(sumRight, _mm_madd_epi16(voiceRight, ones));
+		sumReverbLeft = _mm_add_epi32(sumReverbLeft, _mm_madd_epi16(_mm_and_si128(voiceLeft, mask), ones));
+		sumReverbRight = _mm_add_epi32(sumReverbRight, _mm_madd_epi16(_mm_and_si128(voiceRight, mask), ones));
+	}
+	left = horizontalSum(sumLeft);
+	right = horizontalSum(sumRight);
+	reverbLeft = horizontalSum(sumReverbLeft);
+	reverbRight = horizontalSum(sumReverbRight);
+#else
+	left = 0;
+	right = 0;
+	reverbLeft = 0;
+	reverbRight = 0;
+	for (uint32_t v = 0; v < SPU_VOICES; v++)
+	{
+		int16_t voiced = mulQ15(lanes.sample[v], lanes.envelope[v]);
+		lanes.output[v] = voiced;
+		int16_t voiceLeft = mulQ15(voiced, lanes.volumeLeft[v]);
+		int16_t voiceRight = mulQ15(voiced, lanes.volumeRight[v]);
+		left += voiceLeft;
+		right += voiceRight;
+		reverbLeft += voiceLeft & lanes.reverbMask[v];
+		reverbRight += voiceRight & lanes.reverbMask[v];
+	}
+#endif
+}
+
+void spu::stepVoice(uint32_t v)
+{
+	spuVoice& voice = voices[v];
+	if (voice.phase == adsrPhase::Off)
+	{
+		lanes.sample[v] = 0;
+		lanes.envelope[v] = 0;
+		return;
+	}
+	if (!voice.blockDecoded)
+	{
+		decodeBlock(v);
+	}
+
+	// Gaussian interpolation over the 4 samples leading up to the current one, the top 8 bits of the fraction pick the weights
+	const int16_t* s = &voice.decoded[voice.pitchCounter >> 12];
+	uint32_t i = (voice.pitchCounter >> 4) & 0xFF;
+	int32_t interpolated = ((gaussianTable[0xFF - i] * s[0]) >> 15) + ((gaussianTable[0x1FF - i] * s[1]) >> 15)
+		+ ((gaussianTable[0x100 + i] * s[2]) >> 15) + ((gaussianTable[i] * s[3]) >> 15);
+	lanes.sample[v] = (voiceMask(0x194) & (1 << v)) ? (int16_t)noiseLevel : (int16_t)clamp16(interpolated);
+
+	stepEnvelope(v);
+	lanes.envelope[v] = (int16_t)voice.envelopeLevel;
+	stepSweep(voice.volumeLeft, registers[(v * 8) + 0]);
+	stepSweep(voice.volumeRight, registers[(v * 8) + 1]);
+	lanes.volumeLeft[v] = (int16_t)voice.volumeLeft.level;
+	lanes.volumeRight[v] = (int16_t)voice.volumeRight.level;
+
+	uint32_t step = registers[(v * 8) + 2];
+	if (v > 0 && (voiceMask(0x190) & (1 << v)))
+	{
+		// Pitch modulation by the previous voice. This uses its output from the last sample rather than this one, as the voices are mixed together afterwards.
+		int32_t factor = lanes.output[v - 1] + 0x8000;
+		step = (uint32_t)(((int32_t)(int16_t)step * factor) >> 15) & 0xFFFF;
+	}
+	voice.pitchCounter += std::min<uint32_t>(step, 0x4000);
+	if ((voice.pitchCounter >> 12) >= SPU_BLOCK_SAMPLES)
+	{
+		voice.pitchCounter -= SPU_BLOCK_SAMPLES << 12;
+		memcpy(voice.decoded, &voice.decoded[SPU_BLOCK_SAMPLES], 3 * sizeof(int16_t));
+		finishBlock(v);
+	}
+}
+
+void spu::decodeBlock(uint32_t v)
+{
+	spuVoice& voice = voices[v];
+	uint8_t block[16];
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		block[i] = soundRAM[(voice.currentAddress + i) & (SPU_RAM_SIZE - 1)];
+	}
+	checkIRQ(voice.currentAddress, 16);
+
+	uint32_t shift = block[0] & 0xF;
+	if (shift > 12) { shift = 9; }
+	uint32_t filter = std::min((block[0] >> 4) & 0x7, 4);
+	voice.blockFlags = block[1];
+	if (voice.blockFlags & 0x4) // loop start
+	{
+		registers[(v * 8) + 7] = (uint16_t)(voice.currentAddress / 8);
+	}
+	for (uint32_t i = 0; i < SPU_BLOCK_SAMPLES; i++)
+	{
+		uint8_t nibble = (block[2 + (i / 2)] >> ((i & 1) * 4)) & 0xF;
+		int32_t sample = (int16_t)(nibble << 12) >> shift;
+		sample += ((voice.history[0] * filterPositive[filter]) + (voice.history[1] * filterNegative[filter]) + 32) >> 6;
+		sample = clamp16(sample);
+		voice.history[1] = voice.history[0];
+		voice.history[0] = sample;
+		voice.decoded[3 + i] = (int16_t)sample;
+	}
+	voice.blockDecoded = true;
+}
+
+void spu::finishBlock(uint32_t v)
+{
+	spuVoice& voice = voices[v];
+	if (voice.blockFlags & 0x1) // loop end
+	{
+		endFlags |= 1 << v;
+		voice.currentAddress = registers[(v * 8) + 7] * 8;
+		if (!(voice.blockFlags & 0x2)) // not repeating, the voice stops dead
+		{
+			voice.phase = adsrPhase::Off;
+			voice.envelopeLevel = 0;
+		}
+	}
+	else
+	{
+		voice.currentAddress = (voice.currentAddress + 16) & (SPU_RAM_SIZE - 1);
+	}
+	voice.blockDecoded = false;
+}
+
+void spu::stepEnvelope(uint32_t v)
+{
+	spuVoice& voice = voices[v];
+	uint16_t low = registers[(v * 8) + 4];
+	uint16_t high = registers[(v * 8) + 5];
+	switch (voice.phase)
+	{
+		case adsrPhase::Attack:
+		{
+			envelopeStep(voice.envelopeLevel, voice.envelopeWait, low & 0x8000, false, (low >> 10) & 0x1F, 7 - ((low >> 8) & 0x3));
+			if (voice.envelopeLevel >= SPU_ENVELOPE_MAX)
+			{
+				voice.phase = adsrPhase::Decay;
+				voice.envelopeWait = 0;
+			}
+			break;
+		}
+		case adsrPhase::Decay:
+		{
+			envelopeStep(voice.envelopeLevel, voice.envelopeWait, true, true, (low >> 4) & 0xF, -8);
+			int32_t sustainLevel = std::min<int32_t>(((low & 0xF) + 1) * 0x800, SPU_ENVELOPE_MAX);
+			if (voice.envelopeLevel <= sustainLevel)
+			{
+				voice.phase = adsrPhase::Sustain;
+				voice.envelopeWait = 0;
+			}
+			break;
+		}
+		case adsrPhase::Sustain:
+		{
+			bool decrease = high & 0x4000;
+			int32_t step = decrease ? (-8 + ((high >> 6) & 0x3)) : (7 - ((high >> 6) & 0x3));
+			envelopeStep(voice.envelopeLevel, voice.envelopeWait, high & 0x8000, decrease, (high >> 8) & 0x1F, step);
+			break;
+		}
+		case adsrPhase::Release:
+		{
+			envelopeStep(voice.envelopeLevel, voice.envelopeWait, high & 0x0020, true, high & 0x1F, -8);
+			if (voice.envelopeLevel == 0)
+			{
+				voice.phase = adsrPhase::Off;
+			}
+			break;
+		}
+		case adsrPhase::Off: break;
+	}
+}
+
+void spu::stepSweep(spuSweep& sweep, uint16_t reg)
+{
+	if (!(reg & 0x8000)) // fixed volume
+	{
+		sweep.level = (int16_t)(reg << 1);
+		return;
+	}
+	// Sweeps move the magnitude, the phase bit says which way up the result is
+	bool decrease = reg & 0x2000;
+	int32_t step = decrease ? (-8 + (reg & 0x3)) : (7 - (reg & 0x3));
+	int32_t magnitude = std::abs(sweep.level);
+	envelopeStep(magnitude, sweep.wait, reg & 0x4000, decrease, (reg >> 2) & 0x1F, step);
+	sweep.level = (reg & 0x1000) ? -magnitude : magnitude;
+}
+
+void spu::stepNoise()
+{
+	uint32_t shift = (control() >> 10) & 0xF;
+	int32_t step = ((control() >> 8) & 0x3) + 4;
+	uint16_t parity = ((noiseLevel >> 15) ^ (noiseLevel >> 12) ^ (noiseLevel >> 11) ^ (noiseLevel >> 10) ^ 1) & 1;
+	noiseTimer -= step;
+	if (noiseTimer < 0)
+	{
+		noiseLevel = (uint16_t)((noiseLevel << 1) | parity);
+		noiseTimer += 0x20000 >> shift;
+		if (noiseTimer < 0)
+		{
+			noiseTimer += 0x20000 >> shift;
+		}
+	}
+}
+
+void spu::keyOn(uint32_t mask)
+{
+	for (uint32_t v = 0; v < SPU_VOICES; v++)
+	{
+		if (!(mask & (1 << v))) { continue; }
+		spuVoice& voice = voices[v];
+		voice.currentAddress = registers[(v * 8) + 3] * 8;
+		voice.pitchCounter = 0;
+		memset(voice.decoded, 0, sizeof(voice.decoded));
+		voice.history[0] = 0;
+		voice.history[1] = 0;
+		voice.blockDecoded = false;
+		voice.phase = adsrPhase::Attack;
+		voice.envelopeLevel = 0;
+		voice.envelopeWait = 0;
+		endFlags &= ~(1 << v);
+	}
+}
+
+void spu::keyOff(uint32_t mask)
+{
+	for (uint32_t v = 0; v < SPU_VOICES; v++)
+	{
+		if ((mask & (1 << v)) && voices[v].phase != adsrPhase::Off)
+		{
+			voices[v].phase = adsrPhase::Release;
+			voices[v].envelopeWait = 0;
+		}
+	}
+}
+
+void spu::writeTransferFifo(uint16_t value)
+{
+	// Real hardware buffers these until the transfer mode is set, writing them straight away looks the same to the CPU
+	checkIRQ(transferAddress, 2);
+	soundRAM[transferAddress] = value & 0xFF;
+	soundRAM[transferAddress + 1] = value >> 8;
+	transferAddress = (transferAddress + 2) & (SPU_RAM_SIZE - 1);
+}
+
+void spu::dmaWrite(const uint8_t* src, uint32_t length)
+{
+	catchUp(); // voices playing what's overwritten should hear the old data up to now
+	while (length > 0)
+	{
+		uint32_t chunk = std::min(length, SPU_RAM_SIZE - transferAddress);
+		checkIRQ(transferAddress, chunk);
+		memcpy(&soundRAM[transferAddress], src, chunk);
+		src += chunk;
+		length -= chunk;
+		transferAddress = (transferAddress + chunk) & (SPU_RAM_SIZE - 1);
+	}
+}
+
+void spu::dmaRead(uint8_t* dst, uint32_t length)
+{
+	catchUp();
+	while (length > 0)
+	{
+		uint32_t chunk = std::min(length, SPU_RAM_SIZE - transferAddress);
+		checkIRQ(transferAddress, chunk);
+		memcpy(dst, &soundRAM[transferAddress], chunk);
+		dst += chunk;
+		length -= chunk;
+		transferAddress = (transferAddress + chunk) & (SPU_RAM_SIZE - 1);
+	}
+}
+
+void spu::checkIRQ(uint32_t address, uint32_t length)
+{
+	if ((control() & 0x8040) != 0x8040 || irqFlag) { return; }
+	uint32_t irqAddress = registers[0x1A4 / 2] * 8;
+	if (irqAddress >= address && irqAddress < address + length)
+	{
+		irqFlag = true;
+		InterruptController->requestInterrupt(interruptType::SPU);
+	}
+}
+
+void spu::set32(uint32_t addr, uint32_t value)
+{
+	set16(addr, value & 0xFFFF);
+	set16(addr + 2, value >> 16);
+}
+
+uint32_t spu::get32(uint32_t addr)
+{
+	return get16(addr) | (get16(addr + 2) << 16);
+}
+
+void spu::set16(uint32_t addr, uint16_t value)
+{
+	catchUp();
+	registers[addr / 2] = value;
+	if (addr < 0x180) // voice registers
+	{
+		if ((addr & 0xF) == 0xC) // current ADSR volume
+		{
+			voices[addr >> 4].envelopeLevel = std::max<int32_t>((int16_t)value, 0);
+		}
+		return;
+	}
+	switch (addr)
+	{
+		case 0x188: keyOn(value); break; // KON
+		case 0x18A: keyOn(value << 16); break;
+		case 0x18C: keyOff(value); break; // KOFF
+		case 0x18E: keyOff(value << 16); break;
+		case 0x198: case 0x19A: // EON
+		{
+			for (uint32_t v = 0; v < SPU_VOICES; v++)
+			{
+				lanes.reverbMask[v] = (voiceMask(0x198) & (1 << v)) ? -1 : 0;
+			}
+			break;
+		}
+		case 0x1A2: Reverb->setBase(value); break; // mBASE
+		case 0x1A6: transferAddress = (value * 8) & (SPU_RAM_SIZE - 1); break; // Sound RAM data transfer address
+		case 0x1A8: writeTransferFifo(value); break; // Sound RAM data transfer FIFO
+		case 0x1AA: // SPUCNT
+		{
+			if (!(value & 0x0040))
+			{
+				irqFlag = false; // acknowledge
+			}
+			break;
+		}
+	}
+}
+
+uint16_t spu::get16(uint32_t addr)
+{
+	catchUp();
+	if (addr < 0x180) // voice registers
+	{
+		if ((addr & 0xF) == 0xC) // current ADSR volume
+		{
+			return (uint16_t)voices[addr >> 4].envelopeLevel;
+		}
+		return registers[addr / 2];
+	}
+	if (addr >= 0x200 && addr < 0x260) // current voice volumes
+	{
+		uint32_t v = (addr - 0x200) / 4;
+		return (uint16_t)((addr & 2) ? lanes.volumeRight[v] : lanes.volumeLeft[v]);
+	}
+	switch (addr)
+	{
+		case 0x19C: return endFlags & 0xFFFF; // ENDX
+		case 0x19E: return endFlags >> 16;
+		case 0x1AE: // SPUSTAT
+		{
+			uint16_t status = control() & 0x3F;
+			if (irqFlag) { status |= 0x0040; }
+			if (control() & 0x0020) { status |= 0x0080; } // DMA request
+			uint32_t transferMode = (control() >> 4) & 0x3;
+			if (transferMode == 2) { status |= 0x0100; } // DMA write
+			if (transferMode == 3) { status |= 0x0200; } // DMA read
+			return status;
+		}
+		case 0x1B8: return (uint16_t)mainVolumeLeft.level; // current main volume
+		case 0x1BA: return (uint16_t)mainVolumeRight.level;
+		default: return registers[addr / 2];
+	}
+}
+
+void spu::set8(uint32_t addr, uint8_t value)
+{
+	logging::fatal("unimplemented 8 bit SPU write: " + helpers::intToHex(addr), logging::logSource::SPU);
+}
+
+uint8_t spu::get8(uint32_t addr)
+{
+	logging::fatal("unimplemented 8 bit SPU read: " + helpers::intToHex(addr), logging::logSource::SPU);
+	return 0;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include "helpers.hpp"
+#include "peripheral.hpp"
+#include "interrupt.hpp"
+#include "cdrom.hpp"
+#include "spuReverb.hpp"
+class cpu; // forward declare instead of include to solve circular dependency
+
+#define SPU_RAM_SIZE (512u * 1024)
+#define SPU_VOICES 24
+#define SPU_REGISTER_COUNT 0x200 // 16-bit registers from 0x1F801C00 to 0x1F802000
+#define SPU_CYCLES_PER_SAMPLE (CPU_CLOCK / CD_AUDIO_RATE) // 768
+#define SPU_BATCH_SAMPLES 32 // how many samples the main loop lets build up before running the SPU, register accesses always catch up first
+#define SPU_OUTPUT_BUFFER_FRAMES 8192
+#define SPU_BLOCK_SAMPLES 28 // samples in each 16 byte ADPCM block
+#define SPU_ENVELOPE_MAX 0x7FFF
+
+enum class adsrPhase : uint8_t
+{
+	Attack,
+	Decay,
+	Sustain,
+	Release,
+	Off
+};
+
+// A volume that is either fixed or sweeping, used for the voice and main volumes
+struct spuSweep
+{
+	int32_t level;
+	int32_t wait; // samples until the next step
+};
+
+struct spuVoice
+{
+	uint32_t currentAddress; // byte address in sound RAM of the block being played
+	uint32_t pitchCounter; // 12 bit fraction, the top bits are the sample within the block
+	int16_t decoded[3 + SPU_BLOCK_SAMPLES]; // the last 3 samples of the previous block for interpolation, then the current block
+	int32_t history[2]; // ADPCM filter input, the previous two decoded samples
+	uint8_t blockFlags; // loop end, repeat and loop start from the current block's header
+	bool blockDecoded;
+	adsrPhase phase;
+	int32_t envelopeLevel;
+	int32_t envelopeWait;
+	spuSweep volumeLeft;
+	spuSweep volumeRight;
+};
+
+// What each voice contributes to the current sample, laid out so all 24 voices can be scaled and summed 8 at a time
+struct spuMixLanes
+{
+	alignas(16) int16_t sample[SPU_VOICES]; // interpolated ADPCM, or the noise generator
+	alignas(16) int16_t envelope[SPU_VOICES];
+	alignas(16) int16_t volumeLeft[SPU_VOICES];
+	alignas(16) int16_t volumeRight[SPU_VOICES];
+	alignas(16) int16_t output[SPU_VOICES]; // sample after the envelope, used for pitch modulation of the next voice
+	alignas(16) int16_t reverbMask[SPU_VOICES]; // all ones for voices sent to reverb (EON)
+};
+
+class spu : public peripheral
+{
+	public:
+		spu(interruptController* i, cdrom* c);
+		~spu();
+		void giveCpuRef(cpu* c);
+		uint64_t getNextEventCycle() { return lastSampleCycle + (SPU_BATCH_SAMPLES * SPU_CYCLES_PER_SAMPLE); }
+		void catchUp(); // generates every sample up to the current CPU cycle
+		// Copies out up to max generated samples, returns how many there were
+		uint32_t readSamples(stereoSample* out, uint32_t max);
+		uint64_t getDroppedFrames() { return droppedFrames; }
+		// DMA channel 4, copies at the transfer address, which moves on and wraps at the end of sound RAM
+		void dmaWrite(const uint8_t* src, uint32_t length);
+		void dmaRead(uint8_t* dst, uint32_t length);
+		void set32(uint32_t addr, uint32_t value);
+		uint32_t get32(uint32_t addr);
+		void set16(uint32_t addr, uint16_t value);
+		uint16_t get16(uint32_t addr);
+		void set8(uint32_t addr, uint8_t value);
+		uint8_t get8(uint32_t addr);
+	private:
+		interruptController* InterruptController;
+		cdrom* CDROM;
+		cpu* CPU;
+		std::vector<uint8_t> soundRAM;
+		uint16_t registers[SPU_REGISTER_COUNT];
+		spuVoice voices[SPU_VOICES];
+		spuMixLanes lanes;
+		spuSweep mainVolumeLeft;
+		spuSweep mainVolumeRight;
+		uint32_t endFlags; // ENDX, set when a voice plays a block with the loop end flag
+		uint32_t transferAddress; // byte address for manual and DMA transfers
+		bool irqFlag;
+		int32_t noiseTimer;
+		uint16_t noiseLevel;
+		uint64_t lastSampleCycle;
+
+		// Reverb runs a batch behind, on the samples sent to it during the last batch
+		spuReverb* Reverb;
+		int16_t reverbInput[2][REVERB_BATCH_SAMPLES];
+		int16_t reverbOutput[2][REVERB_BATCH_SAMPLES];
+		uint32_t reverbIndex;
+
+		std::vector<stereoSample> output; // ring of SPU_OUTPUT_BUFFER_FRAMES
+		uint32_t outputHead;
+		uint32_t outputTail;
+		uint64_t droppedFrames;
+
+		uint16_t control() { return registers[0x1AA / 2]; }
+		uint32_t voiceMask(uint32_t addr) { return registers[addr / 2] | (registers[(addr / 2) + 1] << 16); } // KON, PMON, NON, EON etc. are split over two registers
+		void generateSample();
+		void stepVoice(uint32_t v);
+		void decodeBlock(uint32_t v);
+		void finishBlock(uint32_t v);
+		void stepEnvelope(uint32_t v);
+		void stepSweep(spuSweep& sweep, uint16_t reg);
+		void stepNoise();
+		void mixVoices(int32_t& left, int32_t& right, int32_t& reverbLeft, int32_t& reverbRight);
+		void keyOn(uint32_t mask);
+		void keyOff(uint32_t mask);
+		void writeTransferFifo(uint16_t value);
+		void checkIRQ(uint32_t address, uint32_t length);
+		void pushOutput(int16_t left, int16_t right);
+		uint64_t now();
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include "helpers.hpp"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPU_SSE2
+#endif
+
+// Fixed point helpers shared by the SPU mixer and reverb, which do all their maths on saturated 16 bit values
+
+static inline int32_t clamp16(int32_t value)
+{
+	return std::min(std::max(value, -0x8000), 0x7FFF);
+}
+
+// (a * b) >> 15, how the SPU applies every volume
+static inline int16_t mulQ15(int32_t a, int32_t b)
+{
+	return (int16_t)clamp16((a * b) >> 15);
+}
+
+#ifdef SPU_SSE2
+static inline __m128i mulQ15(__m128i a, __m128i b)
+{
+	__m128i low = _mm_mullo_epi16(a, b);
+	__m128i high = _mm_mulhi_epi16(a, b);
+	__m128i first = _mm_srai_epi32(_mm_unpacklo_epi16(low, high), 15);
+	__m128i second = _mm_srai_epi32(_mm_unpackhi_epi16(low, high), 15);
+	return _mm_packs_epi32(first, second);
+}
+
+static inline int32_t horizontalSum(__m128i v)
+{
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+	return _mm_cvtsi128_si32(v);
+}
+#endif
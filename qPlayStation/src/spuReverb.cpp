@@ -0,0 +1,372 @@
+#include "spuReverb.hpp"
+#include "spuMath.hpp"
+
+static const int16_t firCoefficients[REVERB_FIR_PADDED] = {
+	-0x0001, 0x0000, 0x0002, 0x0000, -0x000A, 0x0000, 0x0023, 0x0000, -0x0067, 0x0000,
+	0x010A, 0x0000, -0x0268, 0x0000, 0x0534, 0x0000, -0x0B90, 0x0000, 0x2806, 0x4000,
+	0x2806, 0x0000, -0x0B90, 0x0000, 0x0534, 0x0000, -0x0268, 0x0000, 0x010A, 0x0000,
+	-0x0067, 0x0000, 0x0023, 0x0000, -0x000A, 0x0000, 0x0002, 0x0000, -0x0001, 0x0000
+};
+
+// The even taps of the same filter. Upsampling puts a zero between every tick, so the odd output samples only see the centre tap.
+static const int16_t upsampleCoefficients[REVERB_UPSAMPLE_PADDED] = {
+	-0x0001, 0x0002, -0x000A, 0x0023, -0x0067, 0x010A, -0x0268, 0x0534, -0x0B90, 0x2806,
+	0x2806, -0x0B90, 0x0534, -0x0268, 0x010A, -0x0067, 0x0023, -0x000A, 0x0002, -0x0001,
+	0x0000, 0x0000, 0x0000, 0x0000
+};
+
+// Sum of samples * coefficients. With simd, taps has to be a multiple of 8.
+static int32_t dotProduct(const int16_t* samples, const int16_t* coefficients, uint32_t taps, bool simd)
+{
+#ifdef SPU_SSE2
+	if (simd)
+	{
+		__m128i sum = _mm_setzero_si128();
+		for (uint32_t i = 0; i < taps; i += 8)
+		{
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&samples[i]), _mm_loadu_si128((const __m128i*)&coefficients[i])));
+		}
+		return horizontalSum(sum);
+	}
+#endif
+	int32_t sum = 0;
+	for (uint32_t i = 0; i < taps; i++)
+	{
+		sum += samples[i] * coefficients[i];
+	}
+	return sum;
+}
+
+// Whether a write and a read at these offsets hit the same halfword between low and high ticks apart (read tick - write tick)
+static bool lagIn(int64_t writeOffset, int64_t readOffset, int64_t length, int32_t low, int32_t high)
+{
+	int64_t lag = (writeOffset - readOffset) % length;
+	if (lag < 0) { lag += length; }
+	return (lag >= low && lag <= high) || ((lag - length) >= low && (lag - length) <= high);
+}
+
+spuReverb::spuReverb(uint8_t* soundRAM)
+{
+	RAM = soundRAM;
+	memset(&regs, 0, sizeof(regs));
+	memset(inputHistory, 0, sizeof(inputHistory));
+	memset(tickHistory, 0, sizeof(tickHistory));
+	silent = true;
+	setBase(0);
+}
+
+void spuReverb::setBase(uint16_t mBASE)
+{
+	base = mBASE * 4;
+	position = base;
+	batched = canBatch();
+}
+
+void spuReverb::loadConfig(const uint16_t* config)
+{
+	if (memcmp(&regs, config, sizeof(regs)) != 0)
+	{
+		memcpy(&regs, config, sizeof(regs));
+		batched = canBatch();
+	}
+}
+
+// A batch does the reflections for every tick, with everything the combs and all pass filters need read either before or after,
+// then writes the filter results. That only gives the same answer as going a tick at a time if none of those reads should have
+// seen (or shouldn't have seen) a write from another tick in the same batch.
+bool spuReverb::canBatch()
+{
+	const int32_t n = REVERB_BATCH_TICKS;
+	int64_t length = REVERB_RAM_HALFWORDS - base;
+	if (length < 2 * n) { return false; }
+
+	struct access { int32_t offset; uint32_t op; };
+	// Ops are numbered in the order the hardware does them within a tick. 0 - 3 are the reflections, which are always done a tick at a time.
+	const access reflectionWrites[] = { { regs.mLSAME * 4, 0 }, { regs.mRSAME * 4, 1 }, { regs.mLDIFF * 4, 2 }, { regs.mRDIFF * 4, 3 } };
+	const access reflectionReads[] = {
+		{ regs.dLSAME * 4, 0 }, { (regs.mLSAME * 4) - 1, 0 }, { regs.dRSAME * 4, 1 }, { (regs.mRSAME * 4) - 1, 1 },
+		{ regs.dRDIFF * 4, 2 }, { (regs.mLDIFF * 4) - 1, 2 }, { regs.dLDIFF * 4, 3 }, { (regs.mRDIFF * 4) - 1, 3 }
+	};
+	const access filterWrites[] = { { regs.mLAPF1 * 4, 6 }, { regs.mRAPF1 * 4, 7 }, { regs.mLAPF2 * 4, 8 }, { regs.mRAPF2 * 4, 9 } };
+	const int16_t combVolumes[4] = { regs.vCOMB1, regs.vCOMB2, regs.vCOMB3, regs.vCOMB4 };
+
+	for (uint32_t i = 0; i < REVERB_FILTER_READS; i++)
+	{
+		readEarly[i] = false;
+		if (i < 8 && combVolumes[i % 4] == 0) { continue; } // a comb tap with no volume can read anything
+		access read = { filterReadOffset(i), (i < 8) ? (4 + (i / 4)) : (6 + (i - 8)) };
+
+		// Read after the reflections it sees all of them, even ones from later ticks. Read before, it sees none, even from this tick.
+		bool lateOK = true;
+		bool earlyOK = true;
+		for (const access& write : reflectionWrites)
+		{
+			if (lagIn(write.offset, read.offset, length, -(n - 1), -1)) { lateOK = false; }
+			if (lagIn(write.offset, read.offset, length, 0, n - 1)) { earlyOK = false; }
+		}
+		if (!lateOK && !earlyOK) { return false; }
+		readEarly[i] = !lateOK;
+
+		// Either way it sees none of the batch's filter writes
+		for (const access& write : filterWrites)
+		{
+			if (lagIn(write.offset, read.offset, length, 1, n - 1)) { return false; }
+			if (write.op < read.op && lagIn(write.offset, read.offset, length, 0, 0)) { return false; }
+		}
+	}
+	for (const access& write : filterWrites)
+	{
+		// Reflections in a batch happen before any filter writes, so they mustn't need one from an earlier tick
+		for (const access& read : reflectionReads)
+		{
+			if (lagIn(write.offset, read.offset, length, 1, n - 1)) { return false; }
+		}
+		// Writes land in op order rather than tick order, so the last one to a halfword has to be the same either way
+		for (const access& other : filterWrites)
+		{
+			if (other.op > write.op && lagIn(other.offset, write.offset, length, 1, n - 1)) { return false; }
+		}
+		for (const access& other : reflectionWrites)
+		{
+			if (lagIn(write.offset, other.offset, length, 1, n - 1)) { return false; }
+		}
+	}
+	return true;
+}
+
+int32_t spuReverb::filterReadOffset(uint32_t index)
+{
+	switch (index)
+	{
+		case 0: return regs.mLCOMB1 * 4;
+		case 1: return regs.mLCOMB2 * 4;
+		case 2: return regs.mLCOMB3 * 4;
+		case 3: return regs.mLCOMB4 * 4;
+		case 4: return regs.mRCOMB1 * 4;
+		case 5: return regs.mRCOMB2 * 4;
+		case 6: return regs.mRCOMB3 * 4;
+		case 7: return regs.mRCOMB4 * 4;
+		case 8: return (regs.mLAPF1 - regs.dAPF1) * 4;
+		case 9: return (regs.mRAPF1 - regs.dAPF1) * 4;
+		case 10: return (regs.mLAPF2 - regs.dAPF2) * 4;
+		default: return (regs.mRAPF2 - regs.dAPF2) * 4;
+	}
+}
+
+uint32_t spuReverb::address(int32_t offset, uint32_t tick)
+{
+	int64_t length = REVERB_RAM_HALFWORDS - base;
+	int64_t relative = ((int64_t)position - base + tick + offset) % length;
+	if (relative < 0) { relative += length; }
+	return base + (uint32_t)relative;
+}
+
+int16_t spuReverb::read(int32_t offset, uint32_t tick)
+{
+	int16_t value;
+	memcpy(&value, &RAM[address(offset, tick) * 2], sizeof(value));
+	return value;
+}
+
+void spuReverb::write(int32_t offset, uint32_t tick, int16_t value)
+{
+	memcpy(&RAM[address(offset, tick) * 2], &value, sizeof(value));
+}
+
+// A whole batch of ticks at one offset is contiguous apart from where it wraps back to the start of the work area
+void spuReverb::readSpan(int32_t offset, int16_t* out)
+{
+	uint32_t start = address(offset, 0);
+	uint32_t first = std::min<uint32_t>(REVERB_BATCH_TICKS, REVERB_RAM_HALFWORDS - start);
+	memcpy(out, &RAM[start * 2], first * 2);
+	memcpy(&out[first], &RAM[base * 2], (REVERB_BATCH_TICKS - first) * 2);
+}
+
+void spuReverb::writeSpan(int32_t offset, const int16_t* in)
+{
+	uint32_t start = address(offset, 0);
+	uint32_t first = std::min<uint32_t>(REVERB_BATCH_TICKS, REVERB_RAM_HALFWORDS - start);
+	memcpy(&RAM[start * 2], in, first * 2);
+	memcpy(&RAM[base * 2], &in[first], (REVERB_BATCH_TICKS - first) * 2);
+}
+
+void spuReverb::process(const int16_t* inLeft, const int16_t* inRight, int16_t* outLeft, int16_t* outRight, const uint16_t* config, bool enabled)
+{
+	if (!enabled)
+	{
+		// Most games leave reverb off most of the time, so this has to cost nothing
+		if (!silent)
+		{
+			memset(inputHistory, 0, sizeof(inputHistory));
+			memset(tickHistory, 0, sizeof(tickHistory));
+			silent = true;
+		}
+		memset(outLeft, 0, REVERB_BATCH_SAMPLES * sizeof(int16_t));
+		memset(outRight, 0, REVERB_BATCH_SAMPLES * sizeof(int16_t));
+		return;
+	}
+	silent = false;
+	loadConfig(config);
+#ifdef SPU_SSE2
+	if (batched)
+	{
+		alignas(16) int16_t left[REVERB_BATCH_TICKS];
+		alignas(16) int16_t right[REVERB_BATCH_TICKS];
+		reverbFilterInputs inputs;
+		downsample(inLeft, inRight, left, right, true);
+		readFilterInputs(inputs, true);
+		// Every reflection feeds back into itself on the next tick, so they can only be done in order
+		for (uint32_t tick = 0; tick < REVERB_BATCH_TICKS; tick++)
+		{
+			reflectTick(left[tick], right[tick], tick);
+		}
+		readFilterInputs(inputs, false);
+		filterBatch(inputs, left, right);
+		memcpy(&tickHistory[0][REVERB_UPSAMPLE_TAPS - 1], left, sizeof(left));
+		memcpy(&tickHistory[1][REVERB_UPSAMPLE_TAPS - 1], right, sizeof(right));
+		upsample(outLeft, outRight, true);
+		position = address(0, REVERB_BATCH_TICKS);
+		return;
+	}
+#endif
+	processReference(inLeft, inRight, outLeft, outRight, config);
+}
+
+void spuReverb::processReference(const int16_t* inLeft, const int16_t* inRight, int16_t* outLeft, int16_t* outRight, const uint16_t* config)
+{
+	loadConfig(config);
+	int16_t left[REVERB_BATCH_TICKS];
+	int16_t right[REVERB_BATCH_TICKS];
+	downsample(inLeft, inRight, left, right, false);
+	for (uint32_t tick = 0; tick < REVERB_BATCH_TICKS; tick++)
+	{
+		reflectTick(left[tick], right[tick], tick);
+		filterTick(left[tick], right[tick], tick);
+		tickHistory[0][REVERB_UPSAMPLE_TAPS - 1 + tick] = left[tick];
+		tickHistory[1][REVERB_UPSAMPLE_TAPS - 1 + tick] = right[tick];
+	}
+	upsample(outLeft, outRight, false);
+	position = address(0, REVERB_BATCH_TICKS);
+}
+
+void spuReverb::downsample(const int16_t* inLeft, const int16_t* inRight, int16_t* left, int16_t* right, bool simd)
+{
+	memcpy(&inputHistory[0][REVERB_FIR_TAPS - 1], inLeft, REVERB_BATCH_SAMPLES * sizeof(int16_t));
+	memcpy(&inputHistory[1][REVERB_FIR_TAPS - 1], inRight, REVERB_BATCH_SAMPLES * sizeof(int16_t));
+	uint32_t taps = simd ? REVERB_FIR_PADDED : REVERB_FIR_TAPS;
+	for (uint32_t tick = 0; tick < REVERB_BATCH_TICKS; tick++)
+	{
+		// Each tick takes the filter over the 39 samples ending at every second input sample
+		left[tick] = mulQ15(clamp16(dotProduct(&inputHistory[0][(tick * 2) + 1], firCoefficients, taps, simd) >> 15), regs.vLIN);
+		right[tick] = mulQ15(clamp16(dotProduct(&inputHistory[1][(tick * 2) + 1], firCoefficients, taps, simd) >> 15), regs.vRIN);
+	}
+	for (int c = 0; c < 2; c++)
+	{
+		memmove(inputHistory[c], &inputHistory[c][REVERB_BATCH_SAMPLES], (REVERB_FIR_TAPS - 1) * sizeof(int16_t));
+	}
+}
+
+void spuReverb::upsample(int16_t* outLeft, int16_t* outRight, bool simd)
+{
+	uint32_t taps = simd ? REVERB_UPSAMPLE_PADDED : REVERB_UPSAMPLE_TAPS;
+	for (uint32_t tick = 0; tick < REVERB_BATCH_TICKS; tick++)
+	{
+		// The gain of 2 makes up for the zeros between ticks
+		outLeft[tick * 2] = (int16_t)clamp16(dotProduct(&tickHistory[0][tick], upsampleCoefficients, taps, simd) >> 14);
+		outRight[tick * 2] = (int16_t)clamp16(dotProduct(&tickHistory[1][tick], upsampleCoefficients, taps, simd) >> 14);
+		outLeft[(tick * 2) + 1] = tickHistory[0][tick + (REVERB_UPSAMPLE_TAPS / 2)];
+		outRight[(tick * 2) + 1] = tickHistory[1][tick + (REVERB_UPSAMPLE_TAPS / 2)];
+	}
+	for (int c = 0; c < 2; c++)
+	{
+		memmove(tickHistory[c], &tickHistory[c][REVERB_BATCH_TICKS], (REVERB_UPSAMPLE_TAPS - 1) * sizeof(int16_t));
+	}
+}
+
+void spuReverb::reflectTick(int16_t left, int16_t right, uint32_t tick)
+{
+	reflect(regs.mLSAME, regs.dLSAME, left, tick);
+	reflect(regs.mRSAME, regs.dRSAME, right, tick);
+	reflect(regs.mLDIFF, regs.dRDIFF, left, tick);
+	reflect(regs.mRDIFF, regs.dLDIFF, right, tick);
+}
+
+// [mSAME] = (input + [dSAME] * vWALL - [mSAME - 2]) * vIIR + [mSAME - 2], DIFF is the same with d from the other channel
+void spuReverb::reflect(uint16_t mSAME, uint16_t dSAME, int16_t input, uint32_t tick)
+{
+	int32_t previous = read((mSAME * 4) - 1, tick);
+	int32_t reflected = clamp16(input + mulQ15(read(dSAME * 4, tick), regs.vWALL));
+	write(mSAME * 4, tick, (int16_t)clamp16(mulQ15(clamp16(reflected - previous), regs.vIIR) + previous));
+}
+
+// out = [mAPF - dAPF] + vAPF * ([mAPF] = input - vAPF * [mAPF - dAPF])
+int16_t spuReverb::allPass(int16_t input, uint16_t mAPF, uint16_t dAPF, int16_t vAPF, uint32_t tick)
+{
+	int32_t delayed = read((mAPF - dAPF) * 4, tick);
+	int16_t stored = (int16_t)clamp16(input - mulQ15(delayed, vAPF));
+	write(mAPF * 4, tick, stored);
+	return (int16_t)clamp16(mulQ15(stored, vAPF) + delayed);
+}
+
+void spuReverb::filterTick(int16_t& left, int16_t& right, uint32_t tick)
+{
+	left = (int16_t)clamp16(mulQ15(regs.vCOMB1, read(regs.mLCOMB1 * 4, tick)) + mulQ15(regs.vCOMB2, read(regs.mLCOMB2 * 4, tick)));
+	left = (int16_t)clamp16(left + mulQ15(regs.vCOMB3, read(regs.mLCOMB3 * 4, tick)));
+	left = (int16_t)clamp16(left + mulQ15(regs.vCOMB4, read(regs.mLCOMB4 * 4, tick)));
+	right = (int16_t)clamp16(mulQ15(regs.vCOMB1, read(regs.mRCOMB1 * 4, tick)) + mulQ15(regs.vCOMB2, read(regs.mRCOMB2 * 4, tick)));
+	right = (int16_t)clamp16(right + mulQ15(regs.vCOMB3, read(regs.mRCOMB3 * 4, tick)));
+	right = (int16_t)clamp16(right + mulQ15(regs.vCOMB4, read(regs.mRCOMB4 * 4, tick)));
+	left = allPass(left, regs.mLAPF1, regs.dAPF1, regs.vAPF1, tick);
+	right = allPass(right, regs.mRAPF1, regs.dAPF1, regs.vAPF1, tick);
+	left = allPass(left, regs.mLAPF2, regs.dAPF2, regs.vAPF2, tick);
+	right = allPass(right, regs.mRAPF2, regs.dAPF2, regs.vAPF2, tick);
+}
+
+#ifdef SPU_SSE2
+void spuReverb::readFilterInputs(reverbFilterInputs& inputs, bool early)
+{
+	for (uint32_t i = 0; i < REVERB_FILTER_READS; i++)
+	{
+		if (readEarly[i] == early)
+		{
+			readSpan(filterReadOffset(i), inputs.taps[i]);
+		}
+	}
+}
+
+// The combs and all pass filters for a whole batch, in the same order and with the same saturation as filterTick
+void spuReverb::filterBatch(const reverbFilterInputs& inputs, int16_t* left, int16_t* right)
+{
+	alignas(16) int16_t stored[4][REVERB_BATCH_TICKS];
+	const __m128i vCOMB[4] = { _mm_set1_epi16(regs.vCOMB1), _mm_set1_epi16(regs.vCOMB2), _mm_set1_epi16(regs.vCOMB3), _mm_set1_epi16(regs.vCOMB4) };
+	const __m128i vAPF[2] = { _mm_set1_epi16(regs.vAPF1), _mm_set1_epi16(regs.vAPF2) };
+	for (uint32_t tick = 0; tick < REVERB_BATCH_TICKS; tick += 8)
+	{
+		__m128i out[2];
+		for (int c = 0; c < 2; c++)
+		{
+			const int16_t (*combs)[REVERB_BATCH_TICKS] = &inputs.taps[c * 4];
+			out[c] = _mm_adds_epi16(mulQ15(vCOMB[0], _mm_load_si128((const __m128i*)&combs[0][tick])), mulQ15(vCOMB[1], _mm_load_si128((const __m128i*)&combs[1][tick])));
+			out[c] = _mm_adds_epi16(out[c], mulQ15(vCOMB[2], _mm_load_si128((const __m128i*)&combs[2][tick])));
+			out[c] = _mm_adds_epi16(out[c], mulQ15(vCOMB[3], _mm_load_si128((const __m128i*)&combs[3][tick])));
+		}
+		for (int stage = 0; stage < 2; stage++)
+		{
+			for (int c = 0; c < 2; c++)
+			{
+				__m128i delay = _mm_load_si128((const __m128i*)&inputs.taps[8 + (stage * 2) + c][tick]);
+				__m128i store = _mm_subs_epi16(out[c], mulQ15(delay, vAPF[stage]));
+				_mm_store_si128((__m128i*)&stored[(stage * 2) + c][tick], store);
+				out[c] = _mm_adds_epi16(mulQ15(store, vAPF[stage]), delay);
+			}
+		}
+		_mm_store_si128((__m128i*)&left[tick], out[0]);
+		_mm_store_si128((__m128i*)&right[tick], out[1]);
+	}
+
+	writeSpan(regs.mLAPF1 * 4, stored[0]);
+	writeSpan(regs.mRAPF1 * 4, stored[1]);
+	writeSpan(regs.mLAPF2 * 4, stored[2]);
+	writeSpan(regs.mRAPF2 * 4, stored[3]);
+}
+#endif
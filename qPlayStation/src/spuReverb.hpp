@@ -0,0 +1,72 @@
+#pragma once
+#include "helpers.hpp"
+
+#define REVERB_BATCH_TICKS 16 // reverb runs at 22050Hz, so this is 32 SPU samples
+#define REVERB_BATCH_SAMPLES (REVERB_BATCH_TICKS * 2)
+#define REVERB_FIR_TAPS 39 // the hardware's half band filter, used going in and coming out of 22050Hz
+#define REVERB_FIR_PADDED 40 // rounded up to whole SIMD registers with zero taps
+#define REVERB_UPSAMPLE_TAPS 20 // only the even taps of the filter touch real samples when upsampling
+#define REVERB_UPSAMPLE_PADDED 24
+#define REVERB_RAM_HALFWORDS (512 * 1024 / 2)
+#define REVERB_FILTER_READS 12 // 8 comb taps then the 4 all pass delays
+
+// Registers 0x1F801DC0 - 0x1F801DFF, in order. Addresses are in 8 byte units from the current position in the work area.
+struct reverbConfig
+{
+	uint16_t dAPF1, dAPF2;
+	int16_t vIIR, vCOMB1, vCOMB2, vCOMB3, vCOMB4, vWALL, vAPF1, vAPF2;
+	uint16_t mLSAME, mRSAME, mLCOMB1, mRCOMB1, mLCOMB2, mRCOMB2, dLSAME, dRSAME;
+	uint16_t mLDIFF, mRDIFF, mLCOMB3, mRCOMB3, mLCOMB4, mRCOMB4, dLDIFF, dRDIFF;
+	uint16_t mLAPF1, mRAPF1, mLAPF2, mRAPF2;
+	int16_t vLIN, vRIN;
+};
+
+// Everything the combs and all pass filters read for a batch, one row per tap
+struct reverbFilterInputs
+{
+	alignas(16) int16_t taps[REVERB_FILTER_READS][REVERB_BATCH_TICKS];
+};
+
+// The reverb is a fixed network of reflections, combs and all pass filters over a ring buffer at the top of sound RAM.
+// It's processed a batch of ticks at a time: the reflections feed back into themselves every tick so they're done in order,
+// but the combs and all pass filters only read sound RAM far enough behind where they write that a whole batch can be done
+// at once with SIMD. Setups where that isn't true (the game picks the offsets) fall back to doing a tick at a time.
+class spuReverb
+{
+	public:
+		spuReverb(uint8_t* soundRAM);
+		void setBase(uint16_t mBASE); // start of the work area, in 8 byte units, this also restarts the current position
+		// Takes REVERB_BATCH_SAMPLES of input at 44.1kHz and fills the same number of output samples, before the output volume.
+		// config points at the 32 reverb registers. With enabled false nothing is written to sound RAM and the output is silent.
+		void process(const int16_t* inLeft, const int16_t* inRight, int16_t* outLeft, int16_t* outRight, const uint16_t* config, bool enabled);
+		// The same thing a tick at a time without SIMD, for setups that can't be batched and to check the batched version against
+		void processReference(const int16_t* inLeft, const int16_t* inRight, int16_t* outLeft, int16_t* outRight, const uint16_t* config);
+		bool isBatched() { return batched; }
+	private:
+		uint8_t* RAM;
+		uint32_t base; // halfword index of the start of the work area
+		uint32_t position; // halfword index of the current position, between base and the end of RAM
+		reverbConfig regs;
+		bool batched; // whether the current config's offsets allow whole batches
+		bool readEarly[REVERB_FILTER_READS]; // read before the batch's reflections are written rather than after
+		bool silent; // reverb is off and the filter histories have been cleared
+		int16_t inputHistory[2][REVERB_FIR_PADDED - 1 + REVERB_BATCH_SAMPLES]; // the samples the downsampling filter still needs, then the new batch
+		int16_t tickHistory[2][REVERB_UPSAMPLE_PADDED - 1 + REVERB_BATCH_TICKS]; // the same for upsampling, at 22050Hz
+
+		void loadConfig(const uint16_t* config);
+		bool canBatch();
+		uint32_t address(int32_t offset, uint32_t tick);
+		int16_t read(int32_t offset, uint32_t tick);
+		void write(int32_t offset, uint32_t tick, int16_t value);
+		void readSpan(int32_t offset, int16_t* out);
+		void writeSpan(int32_t offset, const int16_t* in);
+		void downsample(const int16_t* inLeft, const int16_t* inRight, int16_t* left, int16_t* right, bool simd);
+		void upsample(int16_t* outLeft, int16_t* outRight, bool simd);
+		void reflectTick(int16_t left, int16_t right, uint32_t tick);
+		void reflect(uint16_t mSAME, uint16_t dSAME, int16_t input, uint32_t tick);
+		int32_t filterReadOffset(uint32_t index);
+		void readFilterInputs(reverbFilterInputs& inputs, bool early);
+		void filterBatch(const reverbFilterInputs& inputs, int16_t* left, int16_t* right);
+		void filterTick(int16_t& left, int16_t& right, uint32_t tick);
+		int16_t allPass(int16_t input, uint16_t mAPF, uint16_t dAPF, int16_t vAPF, uint32_t tick);
+};
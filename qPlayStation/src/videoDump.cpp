@@ -0,0 +1,231 @@
+#include "videoDump.hpp"
+#include "frameDump.hpp"
+#include <algorithm>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VIDEO_DUMP_SSE2
+#endif
+
+videoDump::videoDump(std::string path, uint32_t queueLength, videoDumpPolicy p)
+{
+	file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		logging::fatal("unable to open video dump file: " + path, logging::logSource::GPU);
+	}
+	policy = p;
+	slots.resize(std::max(queueLength, 1u));
+	head = 0;
+	tail = 0;
+	streamWidth = 0;
+	streamHeight = 0;
+	framesQueued = 0;
+	framesDropped = 0;
+	framesWritten = 0;
+	totalLatency = 0;
+	maxLatency = 0;
+
+	running = true;
+	writer = std::thread(&videoDump::writerLoop, this);
+	logging::info("Recording video to " + path, logging::logSource::GPU);
+}
+
+videoDump::~videoDump()
+{
+	// The writer drains whatever is still queued before it exits
+	running = false;
+	writer.join();
+	file.close();
+
+	logging::important("Video dump: " + std::to_string(framesWritten) + " frames written, " + std::to_string(framesDropped) + " dropped", logging::logSource::GPU);
+	if (framesWritten > 0)
+	{
+		logging::important("Video dump latency (ms): avg " + std::to_string(totalLatency / framesWritten) + ", max " + std::to_string(maxLatency), logging::logSource::GPU);
+	}
+}
+
+void videoDump::pushFrame(const uint8_t* vram, DisplayArea area)
+{
+	uint64_t h = head.load(std::memory_order_relaxed);
+	while (h - tail.load(std::memory_order_acquire) >= slots.size())
+	{
+		if (policy == videoDumpPolicy::Drop)
+		{
+			framesDropped++;
+			return;
+		}
+		std::this_thread::yield();
+	}
+
+	videoFrame& frame = slots[h % slots.size()];
+	frameDump::displayToRGB(vram, area, frame.rgb);
+	frame.width = area.width;
+	frame.height = area.height;
+	frame.queued = std::chrono::steady_clock::now();
+	framesQueued++;
+	head.store(h + 1, std::memory_order_release);
+}
+
+void videoDump::writerLoop()
+{
+	while (true)
+	{
+		uint64_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire))
+		{
+			if (!running) { break; }
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		videoFrame& frame = slots[t % slots.size()];
+		writeFrame(frame);
+		double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame.queued).count();
+		totalLatency += latency;
+		maxLatency = std::max(maxLatency, latency);
+		framesWritten++;
+		tail.store(t + 1, std::memory_order_release);
+	}
+}
+
+void videoDump::writeFrame(videoFrame& frame)
+{
+	if (streamWidth == 0)
+	{
+		// Y4M can't change size mid stream, so the first frame decides it
+		streamWidth = frame.width;
+		streamHeight = frame.height;
+		file << "YUV4MPEG2 W" << streamWidth << " H" << streamHeight << " F60:1 Ip A1:1 C420jpeg\n";
+		yuv.resize((streamWidth * streamHeight) + ((streamWidth / 2) * (streamHeight / 2) * 2));
+		for (int i = 0; i < 3; i++)
+		{
+			planes[i].resize(streamWidth);
+		}
+	}
+
+	if (frame.width != streamWidth || frame.height != streamHeight)
+	{
+		// Resolution changed - nearest neighbour scale to the stream size
+		std::vector<uint8_t> scaled(streamWidth * streamHeight * 3);
+		for (uint32_t y = 0; y < streamHeight; y++)
+		{
+			uint32_t srcY = (y * frame.height) / streamHeight;
+			for (uint32_t x = 0; x < streamWidth; x++)
+			{
+				uint32_t srcX = (x * frame.width) / streamWidth;
+				memcpy(&scaled[((y * streamWidth) + x) * 3], &frame.rgb[((srcY * frame.width) + srcX) * 3], 3);
+			}
+		}
+		convertToYUV(scaled.data());
+	}
+	else
+	{
+		convertToYUV(frame.rgb.data());
+	}
+
+	file << "FRAME\n";
+	file.write((const char*)yuv.data(), yuv.size());
+}
+
+// BT.601 limited range, Y = ((66R + 129G + 25B + 128) >> 8) + 16.
+// The sums fit in unsigned 16 bits, so SSE2 can do 8 pixels at once.
+static inline void lumaRow(const uint16_t* r, const uint16_t* g, const uint16_t* b, uint8_t* out, uint32_t width)
+{
+	uint32_t x = 0;
+#ifdef VIDEO_DUMP_SSE2
+	const __m128i kr = _mm_set1_epi16(66);
+	const __m128i kg = _mm_set1_epi16(129);
+	const __m128i kb = _mm_set1_epi16(25);
+	const __m128i round = _mm_set1_epi16(128);
+	const __m128i offset = _mm_set1_epi16(16);
+	for (; x + 8 <= width; x += 8)
+	{
+		__m128i sum = _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)&r[x]), kr);
+		sum = _mm_add_epi16(sum, _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)&g[x]), kg));
+		sum = _mm_add_epi16(sum, _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)&b[x]), kb));
+		sum = _mm_add_epi16(_mm_srli_epi16(_mm_add_epi16(sum, round), 8), offset);
+		_mm_storel_epi64((__m128i*)&out[x], _mm_packus_epi16(sum, sum));
+	}
+#endif
+	for (; x < width; x++)
+	{
+		out[x] = (uint8_t)((((66 * r[x]) + (129 * g[x]) + (25 * b[x]) + 128) >> 8) + 16);
+	}
+}
+
+// U = ((112B - 38R - 74G + 0x8080) >> 8), V = ((112R - 94G - 18B + 0x8080) >> 8).
+// 0x8080 is the +128 offset and rounding together, and keeps the result positive so 16 bit maths still works.
+static inline void chromaRow(const uint16_t* pos, uint16_t kPos, const uint16_t* neg1, uint16_t kNeg1, const uint16_t* neg2, uint16_t kNeg2, uint8_t* out, uint32_t width)
+{
+	uint32_t x = 0;
+#ifdef VIDEO_DUMP_SSE2
+	const __m128i vPos = _mm_set1_epi16(kPos);
+	const __m128i vNeg1 = _mm_set1_epi16(kNeg1);
+	const __m128i vNeg2 = _mm_set1_epi16(kNeg2);
+	const __m128i offset = _mm_set1_epi16((short)0x8080);
+	for (; x + 8 <= width; x += 8)
+	{
+		__m128i sum = _mm_add_epi16(_mm_mullo_epi16(_mm_loadu_si128((const __m128i*)&pos[x]), vPos), offset);
+		sum = _mm_sub_epi16(sum, _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)&neg1[x]), vNeg1));
+		sum = _mm_sub_epi16(sum, _mm_mullo_epi16(_mm_loadu_si128((const __m128i*)&neg2[x]), vNeg2));
+		sum = _mm_srli_epi16(sum, 8);
+		_mm_storel_epi64((__m128i*)&out[x], _mm_packus_epi16(sum, sum));
+	}
+#endif
+	for (; x < width; x++)
+	{
+		out[x] = (uint8_t)(((kPos * pos[x]) - (kNeg1 * neg1[x]) - (kNeg2 * neg2[x]) + 0x8080) >> 8);
+	}
+}
+
+void videoDump::convertToYUV(const uint8_t* rgb)
+{
+	uint32_t chromaWidth = streamWidth / 2;
+	uint8_t* yPlane = yuv.data();
+	uint8_t* uPlane = yPlane + (streamWidth * streamHeight);
+	uint8_t* vPlane = uPlane + (chromaWidth * (streamHeight / 2));
+	std::vector<uint16_t> chroma[3];
+	for (int i = 0; i < 3; i++)
+	{
+		chroma[i].assign(chromaWidth, 0);
+	}
+
+	for (uint32_t y = 0; y < streamHeight; y++)
+	{
+		// Split the packed RGB into planes so the maths can be done 8 pixels at a time
+		const uint8_t* src = &rgb[y * streamWidth * 3];
+		for (uint32_t x = 0; x < streamWidth; x++)
+		{
+			planes[0][x] = src[x * 3];
+			planes[1][x] = src[(x * 3) + 1];
+			planes[2][x] = src[(x * 3) + 2];
+		}
+		lumaRow(planes[0].data(), planes[1].data(), planes[2].data(), &yPlane[y * streamWidth], streamWidth);
+
+		// Chroma is the average of each 2x2 block
+		for (uint32_t x = 0; x < chromaWidth; x++)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				chroma[i][x] += planes[i][x * 2] + planes[i][(x * 2) + 1];
+			}
+		}
+		if (y & 1)
+		{
+			for (uint32_t x = 0; x < chromaWidth; x++)
+			{
+				for (int i = 0; i < 3; i++)
+				{
+					chroma[i][x] = (chroma[i][x] + 2) >> 2;
+				}
+			}
+			uint32_t row = (y / 2) * chromaWidth;
+			chromaRow(chroma[2].data(), 112, chroma[0].data(), 38, chroma[1].data(), 74, &uPlane[row], chromaWidth);
+			chromaRow(chroma[0].data(), 112, chroma[1].data(), 94, chroma[2].data(), 18, &vPlane[row], chromaWidth);
+			for (int i = 0; i < 3; i++)
+			{
+				std::fill(chroma[i].begin(), chroma[i].end(), 0);
+			}
+		}
+	}
+}
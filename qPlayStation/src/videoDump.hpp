@@ -0,0 +1,56 @@
+#pragma once
+#include "helpers.hpp"
+#include "gpu.hpp"
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// What to do when the writer thread can't keep up
+enum class videoDumpPolicy
+{
+	Drop,	// throw the new frame away, emulation speed is unaffected
+	Block	// wait for a free slot, every frame ends up in the file
+};
+
+struct videoFrame
+{
+	std::vector<uint8_t> rgb;
+	uint32_t width;
+	uint32_t height;
+	std::chrono::steady_clock::time_point queued;
+};
+
+// Writes displayed frames to an uncompressed Y4M file on a background thread.
+// The emulator thread only converts the display area to RGB and puts it in a
+// fixed size single producer / single consumer ring, everything else happens on the writer.
+class videoDump
+{
+	public:
+		videoDump(std::string path, uint32_t queueLength, videoDumpPolicy policy);
+		~videoDump();
+		void pushFrame(const uint8_t* vram, DisplayArea area);
+	private:
+		std::ofstream file;
+		videoDumpPolicy policy;
+		std::vector<videoFrame> slots;
+		std::atomic<uint64_t> head; // frames queued, only written by the emulator thread
+		std::atomic<uint64_t> tail; // frames written, only written by the writer thread
+		std::atomic<bool> running;
+		std::thread writer;
+
+		uint32_t streamWidth;
+		uint32_t streamHeight;
+		std::vector<uint8_t> yuv;
+		std::vector<uint16_t> planes[3];
+
+		// Stats - dropped is only touched by the emulator thread, the rest by the writer
+		uint64_t framesQueued;
+		uint64_t framesDropped;
+		uint64_t framesWritten;
+		double totalLatency;
+		double maxLatency;
+
+		void writerLoop();
+		void writeFrame(videoFrame& frame);
+		void convertToYUV(const uint8_t* rgb);
+};